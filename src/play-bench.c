@@ -0,0 +1,395 @@
+/**
+ * PLAY
+ * play-bench.c: Playlist and queue benchmarks
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-queue.h"
+#include "play-queue-item.h"
+
+#include <sys/resource.h>
+
+// Default comma-separated lists of playlist sizes and formats to measure
+#define BENCH_SIZES   "1000,100000,1000000"
+#define BENCH_FORMATS "m3u,m3u8,pls,asx,xspf"
+
+// Write a synthetic playlist of the given format with the given number
+// of entries
+// Returns FALSE on error
+static gboolean bench_generate (const gchar *path,
+                                const gchar *format,
+                                guint entries);
+
+// Measure reading a playlist into a queue
+// Returns FALSE if the queue does not hold all of the entries afterwards
+static gboolean bench_parse (const gchar *path,
+                             const gchar *format,
+                             guint entries);
+
+// Measure the queue operations on a queue of the given size
+static void bench_queue (guint entries);
+
+// Print the result of a single measurement
+static void bench_print (const gchar *type,
+                         const gchar *format,
+                         guint entries,
+                         gint64 time);
+
+// Reset the peak resident set size of the process, where supported
+static void bench_reset_peak_rss (void);
+
+// Return the peak resident set size of the process in kilobytes
+static glong bench_get_peak_rss (void);
+
+// A playlist has been completely read or its reading failed
+static void bench_playlist_done (PlayQueue *queue, const gchar *uri);
+
+// Global variables
+static GMainLoop *loop;
+
+// Command line options
+static gchar *opt_sizes   = NULL;
+static gchar *opt_formats = NULL;
+static gchar *opt_dir     = NULL;
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError         *err = NULL;
+    gchar         **sizes;
+    gchar         **formats;
+    gchar          *dir;
+    gboolean        failed = FALSE;
+    guint           i;
+    guint           j;
+
+    static const GOptionEntry opts[] = {
+        { "sizes",   's', 0, G_OPTION_ARG_STRING, &opt_sizes,
+          "Comma-separated numbers of playlist entries (default: "
+          BENCH_SIZES ")",
+          "N,..." },
+        { "formats", 'f', 0, G_OPTION_ARG_STRING, &opt_formats,
+          "Comma-separated playlist formats (default: " BENCH_FORMATS ")",
+          "FORMAT,..." },
+        { "dir",     'd', 0, G_OPTION_ARG_FILENAME, &opt_dir,
+          "Directory for the generated playlists (default: temporary)",
+          "DIR" },
+        { NULL }
+    };
+
+    context = g_option_context_new ("- playlist and queue benchmarks");
+    g_option_context_add_main_entries (context, opts, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &err)) {
+        g_printerr ("%s\n", err->message);
+        g_option_context_free (context);
+        g_error_free (err);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    if (opt_dir) {
+        dir = g_strdup (opt_dir);
+    } else {
+        dir = g_dir_make_tmp ("play-bench-XXXXXX", &err);
+        if (!dir) {
+            g_printerr ("%s\n", err->message);
+            g_error_free (err);
+            return 1;
+        }
+    }
+    loop = g_main_loop_new (NULL, FALSE);
+
+    sizes   = g_strsplit (opt_sizes ? opt_sizes : BENCH_SIZES, ",", -1);
+    formats = g_strsplit (opt_formats ? opt_formats : BENCH_FORMATS, ",", -1);
+
+    for (i = 0; sizes[i]; i++) {
+        guint entries = (guint) g_ascii_strtoull (sizes[i], NULL, 10);
+
+        if (!entries) {
+            g_printerr ("Invalid playlist size: %s\n", sizes[i]);
+            failed = TRUE;
+            continue;
+        }
+        for (j = 0; formats[j]; j++) {
+            gchar *name;
+            gchar *path;
+
+            name = g_strdup_printf ("bench-%u.%s", entries, formats[j]);
+            path = g_build_filename (dir, name, NULL);
+            // A playlist which cannot be generated or is not read whole
+            // fails the run, the remaining measurements are still made
+            if (!bench_generate (path, formats[j], entries) ||
+                !bench_parse (path, formats[j], entries))
+                failed = TRUE;
+
+            g_unlink (path);
+            g_free (path);
+            g_free (name);
+        }
+        bench_queue (entries);
+    }
+
+    if (!opt_dir)
+        g_rmdir (dir);
+
+    g_strfreev (formats);
+    g_strfreev (sizes);
+    g_main_loop_unref (loop);
+    g_free (dir);
+    return failed ? 1 : 0;
+}
+
+// Write a synthetic playlist of the given format with the given number
+// of entries
+// Returns FALSE on error
+static gboolean bench_generate (const gchar *path,
+                                const gchar *format,
+                                guint entries)
+{
+    FILE  *fp;
+    guint  i;
+
+    fp = g_fopen (path, "w");
+    if (!fp) {
+        g_printerr ("Failed to create %s: %s\n", path, g_strerror (errno));
+        return FALSE;
+    }
+
+    // The entries point at files in a tree of artist directories, they are
+    // not accessed when reading the playlist
+    if (!strcmp (format, "m3u") || !strcmp (format, "m3u8")) {
+        // The UTF-8 variant uses non-ASCII names to exercise the charset
+        // handling
+        const gchar *artist = strcmp (format, "m3u8")
+            ? "Artist"
+            : "K\xc3\xbcnstler";
+
+        fputs ("#EXTM3U\n", fp);
+        for (i = 0; i < entries; i++)
+            fprintf (fp,
+                     "#EXTINF:%u,%s %u - Track %u\n"
+                     "/bench/music/%s %u/track-%07u.ogg\n",
+                     180 + i % 120,
+                     artist, i / 10, i,
+                     artist, i / 10, i);
+    } else if (!strcmp (format, "pls")) {
+        fputs ("[playlist]\n", fp);
+        for (i = 0; i < entries; i++)
+            fprintf (fp,
+                     "File%u=/bench/music/Artist %u/track-%07u.ogg\n"
+                     "Title%u=Artist %u - Track %u\n"
+                     "Length%u=%u\n",
+                     i + 1, i / 10, i,
+                     i + 1, i / 10, i,
+                     i + 1, 180 + i % 120);
+        fprintf (fp, "NumberOfEntries=%u\nVersion=2\n", entries);
+    } else if (!strcmp (format, "asx")) {
+        fputs ("<asx version=\"3.0\">\n", fp);
+        for (i = 0; i < entries; i++)
+            fprintf (fp,
+                     "<entry><title>Track %u</title><author>Artist %u</author>"
+                     "<ref href=\"file:///bench/music/Artist%%20%u/"
+                     "track-%07u.ogg\"/></entry>\n",
+                     i, i / 10,
+                     i / 10, i);
+        fputs ("</asx>\n", fp);
+    } else if (!strcmp (format, "xspf")) {
+        fputs ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+               "<trackList>\n", fp);
+        for (i = 0; i < entries; i++)
+            fprintf (fp,
+                     "<track><location>file:///bench/music/Artist%%20%u/"
+                     "track-%07u.ogg</location><title>Track %u</title>"
+                     "<creator>Artist %u</creator></track>\n",
+                     i / 10, i,
+                     i,
+                     i / 10);
+        fputs ("</trackList>\n</playlist>\n", fp);
+    } else {
+        g_printerr ("Unknown playlist format: %s\n", format);
+        fclose (fp);
+        return FALSE;
+    }
+
+    if (fclose (fp)) {
+        g_printerr ("Failed to write %s: %s\n", path, g_strerror (errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Measure reading a playlist into a queue
+// Returns FALSE if the queue does not hold all of the entries afterwards
+static gboolean bench_parse (const gchar *path,
+                             const gchar *format,
+                             guint entries)
+{
+    PlayQueue *queue;
+    gint64     time;
+    guint      count;
+
+    bench_reset_peak_rss ();
+
+    queue = play_queue_new ();
+    g_signal_connect (
+        G_OBJECT (queue),
+        "playlist-error",
+        G_CALLBACK (bench_playlist_done),
+        NULL);
+    g_signal_connect (
+        G_OBJECT (queue),
+        "playlist-finished",
+        G_CALLBACK (bench_playlist_done),
+        NULL);
+
+    time = g_get_monotonic_time ();
+    if (play_queue_add (queue, path))
+        g_main_loop_run (loop);
+    time = g_get_monotonic_time () - time;
+
+    count = play_queue_get_count (queue);
+    if (count != entries)
+        g_printerr ("Read %u of %u entries of %s\n",
+                    count,
+                    entries,
+                    path);
+
+    bench_print ("parse", format, count, time);
+    g_object_unref (queue);
+
+    return count == entries;
+}
+
+// Measure the queue operations on a queue of the given size
+static void bench_queue (guint entries)
+{
+    PlayQueue *queue;
+    GPtrArray *items;
+    gint64     time;
+    guint      i;
+
+    bench_reset_peak_rss ();
+
+    items = g_ptr_array_new_full (entries, g_object_unref);
+    for (i = 0; i < entries; i++) {
+        PlayQueueItem *item = play_queue_item_new ();
+        gchar         *path;
+
+        path = g_strdup_printf (
+            "/bench/music/Artist %u/track-%07u.ogg",
+            i / 10,
+            i);
+        play_queue_item_set_file_or_uri (item, path);
+        g_ptr_array_add (items, item);
+        g_free (path);
+    }
+    queue = play_queue_new ();
+
+    time = g_get_monotonic_time ();
+    play_queue_add_items (queue, items);
+    bench_print ("queue-add", NULL, entries, g_get_monotonic_time () - time);
+    g_ptr_array_unref (items);
+
+    time = g_get_monotonic_time ();
+    play_queue_randomize (queue);
+    bench_print ("queue-randomize", NULL, entries,
+                 g_get_monotonic_time () - time);
+
+    time = g_get_monotonic_time ();
+    play_queue_sort_by_position (queue);
+    bench_print ("queue-sort", NULL, entries,
+                 g_get_monotonic_time () - time);
+
+    // Walk the whole queue forward and back the way the next and previous
+    // commands do
+    time = g_get_monotonic_time ();
+    play_queue_position_set_first (queue);
+    while (play_queue_position_set_next (queue))
+        ;
+    while (play_queue_position_set_previous (queue))
+        ;
+    bench_print ("queue-navigate", NULL, entries,
+                 g_get_monotonic_time () - time);
+
+    // The title lookup done by the status line redraw of each track, the
+    // name is derived from the URI on the first use
+    time = g_get_monotonic_time ();
+    for (i = 0; i < entries; i++) {
+        PlayQueueItem *item = play_queue_get_nth (queue, i);
+        const gchar   *title;
+
+        title = play_queue_item_get_metadata (item, PLAY_METADATA_TITLE_FULL);
+        if (!title)
+            title = play_queue_item_get_name (item);
+        if (!title)
+            g_printerr ("No title for queue item %u\n", i);
+    }
+    bench_print ("queue-title", NULL, entries,
+                 g_get_monotonic_time () - time);
+
+    g_object_unref (queue);
+}
+
+// Print the result of a single measurement
+static void bench_print (const gchar *type,
+                         const gchar *format,
+                         guint entries,
+                         gint64 time)
+{
+    gdouble seconds = (gdouble) time / G_USEC_PER_SEC;
+
+    // One line per measurement in the key=value form used by the latency
+    // report of the player
+    g_print (
+        "bench type=%s format=%s entries=%u seconds=%.6f rate=%.0f "
+        "peak_rss_kb=%ld\n",
+        type,
+        format ? format : "-",
+        entries,
+        seconds,
+        seconds > 0 ? entries / seconds : 0,
+        bench_get_peak_rss ());
+}
+
+// Reset the peak resident set size of the process, where supported
+static void bench_reset_peak_rss (void)
+{
+    FILE *fp;
+
+    // Linux allows resetting the VmHWM value, elsewhere the peak covers
+    // the whole life of the process
+    fp = g_fopen ("/proc/self/clear_refs", "w");
+    if (fp) {
+        fputs ("5", fp);
+        fclose (fp);
+    }
+}
+
+// Return the peak resident set size of the process in kilobytes
+static glong bench_get_peak_rss (void)
+{
+    struct rusage  usage;
+    gchar         *status;
+
+    if (g_file_get_contents ("/proc/self/status", &status, NULL, NULL)) {
+        gchar *line = strstr (status, "VmHWM:");
+        glong  rss = -1;
+
+        if (line)
+            rss = strtol (line + 6, NULL, 10);
+        g_free (status);
+        if (rss >= 0)
+            return rss;
+    }
+    if (getrusage (RUSAGE_SELF, &usage))
+        return -1;
+
+    return usage.ru_maxrss;
+}
+
+// A playlist has been completely read or its reading failed
+static void bench_playlist_done (PlayQueue *queue, const gchar *uri)
+{
+    g_main_loop_quit (loop);
+}
@@ -0,0 +1,356 @@
+/**
+ * PLAY
+ * play-cache.c: Cache of remote playlists
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-cache.h"
+#include "play-queue-item.h"
+
+G_DEFINE_TYPE (PlayCache, play_cache, G_TYPE_OBJECT);
+
+// Group of the cache information key file
+#define CACHE_GROUP "cache"
+
+// Return a path of a cache file of the given URI with the given suffix
+static gchar *cache_get_file (PlayCache *cache,
+                              const gchar *uri,
+                              const gchar *suffix);
+
+// Read the cache information of the given URI
+// Returns NULL if the URI is not cached
+static GKeyFile *cache_load_info (PlayCache *cache, const gchar *uri);
+
+// Write the cache information of the given URI
+static gboolean cache_save_info (PlayCache *cache,
+                                 const gchar *uri,
+                                 GKeyFile *kf);
+
+// Append a metadata line to the cached playlist, the value is converted
+// to UTF-8 and kept on a single line
+static void cache_append_meta (GString *text,
+                               const gchar *prefix,
+                               const gchar *value,
+                               const gchar *charset);
+
+// GObject/finalize
+static void play_cache_finalize (GObject *object)
+{
+    PlayCache *cache = PLAY_CACHE (object);
+
+    // Clean up
+    g_free (cache->path);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_cache_parent_class)->finalize (object);
+}
+
+// GObject/class init
+static void play_cache_class_init (PlayCacheClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->finalize = play_cache_finalize;
+}
+
+// GObject/init
+static void play_cache_init (PlayCache *cache)
+{
+    cache->path = g_build_filename (g_get_user_cache_dir (), "play", NULL);
+    cache->ttl  = PLAY_CACHE_TTL_DEFAULT;
+}
+
+// Create a new cache object
+// The cache is stored in the "play" directory of the user cache directory
+PlayCache *play_cache_new (void)
+{
+    return PLAY_CACHE (g_object_new (PLAY_TYPE_CACHE, NULL));
+}
+
+// Set the number of seconds after which a cached playlist should be
+// revalidated
+void play_cache_set_ttl (PlayCache *cache, guint ttl)
+{
+    g_return_if_fail (PLAY_IS_CACHE (cache));
+
+    cache->ttl = ttl;
+}
+
+// Look up a cached playlist of the given URI
+// Returns a path to the cached playlist in the M3U8 format or NULL if the
+// playlist is not cached, free the path with g_free()
+// The expired value is set to TRUE if the playlist should be revalidated
+gchar *play_cache_lookup (PlayCache *cache,
+                          const gchar *uri,
+                          gboolean *expired)
+{
+    GKeyFile *kf;
+    gchar    *path;
+    gint64    fetched;
+    gint64    ttl;
+
+    g_return_val_if_fail (PLAY_IS_CACHE (cache), NULL);
+    g_return_val_if_fail (uri, NULL);
+
+    kf = cache_load_info (cache, uri);
+    if (!kf)
+        return NULL;
+
+    path = cache_get_file (cache, uri, "m3u8");
+    if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+        g_key_file_free (kf);
+        g_free (path);
+        return NULL;
+    }
+    if (expired) {
+        fetched = g_key_file_get_int64 (kf, CACHE_GROUP, "fetched", NULL);
+        ttl     = g_key_file_get_int64 (kf, CACHE_GROUP, "ttl", NULL);
+
+        *expired = g_get_real_time () / G_USEC_PER_SEC - fetched >= ttl;
+    }
+    g_key_file_free (kf);
+    return path;
+}
+
+// Store the items of a playlist with the given URI in the cache
+// The GFileInfo should contain the PLAY_CACHE_ATTRIBUTES of the playlist
+// if they are known, the metadata of the items are in the given character
+// set or in UTF-8 if it is NULL
+// Returns TRUE on success
+gboolean play_cache_store (PlayCache *cache,
+                           const gchar *uri,
+                           GPtrArray *items,
+                           GFileInfo *info,
+                           const gchar *charset)
+{
+    GKeyFile *kf;
+    GString  *text;
+    gchar    *path;
+    gboolean  ret;
+    guint     i;
+
+    g_return_val_if_fail (PLAY_IS_CACHE (cache), FALSE);
+    g_return_val_if_fail (uri, FALSE);
+    g_return_val_if_fail (items, FALSE);
+
+    if (g_mkdir_with_parents (cache->path, 0700) < 0)
+        return FALSE;
+
+    // The items are stored as an extended M3U8 playlist, which is read
+    // back by the fastest of the playlist parsers, the artist and title
+    // read from ASX and XSPF playlists follow the full title in lines
+    // which other players ignore
+    text = g_string_new ("#EXTM3U\n");
+    for (i = 0; i < items->len; i++) {
+        PlayQueueItem *item = g_ptr_array_index (items, i);
+        gchar         *item_uri;
+
+        cache_append_meta (
+            text,
+            "#EXTINF:-1,",
+            play_queue_item_get_metadata (item, PLAY_METADATA_TITLE_FULL),
+            charset);
+        cache_append_meta (
+            text,
+            PLAY_CACHE_ARTIST_PREFIX,
+            play_queue_item_get_metadata (item, PLAY_METADATA_ARTIST),
+            charset);
+        cache_append_meta (
+            text,
+            PLAY_CACHE_TITLE_PREFIX,
+            play_queue_item_get_metadata (item, PLAY_METADATA_TITLE),
+            charset);
+        // The entries are stored as they were read, there is no need to
+        // resolve all of them
+        item_uri = play_queue_item_dup_location (item);
+        g_string_append (text, item_uri);
+        g_string_append_c (text, '\n');
+        g_free (item_uri);
+    }
+    path = cache_get_file (cache, uri, "m3u8");
+    ret  = g_file_set_contents (path, text->str, text->len, NULL);
+    g_string_free (text, TRUE);
+    g_free (path);
+    if (!ret)
+        return FALSE;
+
+    kf = g_key_file_new ();
+    g_key_file_set_string (kf, CACHE_GROUP, "uri", uri);
+    if (info) {
+        const gchar *etag;
+
+        etag = g_file_info_get_attribute_string (
+            info,
+            G_FILE_ATTRIBUTE_ETAG_VALUE);
+        if (etag)
+            g_key_file_set_string (kf, CACHE_GROUP, "etag", etag);
+
+        if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+            g_key_file_set_uint64 (
+                kf,
+                CACHE_GROUP, "modified",
+                g_file_info_get_attribute_uint64 (
+                    info,
+                    G_FILE_ATTRIBUTE_TIME_MODIFIED));
+    }
+    g_key_file_set_int64 (
+        kf,
+        CACHE_GROUP, "fetched",
+        g_get_real_time () / G_USEC_PER_SEC);
+    g_key_file_set_int64 (kf, CACHE_GROUP, "ttl", cache->ttl);
+
+    ret = cache_save_info (cache, uri, kf);
+    g_key_file_free (kf);
+    return ret;
+}
+
+// Compare the PLAY_CACHE_ATTRIBUTES of a remote playlist with the values
+// stored in the cache
+// Returns TRUE if the cached playlist is still valid, its validity is
+// then renewed for another TTL period
+gboolean play_cache_validate (PlayCache *cache,
+                              const gchar *uri,
+                              GFileInfo *info)
+{
+    GKeyFile *kf;
+    gboolean  valid = FALSE;
+    gchar    *etag;
+
+    g_return_val_if_fail (PLAY_IS_CACHE (cache), FALSE);
+    g_return_val_if_fail (uri, FALSE);
+    g_return_val_if_fail (G_IS_FILE_INFO (info), FALSE);
+
+    kf = cache_load_info (cache, uri);
+    if (!kf)
+        return FALSE;
+
+    // Prefer the entity tag, the modification time is only compared if
+    // the server does not provide it
+    etag = g_key_file_get_string (kf, CACHE_GROUP, "etag", NULL);
+    if (etag) {
+        const gchar *value;
+
+        value = g_file_info_get_attribute_string (
+            info,
+            G_FILE_ATTRIBUTE_ETAG_VALUE);
+        valid = value && !strcmp (value, etag);
+        g_free (etag);
+    } else if (g_key_file_has_key (kf, CACHE_GROUP, "modified", NULL) &&
+               g_file_info_has_attribute (
+                   info,
+                   G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+        guint64 modified;
+
+        modified = g_key_file_get_uint64 (kf, CACHE_GROUP, "modified", NULL);
+        valid = modified == g_file_info_get_attribute_uint64 (
+            info,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    }
+    if (valid) {
+        g_key_file_set_int64 (
+            kf,
+            CACHE_GROUP, "fetched",
+            g_get_real_time () / G_USEC_PER_SEC);
+        g_key_file_set_int64 (kf, CACHE_GROUP, "ttl", cache->ttl);
+
+        cache_save_info (cache, uri, kf);
+    }
+    g_key_file_free (kf);
+    return valid;
+}
+
+// Return a path of a cache file of the given URI with the given suffix
+static gchar *cache_get_file (PlayCache *cache,
+                              const gchar *uri,
+                              const gchar *suffix)
+{
+    gchar *checksum;
+    gchar *name;
+    gchar *path;
+
+    // Name the files by a hash of the URI as it may contain any characters
+    checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, uri, -1);
+    name = g_strconcat (checksum, ".", suffix, NULL);
+    path = g_build_filename (cache->path, name, NULL);
+
+    g_free (checksum);
+    g_free (name);
+    return path;
+}
+
+// Read the cache information of the given URI
+// Returns NULL if the URI is not cached
+static GKeyFile *cache_load_info (PlayCache *cache, const gchar *uri)
+{
+    GKeyFile *kf;
+    gchar    *path;
+    gchar    *value;
+    gboolean  ret;
+
+    path = cache_get_file (cache, uri, "info");
+    kf = g_key_file_new ();
+    ret = g_key_file_load_from_file (kf, path, G_KEY_FILE_NONE, NULL);
+    g_free (path);
+    if (!ret) {
+        g_key_file_free (kf);
+        return NULL;
+    }
+    // Make sure the file belongs to the URI
+    value = g_key_file_get_string (kf, CACHE_GROUP, "uri", NULL);
+    if (!value || strcmp (value, uri)) {
+        g_key_file_free (kf);
+        g_free (value);
+        return NULL;
+    }
+    g_free (value);
+    return kf;
+}
+
+// Write the cache information of the given URI
+static gboolean cache_save_info (PlayCache *cache,
+                                 const gchar *uri,
+                                 GKeyFile *kf)
+{
+    gchar    *data;
+    gchar    *path;
+    gsize     length;
+    gboolean  ret;
+
+    data = g_key_file_to_data (kf, &length, NULL);
+    path = cache_get_file (cache, uri, "info");
+    ret  = g_file_set_contents (path, data, length, NULL);
+
+    g_free (data);
+    g_free (path);
+    return ret;
+}
+
+// Append a metadata line to the cached playlist, the value is converted
+// to UTF-8 and kept on a single line
+static void cache_append_meta (GString *text,
+                               const gchar *prefix,
+                               const gchar *value,
+                               const gchar *charset)
+{
+    gchar *converted = NULL;
+    gsize  length;
+
+    if (!value)
+        return;
+
+    if (charset && g_ascii_strcasecmp (charset, "UTF-8")) {
+        converted = g_convert (value, -1, "UTF-8", charset, NULL, NULL, NULL);
+        if (!converted)
+            return;
+
+        value = converted;
+    }
+    g_string_append (text, prefix);
+
+    length = text->len;
+    g_string_append (text, value);
+    g_strdelimit (text->str + length, "\r\n", ' ');
+    g_string_append_c (text, '\n');
+
+    g_free (converted);
+}
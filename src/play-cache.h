@@ -0,0 +1,87 @@
+/**
+ * PLAY
+ * play-cache.h: Cache of remote playlists
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#ifndef _PLAY_CACHE_H_
+#define _PLAY_CACHE_H_
+
+#include "play-common.h"
+
+G_BEGIN_DECLS
+
+#define PLAY_TYPE_CACHE                     \
+    (play_cache_get_type())
+#define PLAY_CACHE(o)                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((o), PLAY_TYPE_CACHE, PlayCache))
+#define PLAY_CACHE_CLASS(k)                 \
+    (G_TYPE_CHECK_CLASS_CAST((k), PLAY_TYPE_CACHE, PlayCacheClass))
+#define PLAY_IS_CACHE(o)                    \
+    (G_TYPE_CHECK_INSTANCE_TYPE((o), PLAY_TYPE_CACHE))
+#define PLAY_IS_CACHE_CLASS(k)              \
+    (G_TYPE_CHECK_CLASS_TYPE((k), PLAY_TYPE_CACHE))
+#define PLAY_CACHE_GET_CLASS(o)             \
+    (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_CACHE, PlayCacheClass))
+
+// File attributes used to find out whether a remote playlist has changed
+#define PLAY_CACHE_ATTRIBUTES                                       \
+    G_FILE_ATTRIBUTE_ETAG_VALUE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+// Number of seconds a cached playlist is used without revalidation
+#define PLAY_CACHE_TTL_DEFAULT 3600
+
+// Prefixes of the lines storing the artist and title of an item in
+// a cached playlist
+#define PLAY_CACHE_ARTIST_PREFIX "#PLAY-ARTIST:"
+#define PLAY_CACHE_TITLE_PREFIX  "#PLAY-TITLE:"
+
+typedef struct {
+    GObject        parent_instance;
+    gchar         *path;
+    guint          ttl;
+} PlayCache;
+
+typedef struct {
+    GObjectClass   parent_class;
+} PlayCacheClass;
+
+extern GType play_cache_get_type (void);
+
+// Create a new cache object
+// The cache is stored in the "play" directory of the user cache directory
+extern PlayCache *play_cache_new (void);
+
+// Set the number of seconds after which a cached playlist should be
+// revalidated
+extern void play_cache_set_ttl (PlayCache *cache, guint ttl);
+
+// Look up a cached playlist of the given URI
+// Returns a path to the cached playlist in the M3U8 format or NULL if the
+// playlist is not cached, free the path with g_free()
+// The expired value is set to TRUE if the playlist should be revalidated
+extern gchar *play_cache_lookup (PlayCache *cache,
+                                 const gchar *uri,
+                                 gboolean *expired);
+
+// Store the items of a playlist with the given URI in the cache
+// The GFileInfo should contain the PLAY_CACHE_ATTRIBUTES of the playlist
+// if they are known, the metadata of the items are in the given character
+// set or in UTF-8 if it is NULL
+// Returns TRUE on success
+extern gboolean play_cache_store (PlayCache *cache,
+                                  const gchar *uri,
+                                  GPtrArray *items,
+                                  GFileInfo *info,
+                                  const gchar *charset);
+
+// Compare the PLAY_CACHE_ATTRIBUTES of a remote playlist with the values
+// stored in the cache
+// Returns TRUE if the cached playlist is still valid, its validity is
+// then renewed for another TTL period
+extern gboolean play_cache_validate (PlayCache *cache,
+                                     const gchar *uri,
+                                     GFileInfo *info);
+
+G_END_DECLS
+
+#endif // _PLAY_CACHE_H_
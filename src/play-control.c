@@ -0,0 +1,508 @@
+/**
+ * PLAY
+ * play-control.c: Control of the player through a Unix domain socket
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-control.h"
+
+#include <gio/gunixsocketaddress.h>
+
+G_DEFINE_TYPE (PlayControl, play_control, G_TYPE_OBJECT);
+
+// Maximum length of a command line including the newline, a client
+// sending a longer line is disconnected
+#define CONTROL_LINE_MAX 4096
+
+// Connected client
+typedef struct {
+    guint               id;
+    PlayControl        *control;
+    GSocketConnection  *connection;
+    GDataInputStream   *input;
+    GCancellable       *cancellable;
+    GString            *pending;
+    GString            *sending;
+    gboolean            reading;
+    gboolean            closed;
+} PlayControlClient;
+
+// A new client has connected to the socket
+static gboolean control_incoming (GSocketService *service,
+                                  GSocketConnection *connection,
+                                  GObject *source,
+                                  PlayControl *control);
+
+// Return TRUE if a process is accepting connections on the socket at
+// the given path
+static gboolean control_socket_is_alive (GSocketAddress *address);
+
+// Process the complete command lines received from a client and wait
+// for more data
+static void control_read (PlayControlClient *client);
+
+// Function called after more data has been received from a client
+static void control_read_finished (GObject *source,
+                                   GAsyncResult *result,
+                                   PlayControlClient *client);
+
+// Parse a command line and announce the command
+static void control_process_line (PlayControlClient *client, gchar *line);
+
+// Write the waiting replies of a client
+static void control_write (PlayControlClient *client);
+
+// Function called after a reply has been written to a client
+static void control_write_finished (GObject *source,
+                                    GAsyncResult *result,
+                                    PlayControlClient *client);
+
+// Disconnect a client, the data is freed once the pending operations
+// finish
+static void control_close (PlayControlClient *client);
+
+// Free a disconnected client unless an operation is still pending
+static void control_release (PlayControlClient *client);
+
+// Free memory allocated for a client
+static void control_free_client (PlayControlClient *client);
+
+// Signals
+enum {
+    COMMAND,
+    LAST_SIGNAL
+};
+static guint signals[LAST_SIGNAL];
+
+// GObject/dispose
+static void play_control_dispose (GObject *object)
+{
+    PlayControl *control = PLAY_CONTROL (object);
+
+    if (control->service) {
+        g_socket_service_stop (control->service);
+        g_socket_listener_close (G_SOCKET_LISTENER (control->service));
+        g_object_unref (control->service);
+        control->service = NULL;
+
+        // Remove the socket file, it would be replaced by the next
+        // instance anyway
+        g_unlink (control->path);
+    }
+    if (control->clients) {
+        GList *clients = g_hash_table_get_values (control->clients);
+        GList *l;
+
+        for (l = clients; l; l = l->next)
+            control_close (l->data);
+
+        g_list_free (clients);
+    }
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_control_parent_class)->dispose (object);
+}
+
+// GObject/finalize
+static void play_control_finalize (GObject *object)
+{
+    PlayControl *control = PLAY_CONTROL (object);
+
+    // Clean up
+    g_hash_table_destroy (control->clients);
+    g_free (control->path);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_control_parent_class)->finalize (object);
+}
+
+// GObject/class init
+static void play_control_class_init (PlayControlClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->dispose  = play_control_dispose;
+    gobject_class->finalize = play_control_finalize;
+
+    signals[COMMAND] =
+        g_signal_new ("command",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayControlClass, command),
+                      NULL,
+                      NULL,
+                      play_marshal_VOID__UINT_STRING_STRING,
+                      G_TYPE_NONE,
+                      3,
+                      G_TYPE_UINT,
+                      G_TYPE_STRING,
+                      G_TYPE_STRING);
+}
+
+// GObject/init
+static void play_control_init (PlayControl *control)
+{
+    control->id_next = 1;
+
+    // Connected clients indexed by their IDs
+    control->clients = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+// Create a new control object
+PlayControl *play_control_new (void)
+{
+    return PLAY_CONTROL (g_object_new (PLAY_TYPE_CONTROL, NULL));
+}
+
+// Start accepting clients on a Unix domain socket at the given path
+// A stale socket left at the path is replaced, a socket of a running
+// process is reported as an error
+// Returns TRUE on success
+gboolean play_control_listen (PlayControl *control,
+                              const gchar *path,
+                              GError **error)
+{
+    GSocketAddress *address;
+    gboolean        ret;
+    struct stat     st;
+
+    g_return_val_if_fail (PLAY_IS_CONTROL (control), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+    g_return_val_if_fail (control->service == NULL, FALSE);
+
+    address = g_unix_socket_address_new (path);
+
+    // Binding fails if the file exists, a socket left behind by a killed
+    // process is removed, other files are kept and reported
+    if (g_stat (path, &st) == 0 && S_ISSOCK (st.st_mode)) {
+        if (control_socket_is_alive (address)) {
+            g_set_error (
+                error,
+                G_IO_ERROR,
+                G_IO_ERROR_ADDRESS_IN_USE,
+                "Another instance is already running on the socket %s",
+                path);
+            g_object_unref (address);
+            return FALSE;
+        }
+        g_unlink (path);
+    }
+    control->service = g_socket_service_new ();
+
+    ret = g_socket_listener_add_address (
+        G_SOCKET_LISTENER (control->service),
+        address,
+        G_SOCKET_TYPE_STREAM,
+        G_SOCKET_PROTOCOL_DEFAULT,
+        NULL,
+        NULL,
+        error);
+    g_object_unref (address);
+    if (!ret) {
+        g_object_unref (control->service);
+        control->service = NULL;
+        return FALSE;
+    }
+    control->path = g_strdup (path);
+
+    g_signal_connect (
+        control->service,
+        "incoming",
+        G_CALLBACK (control_incoming),
+        control);
+
+    g_socket_service_start (control->service);
+    return TRUE;
+}
+
+// Send a line to a client, the line is written in the background
+// Replies to clients which have disconnected are ignored
+void play_control_reply (PlayControl *control,
+                         guint client,
+                         const gchar *format,
+                         ...)
+{
+    PlayControlClient *data;
+    va_list args;
+
+    g_return_if_fail (PLAY_IS_CONTROL (control));
+    g_return_if_fail (format != NULL);
+
+    data = g_hash_table_lookup (control->clients, GUINT_TO_POINTER (client));
+    if (!data || data->closed)
+        return;
+
+    va_start (args, format);
+    g_string_append_vprintf (data->pending, format, args);
+    va_end (args);
+
+    g_string_append_c (data->pending, '\n');
+    control_write (data);
+}
+
+// A new client has connected to the socket
+static gboolean control_incoming (GSocketService *service,
+                                  GSocketConnection *connection,
+                                  GObject *source,
+                                  PlayControl *control)
+{
+    PlayControlClient *client;
+
+    client = g_slice_new0 (PlayControlClient);
+    client->id = control->id_next++;
+    client->control = control;
+    client->connection = g_object_ref (connection);
+    client->cancellable = g_cancellable_new ();
+    client->pending = g_string_new (NULL);
+    client->sending = g_string_new (NULL);
+
+    client->input = g_data_input_stream_new (
+        g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+    g_data_input_stream_set_newline_type (
+        client->input,
+        G_DATA_STREAM_NEWLINE_TYPE_LF);
+
+    // The buffer is not allowed to grow, so it holds at most one line
+    g_buffered_input_stream_set_buffer_size (
+        G_BUFFERED_INPUT_STREAM (client->input),
+        CONTROL_LINE_MAX);
+
+    g_hash_table_insert (
+        control->clients,
+        GUINT_TO_POINTER (client->id),
+        client);
+
+    control_read (client);
+
+    // Return FALSE to let other handlers see the connection
+    return FALSE;
+}
+
+// Return TRUE if a process is accepting connections on the socket at
+// the given path
+static gboolean control_socket_is_alive (GSocketAddress *address)
+{
+    GSocketClient     *socket_client;
+    GSocketConnection *connection;
+    GError            *error = NULL;
+    gboolean           alive = TRUE;
+
+    socket_client = g_socket_client_new ();
+    connection = g_socket_client_connect (
+        socket_client,
+        G_SOCKET_CONNECTABLE (address),
+        NULL,
+        &error);
+    if (connection)
+        g_object_unref (connection);
+    else {
+        // Nobody listens on a socket left behind by a killed process,
+        // other errors do not prove that the socket is unused
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED))
+            alive = FALSE;
+
+        g_error_free (error);
+    }
+    g_object_unref (socket_client);
+    return alive;
+}
+
+// Process the complete command lines received from a client and wait
+// for more data
+static void control_read (PlayControlClient *client)
+{
+    GBufferedInputStream *buffered = G_BUFFERED_INPUT_STREAM (client->input);
+
+    while (!client->closed) {
+        const gchar *data;
+        gsize        available;
+        gchar       *line;
+
+        data = g_buffered_input_stream_peek_buffer (buffered, &available);
+        if (!available || !memchr (data, '\n', available)) {
+            if (available < CONTROL_LINE_MAX)
+                break;
+
+            // The line does not fit in the buffer
+            control_close (client);
+            break;
+        }
+        // The line is complete, so reading it does not block
+        line = g_data_input_stream_read_line (
+            client->input,
+            NULL,
+            NULL,
+            NULL);
+        if (!line)
+            break;
+
+        control_process_line (client, line);
+        g_free (line);
+    }
+    // The client might have been disconnected in the meantime
+    if (client->closed) {
+        control_release (client);
+        return;
+    }
+    client->reading = TRUE;
+
+    g_buffered_input_stream_fill_async (
+        buffered,
+        -1,
+        G_PRIORITY_DEFAULT,
+        client->cancellable,
+        (GAsyncReadyCallback) control_read_finished,
+        client);
+}
+
+// Function called after more data has been received from a client
+static void control_read_finished (GObject *source,
+                                   GAsyncResult *result,
+                                   PlayControlClient *client)
+{
+    gssize count;
+
+    client->reading = FALSE;
+
+    count = g_buffered_input_stream_fill_finish (
+        G_BUFFERED_INPUT_STREAM (source),
+        result,
+        NULL);
+    if (count <= 0) {
+        // End of the stream, an error or the control object is being
+        // destroyed
+        if (!client->closed)
+            control_close (client);
+
+        control_release (client);
+        return;
+    }
+    control_read (client);
+}
+
+// Parse a command line and announce the command
+static void control_process_line (PlayControlClient *client, gchar *line)
+{
+    gchar *command;
+    gchar *argument = NULL;
+    gchar *p;
+
+    command = g_strstrip (line);
+    if (!*command)
+        return;
+
+    // The command is separated from its argument by white space
+    for (p = command; *p && !g_ascii_isspace (*p); p++)
+        *p = g_ascii_tolower (*p);
+
+    if (*p) {
+        *p = '\0';
+        argument = g_strchug (p + 1);
+    }
+    g_signal_emit (
+        client->control,
+        signals[COMMAND],
+        0,
+        client->id,
+        command,
+        argument);
+}
+
+// Write the waiting replies of a client
+static void control_write (PlayControlClient *client)
+{
+    GOutputStream *output;
+
+    // A write is in progress, the waiting data follow when it finishes
+    if (client->sending->len)
+        return;
+    if (!client->pending->len)
+        return;
+
+    g_string_append_len (
+        client->sending,
+        client->pending->str,
+        client->pending->len);
+    g_string_truncate (client->pending, 0);
+
+    output = g_io_stream_get_output_stream (G_IO_STREAM (client->connection));
+    g_output_stream_write_async (
+        output,
+        client->sending->str,
+        client->sending->len,
+        G_PRIORITY_DEFAULT,
+        client->cancellable,
+        (GAsyncReadyCallback) control_write_finished,
+        client);
+}
+
+// Function called after a reply has been written to a client
+static void control_write_finished (GObject *source,
+                                    GAsyncResult *result,
+                                    PlayControlClient *client)
+{
+    gssize written;
+
+    written = g_output_stream_write_finish (
+        G_OUTPUT_STREAM (source),
+        result,
+        NULL);
+    if (written < 0 || client->closed) {
+        g_string_truncate (client->sending, 0);
+        if (!client->closed)
+            control_close (client);
+
+        control_release (client);
+        return;
+    }
+    g_string_erase (client->sending, 0, written);
+
+    if (client->sending->len) {
+        // Continue with the rest of a partial write
+        g_output_stream_write_async (
+            G_OUTPUT_STREAM (source),
+            client->sending->str,
+            client->sending->len,
+            G_PRIORITY_DEFAULT,
+            client->cancellable,
+            (GAsyncReadyCallback) control_write_finished,
+            client);
+    } else
+        control_write (client);
+}
+
+// Disconnect a client, the data is freed once the pending operations
+// finish
+static void control_close (PlayControlClient *client)
+{
+    client->closed = TRUE;
+
+    g_hash_table_remove (
+        client->control->clients,
+        GUINT_TO_POINTER (client->id));
+
+    // The pending read and write operations finish with an error
+    g_cancellable_cancel (client->cancellable);
+    g_io_stream_close (G_IO_STREAM (client->connection), NULL, NULL);
+}
+
+// Free a disconnected client unless an operation is still pending
+static void control_release (PlayControlClient *client)
+{
+    if (client->reading || client->sending->len)
+        return;
+
+    control_free_client (client);
+}
+
+// Free memory allocated for a client
+static void control_free_client (PlayControlClient *client)
+{
+    g_object_unref (client->input);
+    g_object_unref (client->connection);
+    g_object_unref (client->cancellable);
+    g_string_free (client->pending, TRUE);
+    g_string_free (client->sending, TRUE);
+
+    g_slice_free (PlayControlClient, client);
+}
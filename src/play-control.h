@@ -0,0 +1,73 @@
+/**
+ * PLAY
+ * play-control.h: Control of the player through a Unix domain socket
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#ifndef _PLAY_CONTROL_H_
+#define _PLAY_CONTROL_H_
+
+#include "play-common.h"
+
+G_BEGIN_DECLS
+
+// Name of the control socket in the user runtime directory
+#define PLAY_CONTROL_SOCKET_NAME "play.sock"
+
+#define PLAY_TYPE_CONTROL                     \
+    (play_control_get_type())
+#define PLAY_CONTROL(o)                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((o), PLAY_TYPE_CONTROL, PlayControl))
+#define PLAY_CONTROL_CLASS(k)                 \
+    (G_TYPE_CHECK_CLASS_CAST((k), PLAY_TYPE_CONTROL, PlayControlClass))
+#define PLAY_IS_CONTROL(o)                    \
+    (G_TYPE_CHECK_INSTANCE_TYPE((o), PLAY_TYPE_CONTROL))
+#define PLAY_IS_CONTROL_CLASS(k)              \
+    (G_TYPE_CHECK_CLASS_TYPE((k), PLAY_TYPE_CONTROL))
+#define PLAY_CONTROL_GET_CLASS(o)             \
+    (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_CONTROL, PlayControlClass))
+
+typedef struct {
+    GObject          parent_instance;
+    guint            id_next;
+    gchar           *path;
+    GSocketService  *service;
+    GHashTable      *clients;
+} PlayControl;
+
+typedef struct {
+    GObjectClass     parent_class;
+
+    // Signals
+    // A command line has been received from a client, the argument is
+    // NULL if the command has none
+    // Use play_control_reply() to answer the client
+    void (*command) (PlayControl *control,
+                     guint client,
+                     const gchar *command,
+                     const gchar *argument,
+                     gpointer user_data);
+} PlayControlClass;
+
+extern GType play_control_get_type (void);
+
+// Create a new control object
+extern PlayControl *play_control_new (void);
+
+// Start accepting clients on a Unix domain socket at the given path
+// A stale socket left at the path is replaced, a socket of a running
+// process is reported as an error
+// Returns TRUE on success
+extern gboolean play_control_listen (PlayControl *control,
+                                     const gchar *path,
+                                     GError **error);
+
+// Send a line to a client, the line is written in the background
+// Replies to clients which have disconnected are ignored
+extern void play_control_reply (PlayControl *control,
+                                guint client,
+                                const gchar *format,
+                                ...) G_GNUC_PRINTF (3, 4);
+
+G_END_DECLS
+
+#endif // _PLAY_CONTROL_H_
@@ -5,9 +5,13 @@
  */
 #include "play-common.h"
 #include "play-downloader.h"
+#include "play-stats.h"
 
 G_DEFINE_TYPE (PlayDownloader, play_downloader, G_TYPE_OBJECT);
 
+// Number of bytes read at once in a stream download
+#define DOWNLOADER_CHUNK_SIZE (64 * 1024)
+
 typedef struct {
     guint           id;
     PlayDownloader *downloader;
@@ -15,6 +19,18 @@ typedef struct {
     GFile          *destination;
     GCancellable   *cancellable;
     gpointer        custom;
+    gint            priority;
+    gchar          *host;
+    gboolean        started;
+    gboolean        connected;
+    gint64          activity;
+    guint           timeout;
+    GInputStream   *stream;
+    GFileInfo      *info;
+    GByteArray     *buffer;
+    guint64         current_bytes;
+    guint64         total_bytes;
+    gint64          time_started;
 } PlayDownloaderData;
 
 // Internal function to initiate a file download and return an ID of
@@ -24,6 +40,32 @@ static guint downloader_download (PlayDownloader *downloader,
                                   GFile *destination,
                                   gpointer custom);
 
+// Schedule starting of the waiting downloads
+static void downloader_schedule (PlayDownloader *downloader);
+
+// Start as many waiting downloads as the limits allow
+static gboolean downloader_schedule_idle (PlayDownloader *downloader);
+
+// Start a download which has been waiting in the queue
+static void downloader_start (PlayDownloaderData *data);
+
+// Note that a download has made progress and watch for a timeout
+static void downloader_activity (PlayDownloaderData *data);
+
+// Timeout callback, fail the download if it has not made progress in time
+static gboolean downloader_timeout (PlayDownloaderData *data);
+
+// Release the slot of a completed download and delete its data
+static void downloader_done (PlayDownloaderData *data);
+
+// Helper sorting function used to order the waiting downloads
+static gint downloader_compare (PlayDownloaderData *a,
+                                PlayDownloaderData *b,
+                                gpointer user_data);
+
+// Return the host name part of a URI or NULL if there is none
+static gchar *downloader_get_host (const gchar *uri);
+
 // Download progress callback
 static void downloader_progress (goffset current_bytes,
                                  goffset total_bytes,
@@ -34,6 +76,27 @@ static void downloader_finished (GObject *source,
                                  GAsyncResult *result,
                                  PlayDownloaderData *data);
 
+// Function called after a stream download has been opened
+static void downloader_stream_opened (GObject *source,
+                                      GAsyncResult *result,
+                                      PlayDownloaderData *data);
+
+// Function called after the size of a stream download has been queried
+static void downloader_stream_info (GObject *source,
+                                    GAsyncResult *result,
+                                    PlayDownloaderData *data);
+
+// Read the next chunk of a stream download
+static void downloader_stream_read (PlayDownloaderData *data);
+
+// Function called after a chunk of a stream download has been read
+static void downloader_stream_chunk (GObject *source,
+                                     GAsyncResult *result,
+                                     PlayDownloaderData *data);
+
+// Report a failed download and delete its data
+static void downloader_failed (PlayDownloaderData *data, GError *error);
+
 // Internal function to cancel a download when destroying the downloader
 static void downloader_cancel (gpointer key, PlayDownloaderData *data);
 
@@ -43,6 +106,7 @@ static void downloader_free_data (PlayDownloaderData *data);
 // Signals
 enum {
     PROGRESS,
+    DATA,
     FINISHED,
     FAILED,
     LAST_SIGNAL
@@ -55,11 +119,16 @@ static void play_downloader_finalize (GObject *object)
     PlayDownloader *downloader = PLAY_DOWNLOADER (object);
 
     // Clean up
+    if (downloader->schedule)
+        g_source_remove (downloader->schedule);
+
     g_hash_table_foreach (
       downloader->data,
       (GHFunc) downloader_cancel,
       NULL);
+    g_queue_free (downloader->waiting);
     g_hash_table_destroy (downloader->data);
+    g_hash_table_destroy (downloader->hosts);
 
     // Chain up to the parent class
     G_OBJECT_CLASS (play_downloader_parent_class)->finalize (object);
@@ -87,6 +156,19 @@ static void play_downloader_class_init (PlayDownloaderClass *klass)
                       G_TYPE_UINT64,
                       G_TYPE_UINT64,
                       G_TYPE_POINTER);
+    signals[DATA] =
+        g_signal_new ("data",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayDownloaderClass, data),
+                      NULL,
+                      NULL,
+                      play_marshal_VOID__UINT_POINTER_POINTER,
+                      G_TYPE_NONE,
+                      3,
+                      G_TYPE_UINT,
+                      G_TYPE_POINTER,
+                      G_TYPE_POINTER);
     signals[FINISHED] =
         g_signal_new ("finished",
                       G_TYPE_FROM_CLASS (gobject_class),
@@ -124,6 +206,21 @@ static void play_downloader_init (PlayDownloader *downloader)
         NULL,
         (GDestroyNotify) downloader_free_data);
 
+    // Downloads waiting to be started and the number of running downloads
+    // for each host
+    downloader->waiting = g_queue_new ();
+    downloader->hosts = g_hash_table_new_full (
+        g_str_hash,
+        g_str_equal,
+        g_free,
+        NULL);
+
+    downloader->max_downloads      = PLAY_DOWNLOADER_MAX_DOWNLOADS;
+    downloader->max_downloads_host = PLAY_DOWNLOADER_MAX_DOWNLOADS_HOST;
+    downloader->timeout_connect    = PLAY_DOWNLOADER_TIMEOUT_CONNECT;
+    downloader->timeout_read       = PLAY_DOWNLOADER_TIMEOUT_READ;
+    downloader->io_priority        = G_PRIORITY_DEFAULT;
+
     // Initial ID
     downloader->id_next = 1;
 }
@@ -197,6 +294,50 @@ guint play_downloader_download_temp (PlayDownloader *downloader,
     return id;
 }
 
+// Download a file without storing it, the content is delivered in chunks
+// by the "data" signal as it is being received
+// Returns a download ID
+guint play_downloader_download_stream (PlayDownloader *downloader,
+                                       const gchar *uri,
+                                       gpointer custom)
+{
+    GFile *source;
+    guint  id;
+
+    g_return_val_if_fail (PLAY_IS_DOWNLOADER (downloader), 0);
+    g_return_val_if_fail (uri, 0);
+
+    source = g_file_new_for_uri (uri);
+
+    // A download without a destination is a stream download
+    id = downloader_download (downloader, source, NULL, custom);
+    if (!id)
+        g_object_unref (source);
+
+    return id;
+}
+
+// Retrieve information about the file of an ongoing stream download
+// The information includes the size, entity tag and modification time
+// if they are known and it is available until the "finished" signal
+// handlers return
+// Returns NULL if the information is not known
+GFileInfo *play_downloader_get_info (PlayDownloader *downloader, guint id)
+{
+    PlayDownloaderData *data;
+
+    g_return_val_if_fail (PLAY_IS_DOWNLOADER (downloader), NULL);
+    g_return_val_if_fail (id, NULL); // starts at 1
+
+    data = g_hash_table_lookup (
+        downloader->data,
+        GUINT_TO_POINTER (id));
+    if (!data)
+        return NULL;
+
+    return data->info;
+}
+
 // Cancel an ongoing download specified by the download ID
 // Returns TRUE on success
 gboolean play_downloader_cancel (PlayDownloader *downloader, guint id)
@@ -212,11 +353,93 @@ gboolean play_downloader_cancel (PlayDownloader *downloader, guint id)
     if (!data)
         return FALSE;
 
+    if (!data->started) {
+        // The download is still waiting, there is no operation to cancel
+        g_queue_remove (downloader->waiting, data);
+        if (data->destination)
+            g_file_delete (data->destination, NULL, NULL);
+
+        g_hash_table_remove (downloader->data, GUINT_TO_POINTER (id));
+        return TRUE;
+    }
     g_cancellable_cancel (data->cancellable);
-    g_file_delete (data->destination, NULL, NULL);
+    if (data->destination)
+        g_file_delete (data->destination, NULL, NULL);
     return TRUE;
 }
 
+// Set the priority of a download specified by the download ID
+// Downloads are started in the order of their priority, lower values
+// first, and downloads with the same priority in the order they were
+// requested in
+// Returns TRUE on success
+gboolean play_downloader_set_priority (PlayDownloader *downloader,
+                                       guint id,
+                                       gint priority)
+{
+    PlayDownloaderData *data;
+
+    g_return_val_if_fail (PLAY_IS_DOWNLOADER (downloader), FALSE);
+    g_return_val_if_fail (id, FALSE); // starts at 1
+
+    data = g_hash_table_lookup (
+        downloader->data,
+        GUINT_TO_POINTER (id));
+    if (!data)
+        return FALSE;
+
+    data->priority = priority;
+
+    // Move a waiting download to its new place in the queue
+    if (!data->started) {
+        g_queue_remove (downloader->waiting, data);
+        g_queue_insert_sorted (
+            downloader->waiting,
+            data,
+            (GCompareDataFunc) downloader_compare,
+            NULL);
+    }
+    return TRUE;
+}
+
+// Set the GIO priority of the I/O operations of all downloads, such as
+// G_PRIORITY_LOW for downloads running in the background
+void play_downloader_set_io_priority (PlayDownloader *downloader,
+                                      gint io_priority)
+{
+    g_return_if_fail (PLAY_IS_DOWNLOADER (downloader));
+
+    downloader->io_priority = io_priority;
+}
+
+// Set the maximum number of downloads running at the same time in total
+// and from a single host, use 0 for no limit
+void play_downloader_set_max_downloads (PlayDownloader *downloader,
+                                        guint max_downloads,
+                                        guint max_downloads_host)
+{
+    g_return_if_fail (PLAY_IS_DOWNLOADER (downloader));
+
+    downloader->max_downloads      = max_downloads;
+    downloader->max_downloads_host = max_downloads_host;
+
+    // Higher limits may allow more downloads to start
+    downloader_schedule (downloader);
+}
+
+// Set the number of seconds to wait for a connection to be established
+// and for more data to arrive before a download fails, use 0 to wait
+// indefinitely
+void play_downloader_set_timeouts (PlayDownloader *downloader,
+                                   guint timeout_connect,
+                                   guint timeout_read)
+{
+    g_return_if_fail (PLAY_IS_DOWNLOADER (downloader));
+
+    downloader->timeout_connect = timeout_connect;
+    downloader->timeout_read    = timeout_read;
+}
+
 // Internal function to initiate a file download and return an ID of
 // the download
 static guint downloader_download (PlayDownloader *downloader,
@@ -225,10 +448,11 @@ static guint downloader_download (PlayDownloader *downloader,
                                   gpointer custom)
 {
     PlayDownloaderData *data;
+    gchar              *uri;
 
     // Temporary structure passed along in callbacks, keeps the original
     // source and destination file references
-    data = g_slice_new (PlayDownloaderData);
+    data = g_slice_new0 (PlayDownloaderData);
     data->id = downloader->id_next++;
     data->source = source;
     data->destination = destination;
@@ -236,32 +460,271 @@ static guint downloader_download (PlayDownloader *downloader,
     data->downloader = downloader;
     data->custom = custom;
 
+    uri = g_file_get_uri (source);
+    data->host = downloader_get_host (uri);
+    g_free (uri);
+
     // Store the temporary data
     g_hash_table_insert (
         downloader->data,
         GUINT_TO_POINTER (data->id),
         data);
 
-    // Initiate the download
-    g_file_copy_async (
-        data->source,
-        data->destination,
-        G_FILE_COPY_OVERWRITE,
-        G_PRIORITY_DEFAULT,
-        data->cancellable,
-        (GFileProgressCallback) downloader_progress,
+    // The download is started later by the scheduler, which allows the
+    // caller to change the priority first
+    g_queue_insert_sorted (
+        downloader->waiting,
         data,
-        (GAsyncReadyCallback) downloader_finished,
-        data);
+        (GCompareDataFunc) downloader_compare,
+        NULL);
+    downloader_schedule (downloader);
 
     return data->id;
 }
 
+// Schedule starting of the waiting downloads
+static void downloader_schedule (PlayDownloader *downloader)
+{
+    if (downloader->schedule || g_queue_is_empty (downloader->waiting))
+        return;
+
+    downloader->schedule = g_idle_add (
+        (GSourceFunc) downloader_schedule_idle,
+        downloader);
+}
+
+// Start as many waiting downloads as the limits allow
+static gboolean downloader_schedule_idle (PlayDownloader *downloader)
+{
+    GList *list;
+
+    downloader->schedule = 0;
+
+    list = downloader->waiting->head;
+    while (list) {
+        PlayDownloaderData *data = list->data;
+        GList *next = list->next;
+
+        if (downloader->max_downloads &&
+            downloader->running >= downloader->max_downloads)
+            break;
+
+        // Skip the download if its host is busy and try the next one
+        if (data->host && downloader->max_downloads_host) {
+            guint count = GPOINTER_TO_UINT (g_hash_table_lookup (
+                downloader->hosts,
+                data->host));
+
+            if (count >= downloader->max_downloads_host) {
+                list = next;
+                continue;
+            }
+        }
+        g_queue_delete_link (downloader->waiting, list);
+        downloader_start (data);
+        list = next;
+    }
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Start a download which has been waiting in the queue
+static void downloader_start (PlayDownloaderData *data)
+{
+    PlayDownloader *downloader = data->downloader;
+
+    data->started = TRUE;
+    data->time_started = g_get_monotonic_time ();
+    downloader->running++;
+    if (data->host) {
+        guint count = GPOINTER_TO_UINT (g_hash_table_lookup (
+            downloader->hosts,
+            data->host));
+
+        g_hash_table_insert (
+            downloader->hosts,
+            g_strdup (data->host),
+            GUINT_TO_POINTER (count + 1));
+    }
+    // Watch for the connection timeout
+    downloader_activity (data);
+
+    if (data->destination) {
+        g_file_copy_async (
+            data->source,
+            data->destination,
+            G_FILE_COPY_OVERWRITE,
+            data->downloader->io_priority,
+            data->cancellable,
+            (GFileProgressCallback) downloader_progress,
+            data,
+            (GAsyncReadyCallback) downloader_finished,
+            data);
+    } else {
+        g_file_read_async (
+            data->source,
+            data->downloader->io_priority,
+            data->cancellable,
+            (GAsyncReadyCallback) downloader_stream_opened,
+            data);
+    }
+}
+
+// Note that a download has made progress and watch for a timeout
+// The timeout source is only re-created when it fires, which keeps the
+// cost of frequent progress updates low
+static void downloader_activity (PlayDownloaderData *data)
+{
+    guint timeout;
+
+    data->activity = g_get_monotonic_time ();
+    if (data->timeout)
+        return;
+
+    if (data->connected)
+        timeout = data->downloader->timeout_read;
+    else
+        timeout = data->downloader->timeout_connect;
+    if (timeout)
+        data->timeout = g_timeout_add_seconds (
+            timeout,
+            (GSourceFunc) downloader_timeout,
+            data);
+}
+
+// Timeout callback, fail the download if it has not made progress in time
+static gboolean downloader_timeout (PlayDownloaderData *data)
+{
+    const gchar *error;
+    gint64       deadline;
+    gint64       now;
+    guint        timeout;
+
+    data->timeout = 0;
+
+    if (data->connected)
+        timeout = data->downloader->timeout_read;
+    else
+        timeout = data->downloader->timeout_connect;
+    if (!timeout)
+        return FALSE;
+
+    // Wait for the rest of the period if there has been progress since
+    // the timeout was set
+    now = g_get_monotonic_time ();
+    deadline = data->activity + (gint64) timeout * G_USEC_PER_SEC;
+    if (now < deadline) {
+        data->timeout = g_timeout_add_seconds (
+            (guint) ((deadline - now + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC),
+            (GSourceFunc) downloader_timeout,
+            data);
+        return FALSE;
+    }
+    if (data->connected)
+        error = "Download has timed out";
+    else
+        error = "Connection has timed out";
+
+    // The data is deleted when the cancelled operation returns
+    g_cancellable_cancel (data->cancellable);
+    if (data->destination)
+        g_file_delete (data->destination, NULL, NULL);
+
+    g_signal_emit (
+        data->downloader,
+        signals[FAILED],
+        0,
+        data->id,
+        error,
+        data->custom);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Release the slot of a completed download and delete its data
+static void downloader_done (PlayDownloaderData *data)
+{
+    PlayDownloader *downloader = data->downloader;
+
+    if (data->started) {
+        PLAY_STATS_COUNT ("downloads.count", 1);
+        PLAY_STATS_COUNT ("downloads.bytes", data->current_bytes);
+        PLAY_STATS_RECORD (
+            "downloads.duration_ms",
+            (g_get_monotonic_time () - data->time_started) / 1000);
+
+        downloader->running--;
+        if (data->host) {
+            guint count = GPOINTER_TO_UINT (g_hash_table_lookup (
+                downloader->hosts,
+                data->host));
+
+            if (count > 1)
+                g_hash_table_insert (
+                    downloader->hosts,
+                    g_strdup (data->host),
+                    GUINT_TO_POINTER (count - 1));
+            else
+                g_hash_table_remove (downloader->hosts, data->host);
+        }
+    }
+    // Delete data of the current download
+    g_hash_table_remove (downloader->data, GUINT_TO_POINTER (data->id));
+
+    // Let another download take the slot
+    downloader_schedule (downloader);
+}
+
+// Helper sorting function used to order the waiting downloads
+static gint downloader_compare (PlayDownloaderData *a,
+                                PlayDownloaderData *b,
+                                gpointer user_data)
+{
+    if (a->priority != b->priority)
+        return a->priority < b->priority ? -1 : 1;
+    if (a->id != b->id)
+        return a->id < b->id ? -1 : 1;
+    return 0;
+}
+
+// Return the host name part of a URI or NULL if there is none
+static gchar *downloader_get_host (const gchar *uri)
+{
+    const gchar *start;
+    const gchar *end;
+
+    start = strstr (uri, "://");
+    if (!start)
+        return NULL;
+
+    start += 3;
+    end = start + strcspn (start, "/?#");
+
+    // Skip the user information
+    while (TRUE) {
+        const gchar *at = memchr (start, '@', end - start);
+
+        if (!at)
+            break;
+        start = at + 1;
+    }
+    if (start == end)
+        return NULL;
+
+    return g_ascii_strdown (start, end - start);
+}
+
 // Download progress callback
 static void downloader_progress (goffset current_bytes,
                                  goffset total_bytes,
                                  PlayDownloaderData *data)
 {
+    // Copying has started, the read timeout applies from now on
+    data->connected = TRUE;
+    data->current_bytes = (guint64) current_bytes;
+    downloader_activity (data);
+
     if (!g_cancellable_is_cancelled (data->cancellable))
         g_signal_emit (
             data->downloader,
@@ -285,6 +748,7 @@ static void downloader_finished (GObject *source,
         // Read the result of the download
         ret = g_file_copy_finish (G_FILE (source), result, &error);
         if (!ret) {
+            PLAY_STATS_COUNT ("downloads.failed", 1);
             g_signal_emit (
                 data->downloader,
                 signals[FAILED],
@@ -304,25 +768,181 @@ static void downloader_finished (GObject *source,
                 data->custom);
         }
     }
-    // Delete data of the current download
-    g_hash_table_remove (data->downloader->data, GUINT_TO_POINTER (data->id));
+    downloader_done (data);
+}
+
+// Function called after a stream download has been opened
+static void downloader_stream_opened (GObject *source,
+                                      GAsyncResult *result,
+                                      PlayDownloaderData *data)
+{
+    GFileInputStream *input;
+    GError *error = NULL;
+
+    input = g_file_read_finish (G_FILE (source), result, &error);
+    if (!input) {
+        downloader_failed (data, error);
+        return;
+    }
+    data->stream = G_INPUT_STREAM (input);
+    data->buffer = g_byte_array_sized_new (DOWNLOADER_CHUNK_SIZE);
+
+    // Connected, the read timeout applies from now on
+    data->connected = TRUE;
+    downloader_activity (data);
+
+    // Find out the size to be able to report the progress, for HTTP
+    // this is the content length, the other attributes can be used
+    // to find out whether the file has changed
+    g_file_input_stream_query_info_async (
+        input,
+        G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+        G_FILE_ATTRIBUTE_ETAG_VALUE ","
+        G_FILE_ATTRIBUTE_TIME_MODIFIED,
+        data->downloader->io_priority,
+        data->cancellable,
+        (GAsyncReadyCallback) downloader_stream_info,
+        data);
+}
+
+// Function called after the size of a stream download has been queried
+static void downloader_stream_info (GObject *source,
+                                    GAsyncResult *result,
+                                    PlayDownloaderData *data)
+{
+    if (g_cancellable_is_cancelled (data->cancellable)) {
+        downloader_done (data);
+        return;
+    }
+    // The information is optional, the download continues without it
+    data->info = g_file_input_stream_query_info_finish (
+        G_FILE_INPUT_STREAM (source),
+        result,
+        NULL);
+    if (data->info &&
+        g_file_info_has_attribute (data->info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
+        data->total_bytes = (guint64) g_file_info_get_size (data->info);
+    downloader_stream_read (data);
+}
+
+// Read the next chunk of a stream download
+static void downloader_stream_read (PlayDownloaderData *data)
+{
+    g_byte_array_set_size (data->buffer, DOWNLOADER_CHUNK_SIZE);
+
+    g_input_stream_read_async (
+        data->stream,
+        data->buffer->data,
+        DOWNLOADER_CHUNK_SIZE,
+        data->downloader->io_priority,
+        data->cancellable,
+        (GAsyncReadyCallback) downloader_stream_chunk,
+        data);
+}
+
+// Function called after a chunk of a stream download has been read
+static void downloader_stream_chunk (GObject *source,
+                                     GAsyncResult *result,
+                                     PlayDownloaderData *data)
+{
+    GError *error = NULL;
+    gssize  size;
+
+    size = g_input_stream_read_finish (
+        G_INPUT_STREAM (source),
+        result,
+        &error);
+    if (size < 0) {
+        downloader_failed (data, error);
+        return;
+    }
+    if (size == 0) {
+        if (!g_cancellable_is_cancelled (data->cancellable))
+            g_signal_emit (
+                data->downloader,
+                signals[FINISHED],
+                0,
+                data->id,
+                NULL,
+                data->custom);
+
+        downloader_done (data);
+        return;
+    }
+    g_byte_array_set_size (data->buffer, (guint) size);
+
+    data->current_bytes += size;
+    // The reported size might be wrong or unknown
+    if (data->total_bytes < data->current_bytes)
+        data->total_bytes = data->current_bytes;
+
+    if (!g_cancellable_is_cancelled (data->cancellable))
+        g_signal_emit (
+            data->downloader,
+            signals[DATA],
+            0,
+            data->id,
+            data->buffer,
+            data->custom);
+
+    // The download might have been cancelled by a handler of the data signal
+    if (g_cancellable_is_cancelled (data->cancellable)) {
+        downloader_done (data);
+        return;
+    }
+    downloader_progress (
+        (goffset) data->current_bytes,
+        (goffset) data->total_bytes,
+        data);
+
+    downloader_stream_read (data);
+}
+
+// Report a failed download and delete its data
+static void downloader_failed (PlayDownloaderData *data, GError *error)
+{
+    PLAY_STATS_COUNT ("downloads.failed", 1);
+
+    if (!g_cancellable_is_cancelled (data->cancellable))
+        g_signal_emit (
+            data->downloader,
+            signals[FAILED],
+            0,
+            data->id,
+            error->message,
+            data->custom);
+
+    g_error_free (error);
+
+    downloader_done (data);
 }
 
 // Internal function to cancel a download when destroying the downloader
 static void downloader_cancel (gpointer key, PlayDownloaderData *data)
 {
     g_cancellable_cancel (data->cancellable);
-    g_file_delete (data->destination, NULL, NULL);
+    if (data->destination)
+        g_file_delete (data->destination, NULL, NULL);
 }
 
 // Free memory allocated for a temporary data structure
 static void downloader_free_data (PlayDownloaderData *data)
 {
+    if (data->timeout)
+        g_source_remove (data->timeout);
+
     if (data->destination)
         g_object_unref (data->destination);
     if (data->source)
         g_object_unref (data->source);
-
+    if (data->stream)
+        g_object_unref (data->stream);
+    if (data->info)
+        g_object_unref (data->info);
+    if (data->buffer)
+        g_byte_array_unref (data->buffer);
+
+    g_free (data->host);
     g_object_unref (data->cancellable);
     g_slice_free (PlayDownloaderData, data);
 }
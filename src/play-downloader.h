@@ -10,6 +10,14 @@
 
 G_BEGIN_DECLS
 
+// Default maximum number of downloads running at the same time
+#define PLAY_DOWNLOADER_MAX_DOWNLOADS           4
+#define PLAY_DOWNLOADER_MAX_DOWNLOADS_HOST      2
+
+// Default number of seconds to wait for a connection and for data
+#define PLAY_DOWNLOADER_TIMEOUT_CONNECT         15
+#define PLAY_DOWNLOADER_TIMEOUT_READ            30
+
 #define PLAY_TYPE_DOWNLOADER                     \
     (play_downloader_get_type())
 #define PLAY_DOWNLOADER(o)                       \
@@ -27,6 +35,15 @@ typedef struct {
     GObject         parent_instance;
     guint           id_next;
     GHashTable     *data;
+    GQueue         *waiting;
+    GHashTable     *hosts;
+    guint           running;
+    guint           schedule;
+    guint           max_downloads;
+    guint           max_downloads_host;
+    guint           timeout_connect;
+    guint           timeout_read;
+    gint            io_priority;
 } PlayDownloader;
 
 typedef struct {
@@ -41,7 +58,16 @@ typedef struct {
                       gpointer custom,
                       gpointer user_data);
 
+    // A chunk of a stream download has been received
+    // The GByteArray is only valid during the signal emission
+    void (*data) (PlayDownloader *downloader,
+                  guint id,
+                  GByteArray *chunk,
+                  gpointer custom,
+                  gpointer user_data);
+
     // Download has finished
+    // The destination is NULL for stream downloads
     void (*finished) (PlayDownloader *downloader,
                       guint id,
                       GFile *destination,
@@ -77,6 +103,48 @@ extern guint play_downloader_download_temp (PlayDownloader *downloader,
                                             const gchar *template,
                                             gpointer data);
 
+// Download a file without storing it, the content is delivered in chunks
+// by the "data" signal as it is being received
+// Returns a download ID
+extern guint play_downloader_download_stream (PlayDownloader *downloader,
+                                              const gchar *uri,
+                                              gpointer data);
+
+// Retrieve information about the file of an ongoing stream download
+// The information includes the size, entity tag and modification time
+// if they are known and it is available until the "finished" signal
+// handlers return
+// Returns NULL if the information is not known
+extern GFileInfo *play_downloader_get_info (PlayDownloader *downloader,
+                                            guint id);
+
+// Set the priority of a download specified by the download ID
+// Downloads are started in the order of their priority, lower values
+// first, and downloads with the same priority in the order they were
+// requested in
+// Returns TRUE on success
+extern gboolean play_downloader_set_priority (PlayDownloader *downloader,
+                                              guint id,
+                                              gint priority);
+
+// Set the GIO priority of the I/O operations of all downloads, such as
+// G_PRIORITY_LOW for downloads running in the background
+extern void play_downloader_set_io_priority (PlayDownloader *downloader,
+                                             gint io_priority);
+
+// Set the maximum number of downloads running at the same time in total
+// and from a single host, use 0 for no limit
+extern void play_downloader_set_max_downloads (PlayDownloader *downloader,
+                                               guint max_downloads,
+                                               guint max_downloads_host);
+
+// Set the number of seconds to wait for a connection to be established
+// and for more data to arrive before a download fails, use 0 to wait
+// indefinitely
+extern void play_downloader_set_timeouts (PlayDownloader *downloader,
+                                          guint timeout_connect,
+                                          guint timeout_read);
+
 // Cancel an ongoing download specified by the download ID
 // Returns TRUE on success
 extern gboolean play_downloader_cancel (PlayDownloader *downloader, guint id);
@@ -6,6 +6,7 @@
 #include "play-common.h"
 #include "play-gstreamer.h"
 #include "play-queue-item.h"
+#include "play-stats.h"
 
 // This enum is not present in any header file:
 // http://gstreamer.freedesktop.org/data/doc/gstreamer/head/gst-plugins-base-plugins/html/gst-plugins-base-plugins-playbin2.html#GstPlayBin2--flags
@@ -26,6 +27,7 @@ G_DEFINE_TYPE (PlayGstreamer, play_gstreamer, G_TYPE_OBJECT);
 
 // Initialize a newly created gstreamer object
 static gboolean gstreamer_gst_initialize (PlayGstreamer *gstreamer,
+                                          const gchar *audio_sink,
                                           GError **error);
 
 // Process a metadata tag
@@ -38,6 +40,71 @@ static gboolean gstreamer_gst_bus_message (GstBus *bus,
                                            GstMessage *message,
                                            PlayGstreamer *gstreamer);
 
+// Pause the pipeline while the network stream buffer is being filled and
+// resume playing once it is full
+// Returns FALSE if the message reports the progress of a download rather
+// than the fill of the buffer
+static gboolean gstreamer_gst_buffering (PlayGstreamer *gstreamer,
+                                         GstMessage *message,
+                                         gint progress);
+
+// The current stream is about to finish, hand over the next item to
+// the playbin to allow gapless playback
+// This function is called from a GStreamer streaming thread
+static void gstreamer_gst_about_to_finish (GstElement *playbin,
+                                           PlayGstreamer *gstreamer);
+
+// Forget the item set by play_gstreamer_set_next_item()
+static void gstreamer_clear_next (PlayGstreamer *gstreamer);
+
+// Start measuring the delay until the next buffer reaches the audio sink
+// A measurement which is already in progress is kept
+static void gstreamer_latency_mark (PlayGstreamer *gstreamer,
+                                    PlayGstreamerLatency type,
+                                    gint64 time);
+
+// Watch buffers and events reaching the audio sink
+// This function is called from a GStreamer streaming thread
+static GstPadProbeReturn gstreamer_gst_sink_probe (GstPad *pad,
+                                                   GstPadProbeInfo *info,
+                                                   PlayGstreamer *gstreamer);
+
+// Start or stop watching the flow of audio data depending on whether
+// a network stream is being played
+static void gstreamer_watchdog_update (PlayGstreamer *gstreamer);
+
+// Stop watching the flow of audio data and cancel a pending reconnection
+static void gstreamer_watchdog_stop (PlayGstreamer *gstreamer);
+
+// Check that audio data keeps reaching the sink
+static gboolean gstreamer_watchdog_timeout (PlayGstreamer *gstreamer);
+
+// Drop the connection of a stalled stream and schedule a new one, or fail
+// if the attempts have run out
+static void gstreamer_stalled (PlayGstreamer *gstreamer);
+
+// Connect again to the stalled stream
+static gboolean gstreamer_reconnect_timeout (PlayGstreamer *gstreamer);
+
+// Return TRUE if the item is played over a network
+static gboolean gstreamer_is_stream (PlayQueueItem *item);
+
+// Sort function for the measured delays
+static gint gstreamer_latency_sort (gconstpointer a, gconstpointer b);
+
+// Name of the application message carrying a latency measurement
+#define GSTREAMER_LATENCY_MESSAGE "play-latency"
+
+// Return the value at the given percentile of a sorted array of delays
+#define GSTREAMER_LATENCY_PERCENTILE(values, p) \
+    g_array_index ((values), gint64, ((values)->len - 1) * (p) / 100)
+
+// Number of reconnections of a stalled stream before it fails, the first
+// one is made after the given number of seconds and the delay doubles
+// with each following one
+#define GSTREAMER_RECONNECT_ATTEMPTS 3
+#define GSTREAMER_RECONNECT_DELAY    1
+
 // Signals
 enum {
     BUFFERING,
@@ -45,9 +112,13 @@ enum {
     END_OF_STREAM,
     ERROR,
     METADATA_UPDATED,
+    POSITION_CHANGED,
     STATE_PLAYING,
     STATE_PAUSED,
     STATE_STOPPED,
+    TRACK_CHANGED,
+    LATENCY,
+    RECONNECTING,
     LAST_SIGNAL
 };
 static guint signals[LAST_SIGNAL];
@@ -74,12 +145,46 @@ void play_gstreamer_global_initialize (int *argcp, char ***argvp)
     initialized = TRUE;
 }
 
+// Print the percentiles of the delays measured for each of the
+// PLAY_GSTREAMER_LATENCY_* kinds
+// The PLAY_GSTREAMER_LATENCY_COUNT arrays hold the delays in nanoseconds,
+// they are freed and set to NULL afterwards
+void play_gstreamer_print_latency (GArray **latencies)
+{
+    static const gchar *names[] = { "start", "gap", "seek" };
+    guint i;
+
+    G_STATIC_ASSERT (G_N_ELEMENTS (names) == PLAY_GSTREAMER_LATENCY_COUNT);
+
+    // One line per kind in the key=value form, the values are in
+    // milliseconds
+    for (i = 0; i < PLAY_GSTREAMER_LATENCY_COUNT; i++) {
+        GArray *values = latencies[i];
+
+        if (values->len) {
+            g_array_sort (values, gstreamer_latency_sort);
+            g_print (
+                "latency type=%s count=%u p50=%.3f p90=%.3f p99=%.3f max=%.3f\n",
+                names[i],
+                values->len,
+                GSTREAMER_LATENCY_PERCENTILE (values, 50) / 1e6,
+                GSTREAMER_LATENCY_PERCENTILE (values, 90) / 1e6,
+                GSTREAMER_LATENCY_PERCENTILE (values, 99) / 1e6,
+                g_array_index (values, gint64, values->len - 1) / 1e6);
+        }
+        g_array_free (values, TRUE);
+        latencies[i] = NULL;
+    }
+}
+
 // GObject/finalize
 static void play_gstreamer_finalize (GObject *object)
 {
     PlayGstreamer *gstreamer = PLAY_GSTREAMER (object);
 
     // Clean up
+    gstreamer_watchdog_stop (gstreamer);
+
     if (gstreamer->pipe) {
         // Make sure the playbin is in the NULL state, otherwise the unref
         // calls would cause warnings
@@ -90,6 +195,9 @@ static void play_gstreamer_finalize (GObject *object)
     if (gstreamer->current)
         g_object_unref (gstreamer->current);
 
+    gstreamer_clear_next (gstreamer);
+    g_mutex_clear (&gstreamer->lock);
+
     // Chain up to the parent class
     G_OBJECT_CLASS (play_gstreamer_parent_class)->finalize (object);
 }
@@ -156,6 +264,16 @@ static void play_gstreamer_class_init (PlayGstreamerClass *klass)
                       2,
                       PLAY_TYPE_METADATA,
                       G_TYPE_STRING);
+    signals[POSITION_CHANGED] =
+        g_signal_new ("position-changed",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayGstreamerClass, position_changed),
+                      NULL,
+                      NULL,
+                      g_cclosure_marshal_VOID__VOID,
+                      G_TYPE_NONE,
+                      0);
     signals[STATE_PLAYING] =
         g_signal_new ("state-playing",
                       G_TYPE_FROM_CLASS (gobject_class),
@@ -186,26 +304,131 @@ static void play_gstreamer_class_init (PlayGstreamerClass *klass)
                       g_cclosure_marshal_VOID__VOID,
                       G_TYPE_NONE,
                       0);
+    signals[TRACK_CHANGED] =
+        g_signal_new ("track-changed",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayGstreamerClass, track_changed),
+                      NULL,
+                      NULL,
+                      g_cclosure_marshal_VOID__OBJECT,
+                      G_TYPE_NONE,
+                      1,
+                      PLAY_TYPE_QUEUE_ITEM);
+    signals[LATENCY] =
+        g_signal_new ("latency",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayGstreamerClass, latency),
+                      NULL,
+                      NULL,
+                      play_marshal_VOID__UINT_INT64,
+                      G_TYPE_NONE,
+                      2,
+                      G_TYPE_UINT,
+                      G_TYPE_INT64);
+    signals[RECONNECTING] =
+        g_signal_new ("reconnecting",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayGstreamerClass, reconnecting),
+                      NULL,
+                      NULL,
+                      play_marshal_VOID__UINT_UINT,
+                      G_TYPE_NONE,
+                      2,
+                      G_TYPE_UINT,
+                      G_TYPE_UINT);
 }
 
 // GObject/init
 static void play_gstreamer_init (PlayGstreamer *gstreamer)
 {
+    g_mutex_init (&gstreamer->lock);
+
+    gstreamer->latency_mark = -1;
+    gstreamer->latency_last = -1;
+
+    gstreamer->stall_timeout = PLAY_GSTREAMER_STALL_TIMEOUT;
 }
 
 // Create a new gstreamer object
-PlayGstreamer *play_gstreamer_new (GError **error)
+// The audio sink is described in the gst-launch syntax, if it is NULL the
+// default audio output is used
+PlayGstreamer *play_gstreamer_new (const gchar *audio_sink, GError **error)
 {
     PlayGstreamer *gstreamer;
 
     gstreamer = PLAY_GSTREAMER (g_object_new (PLAY_TYPE_GSTREAMER, NULL));
-    if (!gstreamer_gst_initialize (gstreamer, error)) {
+    if (!gstreamer_gst_initialize (gstreamer, audio_sink, error)) {
         g_object_unref (gstreamer);
         return NULL;
     }
     return gstreamer;
 }
 
+// Set the size of the network stream buffer in bytes and its duration in
+// nanoseconds, -1 keeps the GStreamer default
+// The values apply to the streams started afterwards
+void play_gstreamer_set_buffer (PlayGstreamer *gstreamer,
+                                gint size,
+                                gint64 duration)
+{
+    g_return_if_fail (PLAY_IS_GSTREAMER (gstreamer));
+
+    g_object_set (
+        G_OBJECT (gstreamer->playbin),
+        "buffer-size", size,
+        "buffer-duration", duration,
+        NULL);
+}
+
+// Enable or disable progressive download
+// Seekable HTTP files of the formats supported by GStreamer are then
+// downloaded to a temporary file instead of a memory buffer, playing
+// resumes sooner after seeking back and rebuffering happens less often
+void play_gstreamer_set_download (PlayGstreamer *gstreamer, gboolean download)
+{
+    guint flags;
+
+    g_return_if_fail (PLAY_IS_GSTREAMER (gstreamer));
+
+    g_object_get (G_OBJECT (gstreamer->playbin), "flags", &flags, NULL);
+    if (download)
+        flags |= GST_PLAY_FLAG_DOWNLOAD;
+    else
+        flags &= ~GST_PLAY_FLAG_DOWNLOAD;
+
+    g_object_set (G_OBJECT (gstreamer->playbin), "flags", flags, NULL);
+}
+
+// Set the number of seconds without audio data after which a playing
+// network stream is reconnected, 0 disables the reconnecting
+void play_gstreamer_set_stall_timeout (PlayGstreamer *gstreamer,
+                                       guint timeout)
+{
+    g_return_if_fail (PLAY_IS_GSTREAMER (gstreamer));
+
+    gstreamer->stall_timeout = timeout;
+    if (!timeout)
+        gstreamer_watchdog_stop (gstreamer);
+    else
+        gstreamer_watchdog_update (gstreamer);
+}
+
+// Retrieve the fill of the network stream buffer in percent
+// Returns TRUE if playing is waiting for the buffer to be filled
+gboolean play_gstreamer_get_buffering (PlayGstreamer *gstreamer,
+                                       guint *progress)
+{
+    g_return_val_if_fail (PLAY_IS_GSTREAMER (gstreamer), FALSE);
+
+    if (progress)
+        *progress = gstreamer->buffering ? gstreamer->buffering_progress : 100;
+
+    return gstreamer->buffering;
+}
+
 // Set a new queue item to be played
 // The playback should be stopped before using this function and then started
 // again to play the new track
@@ -224,11 +447,65 @@ gboolean play_gstreamer_set_item (PlayGstreamer *gstreamer, PlayQueueItem *item)
 
     g_object_set (G_OBJECT (gstreamer->playbin), "uri", uri, NULL);
 
+    // The buffering state belongs to the previous stream
+    gstreamer->buffering = FALSE;
+    gstreamer->is_live   = FALSE;
+
+    // So do the reconnection attempts
+    gstreamer_watchdog_stop (gstreamer);
+    gstreamer->stall_retries = 0;
+
+    // Measure the time until the new track is heard
+    gstreamer_latency_mark (
+        gstreamer,
+        PLAY_GSTREAMER_LATENCY_START,
+        g_get_monotonic_time ());
+
     // Remember the current queue item
     if (gstreamer->current)
         g_object_unref (gstreamer->current);
 
     gstreamer->current = g_object_ref (item);
+
+    // The next item was chosen for the previous one
+    gstreamer_clear_next (gstreamer);
+    return TRUE;
+}
+
+// Set a queue item to be played when the current one is about to finish
+// The switch happens without stopping the playback and is announced by
+// the "track-changed" signal, use NULL to unset the item
+// Returns TRUE on success
+gboolean play_gstreamer_set_next_item (PlayGstreamer *gstreamer,
+                                       PlayQueueItem *item)
+{
+    const gchar *uri = NULL;
+
+    g_return_val_if_fail (PLAY_IS_GSTREAMER (gstreamer), FALSE);
+    g_return_val_if_fail (item == NULL || PLAY_IS_QUEUE_ITEM (item), FALSE);
+
+    if (item) {
+        uri = play_queue_item_get_uri (item);
+        if (G_UNLIKELY (!uri))
+            return FALSE;
+    }
+    g_mutex_lock (&gstreamer->lock);
+
+    // Do not replace an item which has already been handed to the playbin
+    if (!gstreamer->next_set) {
+        if (gstreamer->next)
+            g_object_unref (gstreamer->next);
+        g_free (gstreamer->next_uri);
+
+        // The URI is copied as the item must not be touched from
+        // the streaming thread
+        gstreamer->next     = item ? g_object_ref (item) : NULL;
+        gstreamer->next_uri = g_strdup (uri);
+    }
+    g_mutex_unlock (&gstreamer->lock);
+
+    // The next stream may stall while the current one is finishing
+    gstreamer_watchdog_update (gstreamer);
     return TRUE;
 }
 
@@ -266,10 +543,21 @@ gboolean play_gstreamer_set_state_playing (PlayGstreamer *gstreamer)
 
     g_return_val_if_fail (PLAY_IS_GSTREAMER (gstreamer), FALSE);
 
+    gstreamer->playing = TRUE;
+    gstreamer_watchdog_update (gstreamer);
+
+    // Playing starts once the buffer is full
+    if (gstreamer->buffering)
+        return TRUE;
+
     ret = gst_element_set_state (gstreamer->pipe, GST_STATE_PLAYING);
     if (ret == GST_STATE_CHANGE_FAILURE)
         return FALSE;
 
+    // Live streams cannot be paused to fill the buffer
+    if (ret == GST_STATE_CHANGE_NO_PREROLL)
+        gstreamer->is_live = TRUE;
+
     return TRUE;
 }
 
@@ -282,10 +570,38 @@ gboolean play_gstreamer_set_state_paused (PlayGstreamer *gstreamer)
 
     g_return_val_if_fail (PLAY_IS_GSTREAMER (gstreamer), FALSE);
 
+    gstreamer->playing = FALSE;
+    gstreamer_watchdog_stop (gstreamer);
+
     ret = gst_element_set_state (gstreamer->pipe, GST_STATE_PAUSED);
     if (ret == GST_STATE_CHANGE_FAILURE)
         return FALSE;
 
+    if (ret == GST_STATE_CHANGE_NO_PREROLL)
+        gstreamer->is_live = TRUE;
+
+    return TRUE;
+}
+
+// Set the current gstreamer backend status to READY
+// Playing is stopped, but the pipeline keeps its resources such as the
+// opened audio device, so switching to a different item is faster than
+// from the STOPPED state
+// Returns TRUE if the state was successfully set
+gboolean play_gstreamer_set_state_ready (PlayGstreamer *gstreamer)
+{
+    GstStateChangeReturn ret;
+
+    g_return_val_if_fail (PLAY_IS_GSTREAMER (gstreamer), FALSE);
+
+    gstreamer->playing   = FALSE;
+    gstreamer->buffering = FALSE;
+    gstreamer_watchdog_stop (gstreamer);
+
+    ret = gst_element_set_state (gstreamer->pipe, GST_STATE_READY);
+    if (ret == GST_STATE_CHANGE_FAILURE)
+        return FALSE;
+
     return TRUE;
 }
 
@@ -298,6 +614,10 @@ gboolean play_gstreamer_set_state_stopped (PlayGstreamer *gstreamer)
 
     g_return_val_if_fail (PLAY_IS_GSTREAMER (gstreamer), FALSE);
 
+    gstreamer->playing   = FALSE;
+    gstreamer->buffering = FALSE;
+    gstreamer_watchdog_stop (gstreamer);
+
     ret = gst_element_set_state (gstreamer->pipe, GST_STATE_NULL);
     if (ret == GST_STATE_CHANGE_FAILURE)
         return FALSE;
@@ -447,6 +767,15 @@ gboolean play_gstreamer_set_position (PlayGstreamer *gstreamer, gint64 offset)
     else
         p = MAX (0, p + offset);
 
+    gstreamer_latency_mark (
+        gstreamer,
+        PLAY_GSTREAMER_LATENCY_SEEK,
+        g_get_monotonic_time ());
+
+    // The stream gets the whole timeout to deliver data from the new
+    // position
+    gstreamer->stall_mark = g_get_monotonic_time ();
+
     return gst_element_seek_simple (
         gstreamer->playbin,
         GST_FORMAT_TIME,
@@ -465,9 +794,12 @@ gboolean play_gstreamer_set_position_seconds (PlayGstreamer *gstreamer,
 }
 
 // Initialize a newly created gstreamer object
-static gboolean gstreamer_gst_initialize (PlayGstreamer *gstreamer, GError **error)
+static gboolean gstreamer_gst_initialize (PlayGstreamer *gstreamer,
+                                          const gchar *audio_sink,
+                                          GError **error)
 {
     GstElement *sink;
+    GstPad     *pad;
     GstBus     *bus;
 
     // Gstreamer pipeline
@@ -494,24 +826,62 @@ static gboolean gstreamer_gst_initialize (PlayGstreamer *gstreamer, GError **err
         return FALSE;
     }
     // Audio sink
-    sink = gst_element_factory_make ("autoaudiosink", NULL);
+    // A custom sink such as a fakesink allows playing without a sound card
+    if (audio_sink) {
+        GError *parse_error = NULL;
+
+        sink = gst_parse_bin_from_description (audio_sink, TRUE, &parse_error);
+        if (!sink) {
+            g_set_error (
+                error,
+                PLAY_GSTREAMER_ERROR,
+                PLAY_GSTREAMER_ERROR_AUDIO_SINK_FAILED,
+                "Invalid audio sink \"%s\": %s",
+                audio_sink,
+                parse_error ? parse_error->message : "unknown error");
+            if (parse_error)
+                g_error_free (parse_error);
+        }
+    } else {
+        sink = gst_element_factory_make ("autoaudiosink", NULL);
+        if (!sink)
+            g_set_error (
+                error,
+                PLAY_GSTREAMER_ERROR,
+                PLAY_GSTREAMER_ERROR_AUDIO_SINK_FAILED,
+                "Audio sink plugin is missing (install the GStreamer \"good\" plugin set)");
+    }
     if (!sink) {
-        g_set_error (
-            error,
-            PLAY_GSTREAMER_ERROR,
-            PLAY_GSTREAMER_ERROR_AUDIO_SINK_FAILED,
-            "Audio sink plugin is missing (install the GStreamer \"good\" plugin set)");
         gst_object_unref (GST_OBJECT (gstreamer->playbin));
         gst_object_unref (GST_OBJECT (gstreamer->pipe));
         gstreamer->playbin = NULL;
         gstreamer->pipe = NULL;
         return FALSE;
     }
+
+    // Measure the delays until the audio reaches the sink
+    pad = gst_element_get_static_pad (sink, "sink");
+    if (pad) {
+        gst_pad_add_probe (
+            pad,
+            GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+            (GstPadProbeCallback) gstreamer_gst_sink_probe,
+            gstreamer,
+            NULL);
+        gst_object_unref (pad);
+    }
     g_object_set (G_OBJECT (gstreamer->playbin), "audio-sink", sink, NULL);
     g_object_set (G_OBJECT (gstreamer->playbin), "flags",
         GST_PLAY_FLAG_AUDIO |
         GST_PLAY_FLAG_SOFT_VOLUME, NULL);
 
+    // Queue the next item before the current one ends
+    g_signal_connect (
+        gstreamer->playbin,
+        "about-to-finish",
+        G_CALLBACK (gstreamer_gst_about_to_finish),
+        gstreamer);
+
     // Connect playbin with the pipeline
     gst_bin_add (GST_BIN (gstreamer->pipe), gstreamer->playbin);
 
@@ -537,6 +907,52 @@ static gboolean gstreamer_gst_initialize (PlayGstreamer *gstreamer, GError **err
     return TRUE;
 }
 
+// Pause the pipeline while the network stream buffer is being filled and
+// resume playing once it is full
+// Returns FALSE if the message reports the progress of a download rather
+// than the fill of the buffer
+static gboolean gstreamer_gst_buffering (PlayGstreamer *gstreamer,
+                                         GstMessage *message,
+                                         gint progress)
+{
+    GstBufferingMode mode;
+
+    // With progressive download the progress is the part of the file
+    // which has been downloaded, playing does not wait for it
+    gst_message_parse_buffering_stats (message, &mode, NULL, NULL, NULL);
+    if (mode != GST_BUFFERING_STREAM) {
+        PLAY_STATS_SET ("download.progress", progress);
+        return FALSE;
+    }
+
+    // Filling the buffer counts as data flow even though nothing reaches
+    // the sink while playing is paused
+    if ((guint) progress != gstreamer->buffering_progress)
+        gstreamer->stall_mark = g_get_monotonic_time ();
+
+    gstreamer->buffering_progress = (guint) progress;
+
+    // Live streams cannot be paused, the progress is only reported
+    if (gstreamer->is_live)
+        return TRUE;
+
+    if (progress < 100) {
+        // Pausing once at the start of buffering results in a single
+        // longer pause instead of a stutter whenever the buffer runs dry
+        if (!gstreamer->buffering && gstreamer->playing)
+            gst_element_set_state (gstreamer->pipe, GST_STATE_PAUSED);
+
+        gstreamer->buffering = TRUE;
+    } else {
+        // Resume unless paused by the user in the meantime
+        if (gstreamer->buffering && gstreamer->playing)
+            gst_element_set_state (gstreamer->pipe, GST_STATE_PLAYING);
+
+        gstreamer->buffering = FALSE;
+    }
+    return TRUE;
+}
+
 // Process a metadata tag
 static void gstreamer_gst_bus_tag (const GstTagList *list,
                                    const gchar *tag,
@@ -580,8 +996,45 @@ static gboolean gstreamer_gst_bus_message (GstBus *bus,
                                            PlayGstreamer *gstreamer)
 {
     switch (GST_MESSAGE_TYPE (message)) {
+        case GST_MESSAGE_STREAM_START: {
+            // A new stream has started, if it is the one handed over in
+            // the about-to-finish callback, it becomes the current item
+            PlayQueueItem *item = NULL;
+
+            g_mutex_lock (&gstreamer->lock);
+            if (gstreamer->next_set) {
+                item = gstreamer->next;
+                gstreamer->next = NULL;
+                gstreamer->next_set = FALSE;
+                g_free (gstreamer->next_uri);
+                gstreamer->next_uri = NULL;
+            }
+            g_mutex_unlock (&gstreamer->lock);
+
+            if (item) {
+                if (gstreamer->current)
+                    g_object_unref (gstreamer->current);
+
+                gstreamer->current = item;
+                gstreamer->stall_retries = 0;
+                gstreamer_watchdog_update (gstreamer);
+
+                g_signal_emit (
+                    gstreamer,
+                    signals[TRACK_CHANGED],
+                    0,
+                    item);
+            }
+            break;
+        }
         case GST_MESSAGE_EOS:
-            // End of the stream
+            // End of the stream, the following track is started by the
+            // user of the object
+            gstreamer_latency_mark (
+                gstreamer,
+                PLAY_GSTREAMER_LATENCY_GAP,
+                g_get_monotonic_time ());
+
             if (G_LIKELY (gstreamer->current)) {
                 g_object_unref (gstreamer->current);
                 gstreamer->current = NULL;
@@ -615,11 +1068,12 @@ static gboolean gstreamer_gst_bus_message (GstBus *bus,
             gint progress;
 
             gst_message_parse_buffering (message, &progress);
-            g_signal_emit (
-                gstreamer,
-                signals[BUFFERING],
-                0,
-                (guint) progress);
+            if (gstreamer_gst_buffering (gstreamer, message, progress))
+                g_signal_emit (
+                    gstreamer,
+                    signals[BUFFERING],
+                    0,
+                    (guint) progress);
             break;
         }
         case GST_MESSAGE_TAG: {
@@ -662,15 +1116,294 @@ static gboolean gstreamer_gst_bus_message (GstBus *bus,
                 default:
                     break;
             }
+            // The duration is usually known once the pipeline has
+            // prerolled, it is not always announced by a DURATION message
+            if (GST_MESSAGE_SRC (message) == GST_OBJECT (gstreamer->pipe) &&
+                (new == GST_STATE_PAUSED || new == GST_STATE_PLAYING))
+                g_signal_emit (
+                    gstreamer,
+                    signals[DURATION_UPDATED],
+                    0);
+            break;
         }
+        case GST_MESSAGE_ASYNC_DONE:
+            // Flushing seeks are finished by this message
+            g_signal_emit (
+                gstreamer,
+                signals[POSITION_CHANGED],
+                0);
+            break;
         case GST_MESSAGE_DURATION:
             g_signal_emit (
                 gstreamer,
                 signals[DURATION_UPDATED],
                 0);
             break;
+        case GST_MESSAGE_APPLICATION: {
+            // A latency measurement posted by the sink probe
+            const GstStructure *structure;
+            guint  type = 0;
+            gint64 latency = 0;
+
+            structure = gst_message_get_structure (message);
+            if (!gst_structure_has_name (structure, GSTREAMER_LATENCY_MESSAGE))
+                break;
+
+            gst_structure_get_uint (structure, "type", &type);
+            gst_structure_get_int64 (structure, "latency", &latency);
+            g_signal_emit (
+                gstreamer,
+                signals[LATENCY],
+                0,
+                type,
+                latency);
+            break;
+        }
         default:
             break;
     }
     return TRUE;
 }
+
+// The current stream is about to finish, hand over the next item to
+// the playbin to allow gapless playback
+// This function is called from a GStreamer streaming thread
+static void gstreamer_gst_about_to_finish (GstElement *playbin,
+                                           PlayGstreamer *gstreamer)
+{
+    g_mutex_lock (&gstreamer->lock);
+    if (gstreamer->next_uri && !gstreamer->next_set) {
+        g_object_set (G_OBJECT (playbin), "uri", gstreamer->next_uri, NULL);
+        gstreamer->next_set = TRUE;
+    }
+    g_mutex_unlock (&gstreamer->lock);
+}
+
+// Forget the item set by play_gstreamer_set_next_item()
+static void gstreamer_clear_next (PlayGstreamer *gstreamer)
+{
+    g_mutex_lock (&gstreamer->lock);
+    if (gstreamer->next) {
+        g_object_unref (gstreamer->next);
+        gstreamer->next = NULL;
+    }
+    g_free (gstreamer->next_uri);
+    gstreamer->next_uri = NULL;
+    gstreamer->next_set = FALSE;
+    g_mutex_unlock (&gstreamer->lock);
+}
+
+// Start measuring the delay until the next buffer reaches the audio sink
+// A measurement which is already in progress is kept
+static void gstreamer_latency_mark (PlayGstreamer *gstreamer,
+                                    PlayGstreamerLatency type,
+                                    gint64 time)
+{
+    g_mutex_lock (&gstreamer->lock);
+    if (gstreamer->latency_mark < 0) {
+        gstreamer->latency_mark = time;
+        gstreamer->latency_type = type;
+    }
+    g_mutex_unlock (&gstreamer->lock);
+}
+
+// Watch buffers and events reaching the audio sink
+// This function is called from a GStreamer streaming thread
+static GstPadProbeReturn gstreamer_gst_sink_probe (GstPad *pad,
+                                                   GstPadProbeInfo *info,
+                                                   PlayGstreamer *gstreamer)
+{
+    GstMessage *message = NULL;
+    gint64      now;
+
+    if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+        // A new stream following the previous one without stopping,
+        // the gap is measured from the last buffer of the previous one
+        if (GST_EVENT_TYPE (event) == GST_EVENT_STREAM_START) {
+            gint64 last;
+
+            g_mutex_lock (&gstreamer->lock);
+            last = gstreamer->latency_last;
+            g_mutex_unlock (&gstreamer->lock);
+
+            if (last >= 0)
+                gstreamer_latency_mark (
+                    gstreamer,
+                    PLAY_GSTREAMER_LATENCY_GAP,
+                    last);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+    now = g_get_monotonic_time ();
+
+    g_mutex_lock (&gstreamer->lock);
+    if (gstreamer->latency_mark >= 0) {
+        message = gst_message_new_application (
+            GST_OBJECT (gstreamer->playbin),
+            gst_structure_new (
+                GSTREAMER_LATENCY_MESSAGE,
+                "type", G_TYPE_UINT, gstreamer->latency_type,
+                "latency", G_TYPE_INT64,
+                (now - gstreamer->latency_mark) * GST_USECOND,
+                NULL));
+        gstreamer->latency_mark = -1;
+    }
+    gstreamer->latency_last = now;
+    g_mutex_unlock (&gstreamer->lock);
+
+    // The signal is emitted from the bus handler in the main loop
+    if (message)
+        gst_element_post_message (gstreamer->playbin, message);
+
+    return GST_PAD_PROBE_OK;
+}
+
+// Start or stop watching the flow of audio data depending on whether
+// a network stream is being played
+static void gstreamer_watchdog_update (PlayGstreamer *gstreamer)
+{
+    gboolean watch = FALSE;
+
+    // The pipeline is not running while waiting to reconnect
+    if (gstreamer->reconnect_source)
+        return;
+
+    if (gstreamer->playing && gstreamer->stall_timeout) {
+        // Local files do not stall, the next item is included as it is
+        // being connected to before the current one ends
+        watch = gstreamer_is_stream (gstreamer->current);
+        if (!watch) {
+            g_mutex_lock (&gstreamer->lock);
+            watch = gstreamer_is_stream (gstreamer->next);
+            g_mutex_unlock (&gstreamer->lock);
+        }
+    }
+
+    if (watch && !gstreamer->stall_source) {
+        gstreamer->stall_mark = g_get_monotonic_time ();
+        gstreamer->stall_source = g_timeout_add_seconds (
+            1,
+            (GSourceFunc) gstreamer_watchdog_timeout,
+            gstreamer);
+    } else if (!watch && gstreamer->stall_source) {
+        g_source_remove (gstreamer->stall_source);
+        gstreamer->stall_source = 0;
+    }
+}
+
+// Stop watching the flow of audio data and cancel a pending reconnection
+static void gstreamer_watchdog_stop (PlayGstreamer *gstreamer)
+{
+    if (gstreamer->stall_source) {
+        g_source_remove (gstreamer->stall_source);
+        gstreamer->stall_source = 0;
+    }
+    if (gstreamer->reconnect_source) {
+        g_source_remove (gstreamer->reconnect_source);
+        gstreamer->reconnect_source = 0;
+    }
+}
+
+// Check that audio data keeps reaching the sink
+static gboolean gstreamer_watchdog_timeout (PlayGstreamer *gstreamer)
+{
+    gint64 last;
+    gint64 now;
+
+    g_mutex_lock (&gstreamer->lock);
+    last = gstreamer->latency_last;
+    g_mutex_unlock (&gstreamer->lock);
+
+    // Data arriving after the watching has started means that
+    // the connection works and the attempts are counted anew
+    if (last > gstreamer->stall_mark)
+        gstreamer->stall_retries = 0;
+    else
+        last = gstreamer->stall_mark;
+
+    now = g_get_monotonic_time ();
+    if (now - last < (gint64) gstreamer->stall_timeout * G_USEC_PER_SEC)
+        return TRUE;
+
+    gstreamer->stall_source = 0;
+    gstreamer_stalled (gstreamer);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Drop the connection of a stalled stream and schedule a new one, or fail
+// if the attempts have run out
+static void gstreamer_stalled (PlayGstreamer *gstreamer)
+{
+    guint delay;
+
+    if (gstreamer->stall_retries >= GSTREAMER_RECONNECT_ATTEMPTS) {
+        GError *error;
+
+        // Let the user of the object continue with a different item
+        play_gstreamer_set_state_stopped (gstreamer);
+
+        error = g_error_new (
+            PLAY_GSTREAMER_ERROR,
+            PLAY_GSTREAMER_ERROR_STALLED,
+            "The stream has stopped responding");
+        g_signal_emit (
+            gstreamer,
+            signals[ERROR],
+            0,
+            error);
+
+        g_error_free (error);
+        return;
+    }
+    delay = GSTREAMER_RECONNECT_DELAY << gstreamer->stall_retries;
+    gstreamer->stall_retries++;
+
+    // Going to the READY state closes the connection, the playbin keeps
+    // its URI, which is the next one if it has already been handed over
+    gst_element_set_state (gstreamer->pipe, GST_STATE_READY);
+    gstreamer->buffering = FALSE;
+    gstreamer->is_live   = FALSE;
+
+    gstreamer->reconnect_source = g_timeout_add_seconds (
+        delay,
+        (GSourceFunc) gstreamer_reconnect_timeout,
+        gstreamer);
+
+    g_signal_emit (
+        gstreamer,
+        signals[RECONNECTING],
+        0,
+        gstreamer->stall_retries,
+        delay);
+}
+
+// Connect again to the stalled stream
+static gboolean gstreamer_reconnect_timeout (PlayGstreamer *gstreamer)
+{
+    gstreamer->reconnect_source = 0;
+
+    // A failure is reported on the bus
+    play_gstreamer_set_state_playing (gstreamer);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Return TRUE if the item is played over a network
+static gboolean gstreamer_is_stream (PlayQueueItem *item)
+{
+    return item && !play_queue_item_is_native (item);
+}
+
+// Sort function for the measured delays
+static gint gstreamer_latency_sort (gconstpointer a, gconstpointer b)
+{
+    gint64 la = *(const gint64 *) a;
+    gint64 lb = *(const gint64 *) b;
+
+    return (la > lb) - (la < lb);
+}
@@ -17,13 +17,32 @@ typedef enum {
     PLAY_GSTREAMER_PAUSED
 } PlayGstreamerState;
 
+// Kinds of delays measured between a request and the first buffer reaching
+// the audio sink
+typedef enum {
+    // Setting a new item and starting the playback
+    PLAY_GSTREAMER_LATENCY_START,
+    // The last buffer of a track and the first buffer of the following one
+    PLAY_GSTREAMER_LATENCY_GAP,
+    // Seeking in the current track
+    PLAY_GSTREAMER_LATENCY_SEEK
+} PlayGstreamerLatency;
+
+// Number of the PLAY_GSTREAMER_LATENCY_* kinds
+#define PLAY_GSTREAMER_LATENCY_COUNT (PLAY_GSTREAMER_LATENCY_SEEK + 1)
+
 typedef enum {
     PLAY_GSTREAMER_ERROR_PIPELINE_FAILED,
     PLAY_GSTREAMER_ERROR_PLAYBIN_FAILED,
     PLAY_GSTREAMER_ERROR_AUDIO_SINK_FAILED,
-    PLAY_GSTREAMER_ERROR_BUS_FAILED
+    PLAY_GSTREAMER_ERROR_BUS_FAILED,
+    PLAY_GSTREAMER_ERROR_STALLED
 } PlayGstreamerError;
 
+// Default number of seconds without audio data after which a network
+// stream is considered stalled and reconnected
+#define PLAY_GSTREAMER_STALL_TIMEOUT 10
+
 #define PLAY_TYPE_GSTREAMER                     \
     (play_gstreamer_get_type())
 #define PLAY_GSTREAMER(o)                       \
@@ -53,8 +72,24 @@ typedef enum {
 typedef struct {
     GObject        parent_instance;
     PlayQueueItem *current;
+    PlayQueueItem *next;
+    gchar         *next_uri;
+    gboolean       next_set;
+    GMutex         lock;
+    gint64         latency_mark;
+    gint64         latency_last;
+    guint          latency_type;
     GstElement    *pipe;
     GstElement    *playbin;
+    gboolean       playing;
+    gboolean       buffering;
+    guint          buffering_progress;
+    gboolean       is_live;
+    guint          stall_timeout;
+    guint          stall_source;
+    guint          stall_retries;
+    gint64         stall_mark;
+    guint          reconnect_source;
 } PlayGstreamer;
 
 typedef struct {
@@ -62,6 +97,7 @@ typedef struct {
 
     // Signals
     // Buffer fill has been changed
+    // Playing is paused while the buffer is being filled
     void (*buffering) (PlayGstreamer *gstreamer,
                        guint progress,
                        gpointer user_data);
@@ -79,6 +115,10 @@ typedef struct {
                    GError *error,
                    gpointer user_data);
 
+    // The position has been changed by seeking
+    void (*position_changed) (PlayGstreamer *gstreamer,
+                              gpointer user_data);
+
     // A metadata information has become known or been updated
     void (*metadata_updated) (PlayGstreamer *gstreamer,
                               PlayMetadata type,
@@ -96,6 +136,27 @@ typedef struct {
     // The state has been changed to STOPPED
     void (*state_stopped) (PlayGstreamer *gstreamer,
                            gpointer user_data);
+
+    // Playing has continued with the item set by
+    // play_gstreamer_set_next_item() without stopping the playback
+    void (*track_changed) (PlayGstreamer *gstreamer,
+                           PlayQueueItem *item,
+                           gpointer user_data);
+
+    // Audio has reached the sink after a delay of the given number of
+    // nanoseconds, the type is one of PLAY_GSTREAMER_LATENCY_*
+    void (*latency) (PlayGstreamer *gstreamer,
+                     guint type,
+                     gint64 latency,
+                     gpointer user_data);
+
+    // A network stream has stopped delivering data and is going to be
+    // reconnected after the given number of seconds
+    // The stream fails with an error once the attempts run out
+    void (*reconnecting) (PlayGstreamer *gstreamer,
+                          guint attempt,
+                          guint delay,
+                          gpointer user_data);
 } PlayGstreamerClass;
 
 extern GType  play_gstreamer_get_type (void);
@@ -105,8 +166,41 @@ extern GQuark play_gstreamer_get_error_quark (void);
 // Should be called soon after the program start
 extern void play_gstreamer_global_initialize (int *argcp, char ***argvp);
 
+// Print the percentiles of the delays measured for each of the
+// PLAY_GSTREAMER_LATENCY_* kinds
+// The PLAY_GSTREAMER_LATENCY_COUNT arrays hold the delays in nanoseconds,
+// they are freed and set to NULL afterwards
+extern void play_gstreamer_print_latency (GArray **latencies);
+
 // Create a new gstreamer object
-extern PlayGstreamer *play_gstreamer_new (GError **error);
+// The audio sink is described in the gst-launch syntax, if it is NULL the
+// default audio output is used
+extern PlayGstreamer *play_gstreamer_new (const gchar *audio_sink,
+                                          GError **error);
+
+// Set the size of the network stream buffer in bytes and its duration in
+// nanoseconds, -1 keeps the GStreamer default
+// The values apply to the streams started afterwards
+extern void play_gstreamer_set_buffer (PlayGstreamer *gstreamer,
+                                       gint size,
+                                       gint64 duration);
+
+// Enable or disable progressive download
+// Seekable HTTP files of the formats supported by GStreamer are then
+// downloaded to a temporary file instead of a memory buffer, playing
+// resumes sooner after seeking back and rebuffering happens less often
+extern void play_gstreamer_set_download (PlayGstreamer *gstreamer,
+                                         gboolean download);
+
+// Set the number of seconds without audio data after which a playing
+// network stream is reconnected, 0 disables the reconnecting
+extern void play_gstreamer_set_stall_timeout (PlayGstreamer *gstreamer,
+                                              guint timeout);
+
+// Retrieve the fill of the network stream buffer in percent
+// Returns TRUE if playing is waiting for the buffer to be filled
+extern gboolean play_gstreamer_get_buffering (PlayGstreamer *gstreamer,
+                                              guint *progress);
 
 // Set a new queue item to be played
 // The playback should be stopped before using this function and then started
@@ -115,6 +209,13 @@ extern PlayGstreamer *play_gstreamer_new (GError **error);
 extern gboolean play_gstreamer_set_item (PlayGstreamer *gstreamer,
                                          PlayQueueItem *item);
 
+// Set a queue item to be played when the current one is about to finish
+// The switch happens without stopping the playback and is announced by
+// the "track-changed" signal, use NULL to unset the item
+// Returns TRUE on success
+extern gboolean play_gstreamer_set_next_item (PlayGstreamer *gstreamer,
+                                              PlayQueueItem *item);
+
 // Retrieve the current state of the gstreamer backend and store it in
 // the passed PlayGstreamerState
 // Returns TRUE if the state was successfully retrieved
@@ -133,6 +234,13 @@ extern gboolean play_gstreamer_set_state_playing (PlayGstreamer *gstreamer);
 // set asynchronously
 extern gboolean play_gstreamer_set_state_paused (PlayGstreamer *gstreamer);
 
+// Set the current gstreamer backend status to READY
+// Playing is stopped, but the pipeline keeps its resources such as the
+// opened audio device, so switching to a different item is faster than
+// from the STOPPED state
+// Returns TRUE if the state was successfully set
+extern gboolean play_gstreamer_set_state_ready (PlayGstreamer *gstreamer);
+
 // Set the current gstreamer backend status to STOPPED (stop playing)
 // Returns TRUE if the state was successfully set or if it's going to be
 // set asynchronously
@@ -0,0 +1,358 @@
+/**
+ * PLAY
+ * play-latency-test.c: Headless measurement of track switching delays
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-gstreamer.h"
+#include "play-queue-item.h"
+
+// Defaults of the command line options
+#define LATENCY_TRANSITIONS 200
+#define LATENCY_FILES       4
+#define LATENCY_LENGTH      500
+#define LATENCY_AUDIO_SINK  "fakesink sync=true"
+
+// Number of seconds without any measurement after which the test fails
+#define LATENCY_TIMEOUT 10
+
+// Ways of switching to the following track, used in turns
+typedef enum {
+    // Stop the current track and start the following one
+    LATENCY_SWITCH_RESTART,
+    // Let the backend continue with the following track without a gap
+    LATENCY_SWITCH_GAPLESS,
+    // Start the following track once the current one has ended
+    LATENCY_SWITCH_EOS,
+    LATENCY_SWITCH_COUNT
+} LatencySwitch;
+
+// Write a WAV file of the given length in milliseconds generated by
+// the audiotestsrc element
+// Returns FALSE on error
+static gboolean latency_generate (const gchar *path, guint length);
+
+// Start playing the track following the current one
+static void latency_start_next (void);
+
+// Switch to the following track in the way chosen for the transition
+static void latency_switch (void);
+
+// Restart the timeout which fails the test when the measurements stop
+static void latency_watch (void);
+
+// The measurements have stopped arriving
+static gboolean latency_timeout (void);
+
+// Audio has reached the sink after a measured delay
+static void latency_gst_latency (PlayGstreamer *backend,
+                                 guint type,
+                                 gint64 latency);
+
+// The track has ended without a following track being set
+static void latency_gst_end_of_stream (PlayGstreamer *backend);
+
+// Playing has stopped with an error
+static void latency_gst_error (PlayGstreamer *backend, GError *error);
+
+// Global variables
+static GMainLoop     *loop;
+static PlayGstreamer *backend;
+static GPtrArray     *items;
+static GArray        *latencies[PLAY_GSTREAMER_LATENCY_COUNT];
+static guint          current;
+static guint          transitions;
+static guint          timeout_source;
+static gboolean       failed;
+
+// Command line options
+static gint   opt_transitions = LATENCY_TRANSITIONS;
+static gint   opt_files       = LATENCY_FILES;
+static gint   opt_length      = LATENCY_LENGTH;
+static gchar *opt_audio_sink  = NULL;
+
+int main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError         *err = NULL;
+    gchar          *dir;
+    gint            i;
+
+    static const GOptionEntry opts[] = {
+        { "transitions", 't', 0, G_OPTION_ARG_INT, &opt_transitions,
+          "Number of track switches to measure (default: 200)",
+          "N" },
+        { "files",       'f', 0, G_OPTION_ARG_INT, &opt_files,
+          "Number of generated files to play in turns (default: 4)",
+          "N" },
+        { "length",      'l', 0, G_OPTION_ARG_INT, &opt_length,
+          "Length of each generated file in milliseconds (default: 500)",
+          "MS" },
+        { "audio-sink",  0,   0, G_OPTION_ARG_STRING, &opt_audio_sink,
+          "GStreamer audio sink (default: " LATENCY_AUDIO_SINK ")",
+          "SINK" },
+        { NULL }
+    };
+
+    context = g_option_context_new ("- measure track switching delays");
+    g_option_context_add_main_entries (context, opts, NULL);
+    g_option_context_add_group (context, gst_init_get_option_group ());
+    if (!g_option_context_parse (context, &argc, &argv, &err)) {
+        g_printerr ("%s\n", err->message);
+        g_option_context_free (context);
+        g_error_free (err);
+        return 1;
+    }
+    g_option_context_free (context);
+
+    if (opt_transitions < 1 || opt_files < 2 || opt_length < 100) {
+        g_printerr ("At least 1 transition, 2 files and 100 ms are needed\n");
+        return 1;
+    }
+    play_gstreamer_global_initialize (&argc, &argv);
+
+    backend = play_gstreamer_new (
+        opt_audio_sink ? opt_audio_sink : LATENCY_AUDIO_SINK,
+        &err);
+    if (!backend) {
+        g_printerr ("%s\n", err->message);
+        g_error_free (err);
+        return 1;
+    }
+    g_signal_connect (
+        G_OBJECT (backend),
+        "latency",
+        G_CALLBACK (latency_gst_latency),
+        NULL);
+    g_signal_connect (
+        G_OBJECT (backend),
+        "end-of-stream",
+        G_CALLBACK (latency_gst_end_of_stream),
+        NULL);
+    g_signal_connect (
+        G_OBJECT (backend),
+        "error",
+        G_CALLBACK (latency_gst_error),
+        NULL);
+
+    dir = g_dir_make_tmp ("play-latency-XXXXXX", &err);
+    if (!dir) {
+        g_printerr ("%s\n", err->message);
+        g_error_free (err);
+        g_object_unref (backend);
+        return 1;
+    }
+
+    // The files differ in length to keep the transitions from falling
+    // into a regular pattern
+    items = g_ptr_array_new_with_free_func (g_object_unref);
+    for (i = 0; i < opt_files; i++) {
+        gchar *name = g_strdup_printf ("track-%d.wav", i);
+        gchar *path = g_build_filename (dir, name, NULL);
+
+        if (latency_generate (path, opt_length + i * 50)) {
+            PlayQueueItem *item = play_queue_item_new ();
+
+            play_queue_item_set_file_or_uri (item, path);
+            g_ptr_array_add (items, item);
+        } else {
+            failed = TRUE;
+        }
+        g_free (path);
+        g_free (name);
+    }
+
+    if (!failed) {
+        for (i = 0; i < G_N_ELEMENTS (latencies); i++)
+            latencies[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+        loop = g_main_loop_new (NULL, FALSE);
+
+        play_gstreamer_set_item (backend, g_ptr_array_index (items, 0));
+        play_gstreamer_set_state_playing (backend);
+        latency_watch ();
+
+        g_main_loop_run (loop);
+        g_main_loop_unref (loop);
+
+        play_gstreamer_set_state_stopped (backend);
+        if (timeout_source)
+            g_source_remove (timeout_source);
+
+        // The same lines as printed by the player with the --latency option
+        play_gstreamer_print_latency (latencies);
+    }
+    g_object_unref (backend);
+
+    // Remove the generated files
+    for (i = 0; i < opt_files; i++) {
+        gchar *name = g_strdup_printf ("track-%d.wav", i);
+        gchar *path = g_build_filename (dir, name, NULL);
+
+        g_unlink (path);
+        g_free (path);
+        g_free (name);
+    }
+    g_rmdir (dir);
+    g_free (dir);
+
+    g_ptr_array_unref (items);
+    return failed ? 1 : 0;
+}
+
+// Write a WAV file of the given length in milliseconds generated by
+// the audiotestsrc element
+// Returns FALSE on error
+static gboolean latency_generate (const gchar *path, guint length)
+{
+    GstElement *pipe;
+    GstBus     *bus;
+    GstMessage *message;
+    GError     *err = NULL;
+    gchar      *description;
+    gboolean    ret = TRUE;
+
+    // Buffers of 10 milliseconds at 44.1 kHz
+    description = g_strdup_printf (
+        "audiotestsrc num-buffers=%u samplesperbuffer=441 ! "
+        "audio/x-raw,rate=44100,channels=2 ! "
+        "wavenc ! filesink location=\"%s\"",
+        length / 10,
+        path);
+
+    // A missing element is reported as an error even though a partial
+    // pipeline may be returned
+    pipe = gst_parse_launch (description, &err);
+    g_free (description);
+    if (err) {
+        if (pipe)
+            gst_object_unref (pipe);
+        g_printerr ("Failed to generate %s: %s\n", path, err->message);
+        g_error_free (err);
+        return FALSE;
+    }
+
+    gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+    bus = gst_element_get_bus (pipe);
+    message = gst_bus_timed_pop_filtered (
+        bus,
+        GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+    if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR) {
+        gst_message_parse_error (message, &err, NULL);
+        g_printerr ("Failed to generate %s: %s\n", path, err->message);
+        g_error_free (err);
+        ret = FALSE;
+    }
+    gst_message_unref (message);
+    gst_object_unref (bus);
+
+    gst_element_set_state (pipe, GST_STATE_NULL);
+    gst_object_unref (pipe);
+    return ret;
+}
+
+// Start playing the track following the current one
+static void latency_start_next (void)
+{
+    current = (current + 1) % items->len;
+
+    play_gstreamer_set_item (backend, g_ptr_array_index (items, current));
+    play_gstreamer_set_state_playing (backend);
+}
+
+// Switch to the following track in the way chosen for the transition
+static void latency_switch (void)
+{
+    switch (transitions % LATENCY_SWITCH_COUNT) {
+        case LATENCY_SWITCH_RESTART:
+            play_gstreamer_set_state_ready (backend);
+            latency_start_next ();
+            break;
+        case LATENCY_SWITCH_GAPLESS:
+            current = (current + 1) % items->len;
+            play_gstreamer_set_next_item (
+                backend,
+                g_ptr_array_index (items, current));
+            break;
+        case LATENCY_SWITCH_EOS:
+            // The switch is done by the end-of-stream handler
+            play_gstreamer_set_next_item (backend, NULL);
+            break;
+    }
+}
+
+// Restart the timeout which fails the test when the measurements stop
+static void latency_watch (void)
+{
+    if (timeout_source)
+        g_source_remove (timeout_source);
+
+    timeout_source = g_timeout_add_seconds (
+        LATENCY_TIMEOUT,
+        (GSourceFunc) latency_timeout,
+        NULL);
+}
+
+// The measurements have stopped arriving
+static gboolean latency_timeout (void)
+{
+    g_printerr ("No audio reached the sink for %d seconds after %u "
+                "transitions\n",
+                LATENCY_TIMEOUT,
+                transitions);
+
+    failed = TRUE;
+    timeout_source = 0;
+    g_main_loop_quit (loop);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Audio has reached the sink after a measured delay
+static void latency_gst_latency (PlayGstreamer *backend,
+                                 guint type,
+                                 gint64 latency)
+{
+    if (type >= G_N_ELEMENTS (latencies))
+        return;
+
+    g_array_append_val (latencies[type], latency);
+    latency_watch ();
+
+    if (type == PLAY_GSTREAMER_LATENCY_SEEK) {
+        // The track has been sought, continue with the next transition
+        latency_switch ();
+        return;
+    }
+
+    // A new track has started playing
+    if (++transitions >= (guint) opt_transitions) {
+        g_main_loop_quit (loop);
+        return;
+    }
+
+    // Seek back to the beginning of each track once, the remaining part of
+    // the track is then long enough to set the following one in time
+    // The switch is made right away when the position is not known yet
+    if (!play_gstreamer_set_position (backend, -(gint64) GST_SECOND))
+        latency_switch ();
+}
+
+// The track has ended without a following track being set
+static void latency_gst_end_of_stream (PlayGstreamer *backend)
+{
+    latency_start_next ();
+}
+
+// Playing has stopped with an error
+static void latency_gst_error (PlayGstreamer *backend, GError *error)
+{
+    g_printerr ("%s\n", error->message);
+
+    failed = TRUE;
+    g_main_loop_quit (loop);
+}
@@ -0,0 +1,539 @@
+/**
+ * PLAY
+ * play-library.c: Persistent index of the media library
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-library.h"
+#include "play-queue-item.h"
+
+G_DEFINE_TYPE (PlayLibrary, play_library, G_TYPE_OBJECT);
+
+// The index file consists of a header, an array of fixed size entries and
+// a table of null-terminated strings, the entries refer to the strings by
+// their offsets and the offset 0 is an empty string
+// The values are stored in the native byte order, an index written on
+// a machine with a different byte order fails the version check
+#define LIBRARY_MAGIC   "PLAYLIB"
+#define LIBRARY_VERSION 1
+
+typedef struct {
+    gchar          magic[8];
+    guint32        version;
+    guint32        count;
+    guint32        strings_size;
+    guint32        reserved;
+} PlayLibraryHeader;
+
+typedef struct {
+    guint32        uri;
+    guint32        artist;
+    guint32        title;
+    guint32        reserved;
+    gint64         mtime;
+    gint64         duration;
+} PlayLibraryEntry;
+
+// Return a pointer to the index entry at the given index
+#define LIBRARY_ENTRY(library, i) \
+    (&((const PlayLibraryEntry *) (library)->entries)[i])
+
+// Return the string at the given offset of the string table
+static const gchar *library_get_string (PlayLibrary *library, guint32 offset);
+
+// Look up the index entry of the given URI
+// Returns NULL if the URI is not in the index
+static const PlayLibraryEntry *library_lookup (PlayLibrary *library,
+                                               const gchar *uri);
+
+// Copy the duration and metadata of an index entry into a queue item
+static void library_apply_entry (PlayLibrary *library,
+                                 const PlayLibraryEntry *entry,
+                                 PlayQueueItem *item);
+
+// Read the modification time of a local file
+// Returns -1 if the time cannot be read
+static gint64 library_get_mtime (GFile *file);
+
+// Add a string to the string table being written and return its offset
+// Identical strings, such as artist names, are only stored once
+static guint32 library_add_string (GString *strings,
+                                   GHashTable *offsets,
+                                   const gchar *value);
+
+// Unmap the index file
+static void library_unload (PlayLibrary *library);
+
+// GObject/finalize
+static void play_library_finalize (GObject *object)
+{
+    PlayLibrary *library = PLAY_LIBRARY (object);
+
+    // Clean up
+    library_unload (library);
+    g_hash_table_destroy (library->mtimes);
+    g_free (library->path);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_library_parent_class)->finalize (object);
+}
+
+// GObject/class init
+static void play_library_class_init (PlayLibraryClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->finalize = play_library_finalize;
+}
+
+// GObject/init
+static void play_library_init (PlayLibrary *library)
+{
+    // Modification times of the files read during this run
+    library->mtimes = g_hash_table_new_full (
+        g_str_hash,
+        g_str_equal,
+        g_free,
+        g_free);
+}
+
+// Create a new library object using the index file at the given path
+// If the path is NULL, the index is stored in the "play" directory of
+// the user data directory
+PlayLibrary *play_library_new (const gchar *path)
+{
+    PlayLibrary *library;
+
+    library = PLAY_LIBRARY (g_object_new (PLAY_TYPE_LIBRARY, NULL));
+    if (path)
+        library->path = g_strdup (path);
+    else
+        library->path = g_build_filename (
+            g_get_user_data_dir (),
+            "play",
+            "library",
+            NULL);
+    return library;
+}
+
+// Map the index file into memory
+// Returns TRUE on success, a missing or invalid index is reported as
+// an error and the library is then empty
+gboolean play_library_load (PlayLibrary *library, GError **error)
+{
+    const PlayLibraryHeader *header;
+    const gchar             *contents;
+    gsize                    length;
+
+    g_return_val_if_fail (PLAY_IS_LIBRARY (library), FALSE);
+
+    library_unload (library);
+
+    library->mapped = g_mapped_file_new (library->path, FALSE, error);
+    if (!library->mapped)
+        return FALSE;
+
+    contents = g_mapped_file_get_contents (library->mapped);
+    length   = g_mapped_file_get_length (library->mapped);
+
+    // Validate the header and the sizes of the sections
+    header = (const PlayLibraryHeader *) contents;
+    if (length < sizeof (PlayLibraryHeader) ||
+        memcmp (header->magic, LIBRARY_MAGIC, sizeof (LIBRARY_MAGIC)) ||
+        header->version != LIBRARY_VERSION ||
+        header->strings_size == 0 ||
+        length != sizeof (PlayLibraryHeader) +
+                  (gsize) header->count * sizeof (PlayLibraryEntry) +
+                  header->strings_size ||
+        contents[length - 1] != '\0') {
+        g_set_error (
+            error,
+            G_FILE_ERROR,
+            G_FILE_ERROR_INVAL,
+            "The library index %s is not valid",
+            library->path);
+        library_unload (library);
+        return FALSE;
+    }
+    library->count   = header->count;
+    library->entries = contents + sizeof (PlayLibraryHeader);
+    library->strings = contents + length - header->strings_size;
+    library->strings_size = header->strings_size;
+    return TRUE;
+}
+
+// Return the number of tracks in the index
+guint play_library_get_count (PlayLibrary *library)
+{
+    g_return_val_if_fail (PLAY_IS_LIBRARY (library), 0);
+
+    return library->count;
+}
+
+// Create queue items of all the tracks in the index, including the known
+// durations and metadata, without accessing the media files
+// Free the returned array with g_ptr_array_unref()
+GPtrArray *play_library_get_items (PlayLibrary *library)
+{
+    GPtrArray *items;
+    guint      i;
+
+    g_return_val_if_fail (PLAY_IS_LIBRARY (library), NULL);
+
+    items = g_ptr_array_new_full (library->count, g_object_unref);
+
+    for (i = 0; i < library->count; i++) {
+        const PlayLibraryEntry *entry = LIBRARY_ENTRY (library, i);
+        PlayQueueItem *item;
+
+        item = play_queue_item_new ();
+        play_queue_item_set_uri (
+            item,
+            library_get_string (library, entry->uri));
+
+        library_apply_entry (library, entry, item);
+        g_ptr_array_add (items, item);
+    }
+    return items;
+}
+
+// Compare the modification times of the given local queue items with the
+// index and copy the duration and metadata of the unchanged tracks into
+// the items
+// Returns the number of items which were found unchanged
+guint play_library_refresh (PlayLibrary *library, GPtrArray *items)
+{
+    guint count = 0;
+    guint i;
+
+    g_return_val_if_fail (PLAY_IS_LIBRARY (library), 0);
+    g_return_val_if_fail (items, 0);
+
+    for (i = 0; i < items->len; i++) {
+        PlayQueueItem *item = g_ptr_array_index (items, i);
+        const PlayLibraryEntry *entry;
+        gchar  *uri;
+        GFile  *file;
+        gint64  mtime;
+
+        if (!play_queue_item_is_native (item))
+            continue;
+
+        // The items only keep the GFile and URI of the played tracks,
+        // do not make them keep it for the whole library
+        uri   = play_queue_item_dup_uri (item);
+        file  = g_file_new_for_uri (uri);
+        mtime = library_get_mtime (file);
+        g_object_unref (file);
+        if (mtime < 0) {
+            g_free (uri);
+            continue;
+        }
+
+        // Only the information of files which have not been modified
+        // since they were indexed can be used
+        entry = library_lookup (library, uri);
+        if (entry && entry->mtime == mtime) {
+            library_apply_entry (library, entry, item);
+            count++;
+        }
+        g_hash_table_insert (
+            library->mtimes,
+            uri,
+            g_memdup (&mtime, sizeof (mtime)));
+    }
+    return count;
+}
+
+// Write a new index consisting of the given queue items, the tracks of
+// the current index which are not among them are kept unchanged
+// Returns TRUE on success
+gboolean play_library_save (PlayLibrary *library,
+                            GPtrArray *items,
+                            GError **error)
+{
+    PlayLibraryHeader  header;
+    GHashTable        *offsets;
+    GHashTable        *written;
+    GPtrArray         *uris;
+    GString           *strings;
+    GString           *contents;
+    GArray            *entries;
+    gchar             *dir;
+    gboolean           ret;
+    guint              i;
+
+    g_return_val_if_fail (PLAY_IS_LIBRARY (library), FALSE);
+    g_return_val_if_fail (items, FALSE);
+
+    entries = g_array_sized_new (
+        FALSE,
+        TRUE,
+        sizeof (PlayLibraryEntry),
+        items->len);
+    offsets = g_hash_table_new (g_str_hash, g_str_equal);
+    written = g_hash_table_new (g_str_hash, g_str_equal);
+    uris    = g_ptr_array_new_full (items->len, g_free);
+
+    // The string table starts with the empty string
+    strings = g_string_sized_new (items->len * 64);
+    g_string_append_c (strings, '\0');
+
+    for (i = 0; i < items->len; i++) {
+        PlayQueueItem *item = g_ptr_array_index (items, i);
+        const PlayLibraryEntry *previous = NULL;
+        PlayLibraryEntry entry;
+        gchar  *uri;
+        gint64 *mtime;
+
+        uri = play_queue_item_dup_uri (item);
+        if (!uri)
+            continue;
+
+        // A track queued more than once is only stored once
+        if (g_hash_table_contains (written, uri)) {
+            g_free (uri);
+            continue;
+        }
+        // The URIs are used as keys of the string offsets
+        g_ptr_array_add (uris, uri);
+        g_hash_table_add (written, uri);
+
+        memset (&entry, 0, sizeof (entry));
+        entry.uri = library_add_string (strings, offsets, uri);
+        entry.duration = play_queue_item_get_duration (item);
+
+        // The information of local files is only reused as long as their
+        // modification time matches
+        mtime = g_hash_table_lookup (library->mtimes, uri);
+        if (mtime) {
+            entry.mtime = *mtime;
+        } else {
+            previous = library_lookup (library, uri);
+            if (previous)
+                entry.mtime = previous->mtime;
+            else if (play_queue_item_is_native (item)) {
+                GFile *file = g_file_new_for_uri (uri);
+
+                entry.mtime = library_get_mtime (file);
+                g_object_unref (file);
+            } else
+                entry.mtime = -1;
+        }
+        if (entry.mtime >= 0) {
+            entry.artist = library_add_string (
+                strings,
+                offsets,
+                play_queue_item_get_metadata (item, PLAY_METADATA_ARTIST));
+            entry.title = library_add_string (
+                strings,
+                offsets,
+                play_queue_item_get_metadata (item, PLAY_METADATA_TITLE));
+
+            // An item which has not been compared with the index keeps
+            // the stored information it has not learned itself, the
+            // modification time is compared on the next run
+            if (previous) {
+                if (!entry.artist)
+                    entry.artist = library_add_string (
+                        strings,
+                        offsets,
+                        library_get_string (library, previous->artist));
+                if (!entry.title)
+                    entry.title = library_add_string (
+                        strings,
+                        offsets,
+                        library_get_string (library, previous->title));
+                if (entry.duration < 0)
+                    entry.duration = previous->duration;
+            }
+        } else {
+            // Streams change their metadata as they are played
+            entry.duration = -1;
+        }
+        g_array_append_val (entries, entry);
+    }
+
+    // The index is updated incrementally, the tracks which have not been
+    // queued this time are copied from the current one
+    for (i = 0; i < library->count; i++) {
+        const PlayLibraryEntry *previous = LIBRARY_ENTRY (library, i);
+        PlayLibraryEntry entry;
+        const gchar *uri;
+
+        uri = library_get_string (library, previous->uri);
+        if (!*uri || g_hash_table_contains (written, uri))
+            continue;
+
+        entry = *previous;
+        entry.uri = library_add_string (strings, offsets, uri);
+        entry.artist = library_add_string (
+            strings,
+            offsets,
+            library_get_string (library, previous->artist));
+        entry.title = library_add_string (
+            strings,
+            offsets,
+            library_get_string (library, previous->title));
+
+        g_array_append_val (entries, entry);
+    }
+    g_hash_table_destroy (written);
+    g_hash_table_destroy (offsets);
+    g_ptr_array_unref (uris);
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, LIBRARY_MAGIC, sizeof (LIBRARY_MAGIC));
+    header.version = LIBRARY_VERSION;
+    header.count   = entries->len;
+    header.strings_size = (guint32) strings->len;
+
+    contents = g_string_sized_new (
+        sizeof (header) +
+        entries->len * sizeof (PlayLibraryEntry) +
+        strings->len);
+    g_string_append_len (contents, (const gchar *) &header, sizeof (header));
+    g_string_append_len (
+        contents,
+        entries->data,
+        entries->len * sizeof (PlayLibraryEntry));
+    g_string_append_len (contents, strings->str, strings->len);
+
+    g_array_free (entries, TRUE);
+    g_string_free (strings, TRUE);
+
+    // The file is replaced atomically, the current mapping stays valid
+    dir = g_path_get_dirname (library->path);
+    g_mkdir_with_parents (dir, 0700);
+    g_free (dir);
+
+    ret = g_file_set_contents (
+        library->path,
+        contents->str,
+        contents->len,
+        error);
+    g_string_free (contents, TRUE);
+    return ret;
+}
+
+// Return the string at the given offset of the string table
+static const gchar *library_get_string (PlayLibrary *library, guint32 offset)
+{
+    // The table is terminated by a null character, so any offset inside
+    // it points to a valid string
+    if (G_UNLIKELY (offset >= library->strings_size))
+        return "";
+
+    return library->strings + offset;
+}
+
+// Look up the index entry of the given URI
+// Returns NULL if the URI is not in the index
+static const PlayLibraryEntry *library_lookup (PlayLibrary *library,
+                                               const gchar *uri)
+{
+    if (!library->count)
+        return NULL;
+
+    // The lookup table is only needed when updating the index, loading
+    // the index does not need it
+    if (!library->index) {
+        guint i;
+
+        library->index = g_hash_table_new (g_str_hash, g_str_equal);
+        for (i = 0; i < library->count; i++) {
+            const PlayLibraryEntry *entry = LIBRARY_ENTRY (library, i);
+
+            g_hash_table_insert (
+                library->index,
+                (gpointer) library_get_string (library, entry->uri),
+                (gpointer) entry);
+        }
+    }
+    return g_hash_table_lookup (library->index, uri);
+}
+
+// Copy the duration and metadata of an index entry into a queue item
+static void library_apply_entry (PlayLibrary *library,
+                                 const PlayLibraryEntry *entry,
+                                 PlayQueueItem *item)
+{
+    if (entry->artist)
+        play_queue_item_set_metadata (
+            item,
+            PLAY_METADATA_ARTIST,
+            library_get_string (library, entry->artist));
+    if (entry->title)
+        play_queue_item_set_metadata (
+            item,
+            PLAY_METADATA_TITLE,
+            library_get_string (library, entry->title));
+
+    play_queue_item_set_duration (item, entry->duration);
+}
+
+// Read the modification time of a local file
+// Returns -1 if the time cannot be read
+static gint64 library_get_mtime (GFile *file)
+{
+    GFileInfo *info;
+    gint64     mtime;
+
+    info = g_file_query_info (
+        file,
+        G_FILE_ATTRIBUTE_TIME_MODIFIED,
+        G_FILE_QUERY_INFO_NONE,
+        NULL,
+        NULL);
+    if (!info)
+        return -1;
+
+    if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+        mtime = (gint64) g_file_info_get_attribute_uint64 (
+            info,
+            G_FILE_ATTRIBUTE_TIME_MODIFIED);
+    else
+        mtime = -1;
+
+    g_object_unref (info);
+    return mtime;
+}
+
+// Add a string to the string table being written and return its offset
+// Identical strings, such as artist names, are only stored once
+static guint32 library_add_string (GString *strings,
+                                   GHashTable *offsets,
+                                   const gchar *value)
+{
+    gpointer offset;
+
+    if (!value || !*value)
+        return 0;
+
+    if (g_hash_table_lookup_extended (offsets, value, NULL, &offset))
+        return GPOINTER_TO_UINT (offset);
+
+    offset = GUINT_TO_POINTER ((guint) strings->len);
+    g_string_append_len (strings, value, strlen (value) + 1);
+
+    // The key points to the caller's string, which outlives the table
+    g_hash_table_insert (offsets, (gpointer) value, offset);
+    return GPOINTER_TO_UINT (offset);
+}
+
+// Unmap the index file
+static void library_unload (PlayLibrary *library)
+{
+    if (library->index) {
+        g_hash_table_destroy (library->index);
+        library->index = NULL;
+    }
+    if (library->mapped) {
+        g_mapped_file_unref (library->mapped);
+        library->mapped = NULL;
+    }
+    library->count   = 0;
+    library->entries = NULL;
+    library->strings = NULL;
+    library->strings_size = 0;
+}
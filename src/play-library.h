@@ -0,0 +1,78 @@
+/**
+ * PLAY
+ * play-library.h: Persistent index of the media library
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#ifndef _PLAY_LIBRARY_H_
+#define _PLAY_LIBRARY_H_
+
+#include "play-common.h"
+#include "play-queue-item.h"
+
+G_BEGIN_DECLS
+
+#define PLAY_TYPE_LIBRARY                     \
+    (play_library_get_type())
+#define PLAY_LIBRARY(o)                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((o), PLAY_TYPE_LIBRARY, PlayLibrary))
+#define PLAY_LIBRARY_CLASS(k)                 \
+    (G_TYPE_CHECK_CLASS_CAST((k), PLAY_TYPE_LIBRARY, PlayLibraryClass))
+#define PLAY_IS_LIBRARY(o)                    \
+    (G_TYPE_CHECK_INSTANCE_TYPE((o), PLAY_TYPE_LIBRARY))
+#define PLAY_IS_LIBRARY_CLASS(k)              \
+    (G_TYPE_CHECK_CLASS_TYPE((k), PLAY_TYPE_LIBRARY))
+#define PLAY_LIBRARY_GET_CLASS(o)             \
+    (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_LIBRARY, PlayLibraryClass))
+
+typedef struct {
+    GObject        parent_instance;
+    gchar         *path;
+    GMappedFile   *mapped;
+    guint          count;
+    gconstpointer  entries;
+    const gchar   *strings;
+    gsize          strings_size;
+    GHashTable    *index;
+    GHashTable    *mtimes;
+} PlayLibrary;
+
+typedef struct {
+    GObjectClass   parent_class;
+} PlayLibraryClass;
+
+extern GType play_library_get_type (void);
+
+// Create a new library object using the index file at the given path
+// If the path is NULL, the index is stored in the "play" directory of
+// the user data directory
+extern PlayLibrary *play_library_new (const gchar *path);
+
+// Map the index file into memory
+// Returns TRUE on success, a missing or invalid index is reported as
+// an error and the library is then empty
+extern gboolean play_library_load (PlayLibrary *library, GError **error);
+
+// Return the number of tracks in the index
+extern guint play_library_get_count (PlayLibrary *library);
+
+// Create queue items of all the tracks in the index, including the known
+// durations and metadata, without accessing the media files
+// Free the returned array with g_ptr_array_unref()
+extern GPtrArray *play_library_get_items (PlayLibrary *library);
+
+// Compare the modification times of the given local queue items with the
+// index and copy the duration and metadata of the unchanged tracks into
+// the items
+// Returns the number of items which were found unchanged
+extern guint play_library_refresh (PlayLibrary *library, GPtrArray *items);
+
+// Write a new index consisting of the given queue items, the tracks of
+// the current index which are not among them are kept unchanged
+// Returns TRUE on success
+extern gboolean play_library_save (PlayLibrary *library,
+                                   GPtrArray *items,
+                                   GError **error);
+
+G_END_DECLS
+
+#endif // _PLAY_LIBRARY_H_
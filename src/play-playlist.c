@@ -7,26 +7,80 @@
 #include <libxml/tree.h>
 #include <libxml/uri.h>
 #include "play-common.h"
+#include "play-cache.h"
 #include "play-downloader.h"
 #include "play-playlist.h"
 #include "play-queue-item.h"
+#include "play-stats.h"
 
 G_DEFINE_TYPE (PlayPlaylist, play_playlist, G_TYPE_OBJECT);
 
+// Number of bytes of a playlist read and processed at once
+#define PLAYLIST_CHUNK_SIZE (64 * 1024)
+
+// Maximum number of items delivered in a single "queue-items" signal
+#define PLAYLIST_BATCH_SIZE 256
+
 typedef struct {
     guint            id;
     PlayPlaylistType type;
     GFile           *file;
+    gchar           *cache_path;
+    GPtrArray       *cache_items;
+    GFileInfo       *cache_info;
     PlayQueueItem   *item;
+    GPtrArray       *items;
     PlayPlaylist    *playlist;
     gpointer         custom;
+    gint             priority;
+    guint            download;
+    GByteArray      *buffer;
+    const gchar     *charset_from;
+    const gchar     *charset_to;
+    xmlParserCtxtPtr parser;
+    GString         *text;
+    guint            depth;
+    guint            field;
+    gboolean         in_list;
+    gboolean         has_root;
+    gboolean         invalid;
+    gint64           time_started;
 } PlayPlaylistData;
 
+// Elements of an XML playlist entry whose text content is read
+enum {
+    PLAYLIST_FIELD_NONE,
+    PLAYLIST_FIELD_LOCATION,
+    PLAYLIST_FIELD_ARTIST,
+    PLAYLIST_FIELD_TITLE
+};
+
 // Return the playlist type based on the file suffix
 static PlayPlaylistType playlist_get_type (const gchar *file_or_uri);
 
+// Check whether a cached remote playlist has changed and if so, download
+// it again in the background to update the cache
+static void playlist_revalidate (PlayPlaylist *playlist, GFile *file);
+
+// Function called after the cache attributes of a remote playlist have
+// been retrieved
+static void playlist_revalidate_finished (GObject *source,
+                                          GAsyncResult *result,
+                                          PlayPlaylist *playlist);
+
+// Store the items of a downloaded playlist in the cache
+static void playlist_cache_store (PlayPlaylistData *data);
+
 // Initiate a playlist download
-static void playlist_download (PlayPlaylistData *data, const gchar *template);
+// The playlist is parsed as its content is being received
+static void playlist_download (PlayPlaylistData *data);
+
+// A chunk of a playlist has been downloaded
+static void playlist_download_data (PlayDownloader *downloader,
+                                    guint id,
+                                    GByteArray *chunk,
+                                    gpointer custom,
+                                    PlayPlaylist *playlist);
 
 // Playlist download progress indicator
 static void playlist_download_progress (PlayDownloader *downloader,
@@ -50,45 +104,95 @@ static void playlist_download_failed (PlayDownloader *downloader,
                                       gpointer custom,
                                       PlayPlaylist *playlist);
 
-// Parse a playlist in the ASX file format
-// If the playlist is not a local file, it is downloaded first
-static gboolean playlist_parse_asx (PlayPlaylistData *data);
-
 // Parse a playlist in the M3U file format
 // If the playlist is not a local file, it is read and parsed directly
-// from the network as this format allows line-by-line parsing
+// from the network in chunks as this format allows line-by-line parsing
 static gboolean playlist_parse_m3u (PlayPlaylistData *data);
 
 // Parse a playlist in the PLS file format
-// If the playlist is not a local file, it is downloaded first
+// If the playlist is not a local file, it is downloaded into memory first
 static gboolean playlist_parse_pls (PlayPlaylistData *data);
 
-// Parse a playlist in the XSPF file format
-// If the playlist is not a local file, it is downloaded first
-static gboolean playlist_parse_xspf (PlayPlaylistData *data);
+// Parse a playlist in the ASX or XSPF file format
+// If the playlist is not a local file, it is read and parsed directly
+// from the network in chunks using a streaming XML parser
+static gboolean playlist_parse_xml (PlayPlaylistData *data);
 
-// Process a locally stored ASX playlist
-static void playlist_parse_asx_file (PlayPlaylistData *data,
+// Process a locally stored M3U playlist
+static void playlist_parse_m3u_file (PlayPlaylistData *data,
                                      const gchar *file);
 
-// Start asynchronous reading from the playlist
-// Function called after a local M3U playlist has been opened for reading
-static void playlist_parse_m3u_read (GObject *source,
-                                     GAsyncResult *result,
-                                     PlayPlaylistData *data);
+// Parse the complete lines of a chunk downloaded from a remote M3U playlist
+// An incomplete last line is kept until the next chunk arrives
+static void playlist_parse_m3u_chunk (PlayPlaylistData *data,
+                                      GByteArray *chunk);
+
+// Parse the rest of a remote M3U playlist once its download has finished
+static void playlist_parse_m3u_end (PlayPlaylistData *data);
+
+// Parse a block of complete lines of a M3U playlist
+// The lines are split in place, so the text must be writable
+static void playlist_parse_m3u_lines (PlayPlaylistData *data,
+                                      gchar *text,
+                                      gsize length);
 
 // Parse a single line of a M3U playlist
-static void playlist_parse_m3u_line (GObject *source,
-                                     GAsyncResult *result,
-                                     PlayPlaylistData *data);
+static void playlist_parse_m3u_line (PlayPlaylistData *data, gchar *line);
 
 // Process a locally stored PLS playlist
 static void playlist_parse_pls_file (PlayPlaylistData *data,
                                      const gchar *file);
 
-// Process a locally stored XSPF playlist
-static void playlist_parse_xspf_file (PlayPlaylistData *data,
-                                      const gchar *file);
+// Parse the content of a PLS playlist
+static void playlist_parse_pls_data (PlayPlaylistData *data,
+                                     const gchar *text,
+                                     gsize length);
+
+// Process a locally stored ASX or XSPF playlist
+static void playlist_parse_xml_file (PlayPlaylistData *data,
+                                     const gchar *file);
+
+// Create a streaming XML parser for an ASX or XSPF playlist
+static void playlist_parse_xml_begin (PlayPlaylistData *data);
+
+// Pass a chunk of an ASX or XSPF playlist to the streaming XML parser
+// Returns FALSE if the playlist has turned out not to be valid
+static gboolean playlist_parse_xml_chunk (PlayPlaylistData *data,
+                                          const gchar *chunk,
+                                          gsize length,
+                                          gboolean terminate);
+
+// Finish parsing an ASX or XSPF playlist
+static void playlist_parse_xml_end (PlayPlaylistData *data);
+
+// XML parser callback for an opening tag
+static void playlist_xml_start_element (PlayPlaylistData *data,
+                                        const xmlChar *name,
+                                        const xmlChar *prefix,
+                                        const xmlChar *uri,
+                                        int nb_namespaces,
+                                        const xmlChar **namespaces,
+                                        int nb_attributes,
+                                        int nb_defaulted,
+                                        const xmlChar **attributes);
+
+// XML parser callback for a closing tag
+static void playlist_xml_end_element (PlayPlaylistData *data,
+                                      const xmlChar *name,
+                                      const xmlChar *prefix,
+                                      const xmlChar *uri);
+
+// XML parser callback for text content
+static void playlist_xml_characters (PlayPlaylistData *data,
+                                     const xmlChar *text,
+                                     int length);
+
+// Add an item found in the playlist to the current batch
+// The batch is emitted when it reaches the maximum size
+static void playlist_add_item (PlayPlaylistData *data, PlayQueueItem *item);
+
+// Emit the current batch of items found in the playlist
+static void playlist_flush_items (PlayPlaylistData *data);
 
 // Free memory allocated for a temporary data structure
 static void playlist_free_data (PlayPlaylistData *data);
@@ -98,7 +202,7 @@ enum {
     DOWNLOAD_PROGRESS,
     ERROR,
     FINISHED,
-    QUEUE_ITEM,
+    QUEUE_ITEMS,
     LAST_SIGNAL
 };
 static guint signals[LAST_SIGNAL];
@@ -110,6 +214,9 @@ static void play_playlist_finalize (GObject *object)
 
     // Clean up
     g_object_unref (playlist->downloader);
+    g_object_unref (playlist->cache);
+    if (playlist->refresh)
+        g_object_unref (playlist->refresh);
     g_hash_table_destroy (playlist->data);
 
     // Chain up to the parent class
@@ -123,6 +230,9 @@ static void play_playlist_class_init (PlayPlaylistClass *klass)
 
     gobject_class->finalize = play_playlist_finalize;
 
+    // Initialize the XML library once, it is shared by all the parsers
+    xmlInitParser ();
+
     signals[DOWNLOAD_PROGRESS] =
         g_signal_new ("download-progress",
                       G_TYPE_FROM_CLASS (gobject_class),
@@ -162,18 +272,18 @@ static void play_playlist_class_init (PlayPlaylistClass *klass)
                       2,
                       G_TYPE_UINT,
                       G_TYPE_POINTER);
-    signals[QUEUE_ITEM] =
-        g_signal_new ("queue-item",
+    signals[QUEUE_ITEMS] =
+        g_signal_new ("queue-items",
                       G_TYPE_FROM_CLASS (gobject_class),
                       G_SIGNAL_RUN_LAST,
-                      G_STRUCT_OFFSET (PlayPlaylistClass, queue_item),
+                      G_STRUCT_OFFSET (PlayPlaylistClass, queue_items),
                       NULL,
                       NULL,
-                      play_marshal_VOID__UINT_OBJECT_POINTER,
+                      play_marshal_VOID__UINT_POINTER_POINTER,
                       G_TYPE_NONE,
                       3,
                       G_TYPE_UINT,
-                      G_TYPE_OBJECT,
+                      G_TYPE_POINTER,
                       G_TYPE_POINTER);
 }
 
@@ -186,12 +296,20 @@ static void play_playlist_init (PlayPlaylist *playlist)
         NULL,
         (GDestroyNotify) playlist_free_data);
 
+    playlist->cache = play_cache_new ();
+    playlist->cache_read = TRUE;
+
     playlist->downloader = play_downloader_new ();
     g_signal_connect (
         playlist->downloader,
         "progress",
         G_CALLBACK (playlist_download_progress),
         playlist);
+    g_signal_connect (
+        playlist->downloader,
+        "data",
+        G_CALLBACK (playlist_download_data),
+        playlist);
     g_signal_connect (
         playlist->downloader,
         "finished",
@@ -283,10 +401,28 @@ guint play_playlist_parse_gfile (PlayPlaylist *playlist,
     data->file = g_object_ref (file);
     data->playlist = playlist;
     data->custom = custom;
+    data->time_started = g_get_monotonic_time ();
+
+    // Serve a remote playlist from the cache if possible, the cached copy
+    // is a local M3U8 playlist
+    if (playlist->cache_read && !g_file_is_native (file)) {
+        gboolean expired = FALSE;
+        gchar   *uri;
+
+        uri = g_file_get_uri (file);
+        data->cache_path = play_cache_lookup (playlist->cache, uri, &expired);
+        if (data->cache_path) {
+            data->type = PLAY_PLAYLIST_TYPE_M3U_UTF8;
+            if (expired)
+                playlist_revalidate (playlist, file);
+        }
+        g_free (uri);
+    }
 
-    switch (type) {
+    switch (data->type) {
         case PLAY_PLAYLIST_TYPE_ASX:
-            g_idle_add ((GSourceFunc) playlist_parse_asx, data);
+        case PLAY_PLAYLIST_TYPE_XSPF:
+            g_idle_add ((GSourceFunc) playlist_parse_xml, data);
             break;
         case PLAY_PLAYLIST_TYPE_M3U:
         case PLAY_PLAYLIST_TYPE_M3U_UTF8:
@@ -295,9 +431,6 @@ guint play_playlist_parse_gfile (PlayPlaylist *playlist,
         case PLAY_PLAYLIST_TYPE_PLS:
             g_idle_add ((GSourceFunc) playlist_parse_pls, data);
             break;
-        case PLAY_PLAYLIST_TYPE_XSPF:
-            g_idle_add ((GSourceFunc) playlist_parse_xspf, data);
-            break;
         default:
             g_assert_not_reached ();
             playlist_free_data (data);
@@ -311,6 +444,62 @@ guint play_playlist_parse_gfile (PlayPlaylist *playlist,
     return data->id;
 }
 
+// Set the priority of downloading a remote playlist specified by
+// the playlist ID, playlists with lower values are downloaded first
+// Returns TRUE on success
+gboolean play_playlist_set_priority (PlayPlaylist *playlist,
+                                     guint id,
+                                     gint priority)
+{
+    PlayPlaylistData *data;
+
+    g_return_val_if_fail (PLAY_IS_PLAYLIST (playlist), FALSE);
+
+    data = g_hash_table_lookup (playlist->data, GUINT_TO_POINTER (id));
+    if (!data)
+        return FALSE;
+
+    data->priority = priority;
+
+    // The download is started from the main loop, usually after
+    // the priority has been set
+    if (data->download)
+        play_downloader_set_priority (
+            playlist->downloader,
+            data->download,
+            priority);
+    return TRUE;
+}
+
+// Set the maximum number of remote playlists downloaded at the same time
+// in total and from a single host, use 0 for no limit
+void play_playlist_set_max_downloads (PlayPlaylist *playlist,
+                                      guint max_downloads,
+                                      guint max_downloads_host)
+{
+    g_return_if_fail (PLAY_IS_PLAYLIST (playlist));
+
+    play_downloader_set_max_downloads (
+        playlist->downloader,
+        max_downloads,
+        max_downloads_host);
+}
+
+// Set the number of seconds to wait for a connection to be established
+// and for more data to arrive before a download fails, use 0 to wait
+// indefinitely
+void play_playlist_set_download_timeouts (PlayPlaylist *playlist,
+                                          guint timeout_connect,
+                                          guint timeout_read)
+{
+    g_return_if_fail (PLAY_IS_PLAYLIST (playlist));
+
+    play_downloader_set_timeouts (
+        playlist->downloader,
+        timeout_connect,
+        timeout_read);
+}
+
 // Return TRUE if the given file or URI is a supported playlist
 gboolean play_playlist_file_is_playlist (const gchar *file)
 {
@@ -337,16 +526,98 @@ static PlayPlaylistType playlist_get_type (const gchar *file_name)
     return PLAY_PLAYLIST_TYPE_UNKNOWN;
 }
 
+// Check whether a cached remote playlist has changed and if so, download
+// it again in the background to update the cache
+static void playlist_revalidate (PlayPlaylist *playlist, GFile *file)
+{
+    g_file_query_info_async (
+        file,
+        PLAY_CACHE_ATTRIBUTES,
+        G_FILE_QUERY_INFO_NONE,
+        G_PRIORITY_LOW,
+        NULL,
+        (GAsyncReadyCallback) playlist_revalidate_finished,
+        g_object_ref (playlist));
+}
+
+// Function called after the cache attributes of a remote playlist have
+// been retrieved
+static void playlist_revalidate_finished (GObject *source,
+                                          GAsyncResult *result,
+                                          PlayPlaylist *playlist)
+{
+    GFileInfo *info;
+    gchar     *uri;
+
+    // Keep using the cached copy if the playlist cannot be reached
+    info = g_file_query_info_finish (G_FILE (source), result, NULL);
+    if (!info) {
+        g_object_unref (playlist);
+        return;
+    }
+    uri = g_file_get_uri (G_FILE (source));
+    if (!play_cache_validate (playlist->cache, uri, info)) {
+        // The playlist has changed or it cannot be validated, parse it
+        // again using a playlist object which bypasses the cache, the
+        // updated items will be used the next time
+        if (!playlist->refresh) {
+            playlist->refresh = play_playlist_new ();
+            playlist->refresh->cache_read = FALSE;
+            // Refreshing must not delay downloads of playlists which
+            // are going to be played
+            play_downloader_set_io_priority (
+                playlist->refresh->downloader,
+                G_PRIORITY_LOW);
+            play_downloader_set_max_downloads (
+                playlist->refresh->downloader,
+                playlist->downloader->max_downloads,
+                playlist->downloader->max_downloads_host);
+            play_downloader_set_timeouts (
+                playlist->refresh->downloader,
+                playlist->downloader->timeout_connect,
+                playlist->downloader->timeout_read);
+        }
+        play_playlist_parse_gfile (playlist->refresh, G_FILE (source), NULL);
+    }
+    g_object_unref (info);
+    g_free (uri);
+    g_object_unref (playlist);
+}
+
+// Store the items of a downloaded playlist in the cache
+static void playlist_cache_store (PlayPlaylistData *data)
+{
+    gchar *uri;
+
+    if (!data->cache_items)
+        return;
+
+    uri = g_file_get_uri (data->file);
+    // The metadata of M3U playlists have been converted to the locale
+    // character set, the other formats are read in UTF-8
+    play_cache_store (
+        data->playlist->cache,
+        uri,
+        data->cache_items,
+        data->cache_info,
+        data->charset_to);
+    g_free (uri);
+}
+
 // Initiate a playlist download
-static void playlist_download (PlayPlaylistData *data, const gchar *template)
+// The playlist is parsed as its content is being received
+static void playlist_download (PlayPlaylistData *data)
 {
     gchar *uri = g_file_get_uri (data->file);
 
-    if (!play_downloader_download_temp (
-            data->playlist->downloader,
-            uri,
-            template,
-            GUINT_TO_POINTER (data->id))) {
+    // Keep all the items to store them in the cache after the download
+    data->cache_items = g_ptr_array_new_with_free_func (g_object_unref);
+
+    data->download = play_downloader_download_stream (
+        data->playlist->downloader,
+        uri,
+        GUINT_TO_POINTER (data->id));
+    if (!data->download) {
         g_signal_emit (
             data->playlist,
             signals[ERROR],
@@ -358,7 +629,11 @@ static void playlist_download (PlayPlaylistData *data, const gchar *template)
         g_hash_table_remove (
             data->playlist->data,
             GUINT_TO_POINTER (data->id));
-    }
+    } else
+        play_downloader_set_priority (
+            data->playlist->downloader,
+            data->download,
+            data->priority);
     g_free (uri);
 }
 
@@ -387,6 +662,51 @@ static void playlist_download_progress (PlayDownloader *downloader,
         data->custom);
 }
 
+// A chunk of a playlist has been downloaded
+static void playlist_download_data (PlayDownloader *downloader,
+                                    guint id,
+                                    GByteArray *chunk,
+                                    gpointer custom,
+                                    PlayPlaylist *playlist)
+{
+    PlayPlaylistData *data;
+
+    data = g_hash_table_lookup (playlist->data, custom);
+    if (G_UNLIKELY (!data)) {
+        g_assert_not_reached ();
+        return;
+    }
+    switch (data->type) {
+        case PLAY_PLAYLIST_TYPE_ASX:
+        case PLAY_PLAYLIST_TYPE_XSPF:
+            // The XML parser keeps its own state between chunks
+            if (!playlist_parse_xml_chunk (
+                    data,
+                    (const gchar *) chunk->data,
+                    chunk->len,
+                    FALSE)) {
+                // Stop downloading a playlist which is not valid
+                play_downloader_cancel (downloader, id);
+                playlist_parse_xml_end (data);
+            }
+            break;
+        case PLAY_PLAYLIST_TYPE_M3U:
+        case PLAY_PLAYLIST_TYPE_M3U_UTF8:
+            playlist_parse_m3u_chunk (data, chunk);
+            break;
+        case PLAY_PLAYLIST_TYPE_PLS:
+            // The key file parser needs the whole playlist at once
+            if (!data->buffer)
+                data->buffer = g_byte_array_sized_new (chunk->len);
+
+            g_byte_array_append (data->buffer, chunk->data, chunk->len);
+            break;
+        default:
+            g_assert_not_reached ();
+            break;
+    }
+}
+
 // Playlist download completion indicator
 static void playlist_download_finished (PlayDownloader *downloader,
                                         guint id,
@@ -395,38 +715,42 @@ static void playlist_download_finished (PlayDownloader *downloader,
                                         PlayPlaylist *playlist)
 {
     PlayPlaylistData *data;
-    gchar *path;
 
     data = g_hash_table_lookup (playlist->data, custom);
     if (G_UNLIKELY (!data)) {
         g_assert_not_reached ();
         return;
     }
-    path = g_file_get_path (destination);
-    if (G_LIKELY (path)) {
-        switch (data->type) {
-            case PLAY_PLAYLIST_TYPE_ASX:
-                playlist_parse_asx_file (data, path);
-                break;
-            case PLAY_PLAYLIST_TYPE_PLS:
-                playlist_parse_pls_file (data, path);
-                break;
-            case PLAY_PLAYLIST_TYPE_XSPF:
-                playlist_parse_xspf_file (data, path);
-                break;
-            default:
-                g_assert_not_reached ();
-                break;
-        }
-        g_free (path);
-    } else {
-        g_assert_not_reached ();
-    }
-    // Delete the downloaded file
-    g_file_delete (destination, NULL, NULL);
+    // Keep the entity tag and modification time for the cache
+    data->cache_info = play_downloader_get_info (downloader, id);
+    if (data->cache_info)
+        g_object_ref (data->cache_info);
 
-    // Delete data of the current item
-    g_hash_table_remove (playlist->data, custom);
+    // Each of the functions deletes data of the current item
+    switch (data->type) {
+        case PLAY_PLAYLIST_TYPE_ASX:
+        case PLAY_PLAYLIST_TYPE_XSPF:
+            playlist_parse_xml_chunk (data, NULL, 0, TRUE);
+            playlist_parse_xml_end (data);
+            break;
+        case PLAY_PLAYLIST_TYPE_M3U:
+        case PLAY_PLAYLIST_TYPE_M3U_UTF8:
+            playlist_parse_m3u_end (data);
+            break;
+        case PLAY_PLAYLIST_TYPE_PLS:
+            if (data->buffer)
+                playlist_parse_pls_data (
+                    data,
+                    (const gchar *) data->buffer->data,
+                    data->buffer->len);
+            else
+                playlist_parse_pls_data (data, "", 0);
+            break;
+        default:
+            g_assert_not_reached ();
+            g_hash_table_remove (playlist->data, custom);
+            break;
+    }
 }
 
 // Playlist download failure indicator
@@ -443,6 +767,8 @@ static void playlist_download_failed (PlayDownloader *downloader,
         g_assert_not_reached ();
         return;
     }
+    // Deliver the items found before the error
+    playlist_flush_items (data);
     g_signal_emit (
         data->playlist,
         signals[ERROR],
@@ -455,43 +781,48 @@ static void playlist_download_failed (PlayDownloader *downloader,
     g_hash_table_remove (playlist->data, custom);
 }
 
-// Parse a playlist in the ASX file format
-// If the playlist is not a local file, it is downloaded first
-static gboolean playlist_parse_asx (PlayPlaylistData *data)
+// Parse a playlist in the M3U file format
+// If the playlist is not a local file, it is read and parsed directly
+// from the network in chunks as this format allows line-by-line parsing
+static gboolean playlist_parse_m3u (PlayPlaylistData *data)
 {
-    char *path;
+    const gchar *charset;
+    gboolean     is_utf8;
+    char        *path;
 
-    path = g_file_get_path (data->file);
+    // Find out once for the whole playlist whether the text has to be
+    // converted to encoding of the current system locale
+    is_utf8 = g_get_charset (&charset);
+    if (data->type == PLAY_PLAYLIST_TYPE_M3U_UTF8) {
+        if (!is_utf8) {
+            data->charset_from = "UTF-8";
+            data->charset_to   = charset;
+        }
+    } else {
+        // The original M3U file format should be in WINDOWS-1252 encoding
+        data->charset_from = "WINDOWS-1252";
+        data->charset_to   = charset;
+    }
+
+    // A cached remote playlist is parsed from the local copy
+    if (data->cache_path)
+        path = g_strdup (data->cache_path);
+    else
+        path = g_file_get_path (data->file);
     if (path) {
         // Local file, parse it directly
-        playlist_parse_asx_file (data, (const gchar *) path);
+        playlist_parse_m3u_file (data, (const gchar *) path);
         g_free (path);
     } else {
-        // Download the file to a temporary location
-        playlist_download (data, "play-XXXXXX.asx");
+        // Remote file, parse it in chunks as it is being downloaded
+        playlist_download (data);
     }
     // Return FALSE to stop the function from being called again
     return FALSE;
 }
 
-// Parse a playlist in the M3U file format
-// If the playlist is not a local file, it is read and parsed directly
-// from the network as this format allows line-by-line parsing
-static gboolean playlist_parse_m3u (PlayPlaylistData *data)
-{
-    g_file_read_async (
-        data->file,
-        G_PRIORITY_DEFAULT,
-        NULL,
-        (GAsyncReadyCallback) playlist_parse_m3u_read,
-        data);
-
-    // Return FALSE to stop the function from being called again
-    return FALSE;
-}
-
 // Parse a playlist in the PLS file format
-// If the playlist is not a local file, it is downloaded first
+// If the playlist is not a local file, it is downloaded into memory first
 static gboolean playlist_parse_pls (PlayPlaylistData *data)
 {
     char *path;
@@ -502,157 +833,81 @@ static gboolean playlist_parse_pls (PlayPlaylistData *data)
         playlist_parse_pls_file (data, (const gchar *) path);
         g_free (path);
     } else {
-        // Download the file to a temporary location
-        playlist_download (data, "play-XXXXXX.pls");
+        // Download the file into memory
+        playlist_download (data);
     }
     // Return FALSE to stop the function from being called again
     return FALSE;
 }
 
-// Parse a playlist in the XSPF file format
-// If the playlist is not a local file, it is downloaded first
-static gboolean playlist_parse_xspf (PlayPlaylistData *data)
+// Parse a playlist in the ASX or XSPF file format
+// If the playlist is not a local file, it is read and parsed directly
+// from the network in chunks using a streaming XML parser
+static gboolean playlist_parse_xml (PlayPlaylistData *data)
 {
     char *path;
 
     path = g_file_get_path (data->file);
     if (path) {
         // Local file, parse it directly
-        playlist_parse_xspf_file (data, (const gchar *) path);
+        playlist_parse_xml_file (data, (const gchar *) path);
         g_free (path);
     } else {
-        // Download the file to a temporary location
-        playlist_download (data, "play-XXXXXX.xspf");
+        // Remote file, parse it in chunks as it is being downloaded
+        playlist_parse_xml_begin (data);
+        playlist_download (data);
     }
     // Return FALSE to stop the function from being called again
     return FALSE;
 }
 
-// Process a locally stored ASX playlist
-static void playlist_parse_asx_file (PlayPlaylistData *data, const gchar *file)
+// Process a locally stored M3U playlist
+static void playlist_parse_m3u_file (PlayPlaylistData *data, const gchar *file)
 {
-    xmlDocPtr doc;
-    xmlNode  *root, *n1, *n2;
-
-    doc = xmlReadFile (
-        file,
-        NULL,
-        XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
-    if (!doc) {
+    GMappedFile *mapped;
+    GError      *error = NULL;
+    gchar       *contents;
+    gsize        length;
+    gsize        offset = 0;
+
+    // Map the file privately, which allows the lines to be split in place
+    // without modifying the file
+    mapped = g_mapped_file_new (file, TRUE, &error);
+    if (!mapped) {
         g_signal_emit (
             data->playlist,
             signals[ERROR],
             0,
             data->id,
-            "Error parsing XML file format",
+            error->message,
             data->custom);
 
+        g_error_free (error);
         // Delete data of the current item
         g_hash_table_remove (
             data->playlist->data,
             GUINT_TO_POINTER (data->id));
         return;
     }
-    // Get the root element - must be <asx>
-    root = xmlDocGetRootElement (doc);
-    if (!root ||
-        !root->name ||
-        xmlStrcasecmp (root->name, (const xmlChar *) "asx")) {
-        xmlFreeDoc (doc);
-        g_signal_emit (
-            data->playlist,
-            signals[ERROR],
-            0,
-            data->id,
-            "Invalid file format",
-            data->custom);
+    contents = g_mapped_file_get_contents (mapped);
+    length   = g_mapped_file_get_length (mapped);
 
-        // Delete data of the current item
-        g_hash_table_remove (
-            data->playlist->data,
-            GUINT_TO_POINTER (data->id));
-        return;
-    }
-    // Read all the child nodes inside the parent <asx>
-    for (n1 = root->children; n1 != NULL; n1 = n1->next) {
-        PlayQueueItem *item;
-
-        // Only read <entry> nodes which contain playlist items
-        if (g_ascii_strcasecmp((const gchar *) n1->name, "entry"))
-            continue;
-
-        item = play_queue_item_new ();
-
-        // Read child nodes inside an <entry>
-        for (n2 = n1->children; n2 != NULL; n2 = n2->next) {
-            // <ref> specifies a URI
-            if (!g_ascii_strcasecmp ((const gchar *) n2->name, "ref")) {
-                xmlAttrPtr href = NULL;
-                xmlAttrPtr tmp;
-
-                // The URI is inside the href attribute
-                tmp = n2->properties;
-                while (tmp) {
-                    if (!xmlStrcasecmp (tmp->name, (const xmlChar *) "href")) {
-                        href = tmp;
-                        break;
-                    }
-                    tmp = tmp->next;
-                }
-                if (href) {
-                    xmlChar *location = xmlGetProp (n2, href->name);
-
-                    if (G_LIKELY (location)) {
-                        play_queue_item_set_file_or_uri (
-                            item,
-                            (const gchar *) location);
-                        xmlFree (location);
-                    }
-                }
-            }
-            // Optional track artist
-            if (!g_ascii_strcasecmp((const gchar *) n2->name, "author")) {
-                xmlChar *content;
-
-                content = xmlNodeGetContent (n2);
-                if (content) {
-                    play_queue_item_set_metadata (
-                        item,
-                        PLAY_METADATA_ARTIST,
-                        (const gchar *) content);
-                    xmlFree (content);
-                }
-            }
-            // Optional track title
-            if (!g_ascii_strcasecmp ((const gchar *) n2->name, "title")) {
-                xmlChar *content;
-
-                content = xmlNodeGetContent (n2);
-                if (content) {
-                    play_queue_item_set_metadata (
-                        item,
-                        PLAY_METADATA_TITLE,
-                        (const gchar *) content);
-                    xmlFree (content);
-                }
-            }
+    // Process the file in chunks of complete lines
+    while (offset < length) {
+        gsize end = MIN (offset + PLAYLIST_CHUNK_SIZE, length);
+
+        if (end < length) {
+            gchar *eol = memchr (contents + end, '\n', length - end);
+
+            end = eol ? (gsize) (eol - contents) + 1 : length;
         }
-        // Check if a URI was found in the current <entry> and if so,
-        // add the item to the queue
-        if (play_queue_item_is_valid (item))
-            g_signal_emit (
-                data->playlist,
-                signals[QUEUE_ITEM],
-                0,
-                data->id,
-                item,
-                data->custom);
-        g_object_unref (item);
+        playlist_parse_m3u_lines (data, contents + offset, end - offset);
+        offset = end;
     }
-    xmlFreeDoc (doc);
-    xmlCleanupParser ();
+    g_mapped_file_unref (mapped);
 
-    // Signal that parsing of the playlist has finished
+    playlist_flush_items (data);
+    playlist_cache_store (data);
     g_signal_emit (
         data->playlist,
         signals[FINISHED],
@@ -664,160 +919,192 @@ static void playlist_parse_asx_file (PlayPlaylistData *data, const gchar *file)
     g_hash_table_remove (data->playlist->data, GUINT_TO_POINTER (data->id));
 }
 
-// Start asynchronous reading from the playlist
-// Function called after a local M3U playlist has been opened for reading
-static void playlist_parse_m3u_read (GObject *source,
-                                     GAsyncResult *result,
-                                     PlayPlaylistData *data)
+// Parse the complete lines of a chunk downloaded from a remote M3U playlist
+// An incomplete last line is kept until the next chunk arrives
+static void playlist_parse_m3u_chunk (PlayPlaylistData *data,
+                                      GByteArray *chunk)
 {
-    GFileInputStream *input;
-    GError *error = NULL;
+    guint pending;
+    guint i;
 
-    input = g_file_read_finish (
-        G_FILE (source),
-        result,
-        &error);
-    if (!input) {
-        g_signal_emit (
-            data->playlist,
-            signals[ERROR],
-            0,
-            data->id,
-            error->message,
-            data->custom);
+    // The chunk is appended after the incomplete line left over from
+    // the previous chunk
+    if (!data->buffer)
+        data->buffer = g_byte_array_sized_new (chunk->len);
 
-        g_error_free (error);
-        // Delete data of the current item
-        g_hash_table_remove (
-            data->playlist->data,
-            GUINT_TO_POINTER (data->id));
-        return;
+    pending = data->buffer->len;
+    g_byte_array_append (data->buffer, chunk->data, chunk->len);
+
+    // Find the end of the last complete line, the data left over from
+    // the previous chunk contains no newline
+    for (i = data->buffer->len; i > pending; i--)
+        if (data->buffer->data[i - 1] == '\n')
+            break;
+
+    if (i > pending) {
+        playlist_parse_m3u_lines (data, (gchar *) data->buffer->data, i);
+        g_byte_array_remove_range (data->buffer, 0, i);
     }
-    // Asynchronously read a single line from the input stream
-    g_data_input_stream_read_line_async (
-        g_data_input_stream_new (G_INPUT_STREAM (input)),
-        G_PRIORITY_DEFAULT,
-        NULL,
-        (GAsyncReadyCallback) playlist_parse_m3u_line,
-        data);
-    g_object_unref (input);
 }
 
-// Parse a single line of a M3U playlist
-static void playlist_parse_m3u_line (GObject *source,
-                                     GAsyncResult *result,
-                                     PlayPlaylistData *data)
+// Parse the rest of a remote M3U playlist once its download has finished
+static void playlist_parse_m3u_end (PlayPlaylistData *data)
 {
-    char       *line;
-    GError     *error = NULL;
-    const char *charset = NULL;
-    gboolean    is_utf8;
-
-    // Read the result of the asynchronous operation
-    line = g_data_input_stream_read_line_finish (
-        G_DATA_INPUT_STREAM (source),
-        result,
-        NULL,
-        &error);
-    if (!line) {
-        if (error) {
-            g_signal_emit (
-                data->playlist,
-                signals[ERROR],
-                0,
-                data->id,
-                error->message,
-                data->custom);
-            g_error_free (error);
+    // Parse the last line which does not have to be terminated by a newline
+    if (data->buffer)
+        playlist_parse_m3u_lines (
+            data,
+            (gchar *) data->buffer->data,
+            data->buffer->len);
+
+    playlist_flush_items (data);
+    playlist_cache_store (data);
+    g_signal_emit (
+        data->playlist,
+        signals[FINISHED],
+        0,
+        data->id,
+        data->custom);
+
+    // Delete data of the current item
+    g_hash_table_remove (data->playlist->data, GUINT_TO_POINTER (data->id));
+}
+
+// Parse a block of complete lines of a M3U playlist
+// The lines are split in place, so the text must be writable
+static void playlist_parse_m3u_lines (PlayPlaylistData *data,
+                                      gchar *text,
+                                      gsize length)
+{
+    gchar    *converted = NULL;
+    gchar    *end;
+    gboolean  convert_lines = FALSE;
+
+    // Convert the whole block to encoding of the current system locale
+    // A single invalid sequence fails the whole conversion, the lines are
+    // then converted one by one so that only the invalid ones are kept
+    // unconverted
+    if (data->charset_from) {
+        gsize written;
+
+        converted = g_convert (
+            text, length,
+            data->charset_to, data->charset_from,
+            NULL, &written, NULL);
+        if (converted) {
+            text   = converted;
+            length = written;
         } else {
-            g_signal_emit (
-                data->playlist,
-                signals[FINISHED],
-                0,
-                data->id,
-                data->custom);
+            convert_lines = TRUE;
         }
-        // Delete data of the current item
-        g_hash_table_remove (
-            data->playlist->data,
-            GUINT_TO_POINTER (data->id));
-
-        g_object_unref (source);
-        return;
     }
-    is_utf8 = g_get_charset (&charset);
-
-    // Convert the line to encoding of the current system locale if the system
-    // locale is not UTF-8
-    if (data->type == PLAY_PLAYLIST_TYPE_M3U_UTF8) {
-        if (!is_utf8) {
-            gchar *converted = g_locale_from_utf8 (
+    end = text + length;
+    while (text < end) {
+        gchar *line = text;
+        gchar *copy = NULL;
+        gchar *eol;
+
+        eol = memchr (text, '\n', end - text);
+        if (eol) {
+            *eol = '\0';
+            text = eol + 1;
+        } else {
+            // The last line of the playlist is not terminated by a newline
+            // and there might be no room for the terminating character
+            line = copy = g_strndup (text, end - text);
+            text = end;
+        }
+        if (convert_lines) {
+            gchar *line_converted = g_convert (
                 line, -1,
+                data->charset_to, data->charset_from,
                 NULL, NULL, NULL);
-            if (converted) {
-                g_free (line);
-                line = converted;
+            if (line_converted) {
+                g_free (copy);
+                line = copy = line_converted;
             }
         }
-    } else {
-        // The original M3U file format should be in WINDOWS-1252 encoding
-        // Convert the string to the one of the current system locale
-        gchar *converted = g_convert (
-            line, -1, charset, "WINDOWS-1252",
-            NULL, NULL, NULL);
-        if (converted) {
-            g_free (line);
-            line = converted;
-        }
+        // Remove the trailing whitespace including the carriage return
+        playlist_parse_m3u_line (data, g_strchomp (line));
+        g_free (copy);
     }
-    // Remove the trailing newline
-    line = g_strchomp (line);
+    g_free (converted);
+}
 
+// Parse a single line of a M3U playlist
+static void playlist_parse_m3u_line (PlayPlaylistData *data, gchar *line)
+{
     if (!data->item)
         data->item = play_queue_item_new ();
 
     // Use extended information to read the track title
     if (g_str_has_prefix (line, "#EXTINF:")) {
-        gchar **info;
-
-        info = g_strsplit (line + 8, ",", 2);
+        gchar *title = strchr (line + 8, ',');
 
-        // Title
-        if (g_strv_length (info) > 1) {
+        if (title) {
             play_queue_item_set_metadata (
                 data->item,
-                PLAY_METADATA_TITLE_FULL, g_strstrip (info[1]));
+                PLAY_METADATA_TITLE_FULL,
+                g_strstrip (title + 1));
         }
-        g_strfreev (info);
+    } else if (g_str_has_prefix (line, PLAY_CACHE_ARTIST_PREFIX)) {
+        // The separate artist and title are written to cached playlists
+        play_queue_item_set_metadata (
+            data->item,
+            PLAY_METADATA_ARTIST,
+            line + strlen (PLAY_CACHE_ARTIST_PREFIX));
+    } else if (g_str_has_prefix (line, PLAY_CACHE_TITLE_PREFIX)) {
+        play_queue_item_set_metadata (
+            data->item,
+            PLAY_METADATA_TITLE,
+            line + strlen (PLAY_CACHE_TITLE_PREFIX));
     }
-    if (line[0] && !g_str_has_prefix (line, "#")) {
+    if (line[0] && line[0] != '#') {
         // A non-information line and non-empty line must contain a file
         // path or a URI
         play_queue_item_set_file_or_uri (data->item, line);
+        playlist_add_item (data, data->item);
+
+        g_object_unref (data->item);
+        data->item = NULL;
+    }
+}
+
+// Parse a locally stored PLS playlist
+static void playlist_parse_pls_file (PlayPlaylistData *data, const gchar *file)
+{
+    GMappedFile *mapped;
+    GError      *error = NULL;
+
+    mapped = g_mapped_file_new (file, FALSE, &error);
+    if (!mapped) {
         g_signal_emit (
             data->playlist,
-            signals[QUEUE_ITEM],
+            signals[ERROR],
             0,
             data->id,
-            data->item,
+            error->message,
             data->custom);
 
-        g_object_unref (data->item);
-        data->item = NULL;
+        g_error_free (error);
+        // Delete data of the current item
+        g_hash_table_remove (
+            data->playlist->data,
+            GUINT_TO_POINTER (data->id));
+        return;
     }
-    // Read the next line from the playlist
-    g_data_input_stream_read_line_async (
-        G_DATA_INPUT_STREAM (source),
-        G_PRIORITY_DEFAULT,
-        NULL,
-        (GAsyncReadyCallback) playlist_parse_m3u_line,
-        data);
+    playlist_parse_pls_data (
+        data,
+        g_mapped_file_get_contents (mapped),
+        g_mapped_file_get_length (mapped));
 
-    g_free (line);
+    g_mapped_file_unref (mapped);
 }
 
-// Parse a locally stored PLS playlist
-static void playlist_parse_pls_file (PlayPlaylistData *data, const gchar *file)
+// Parse the content of a PLS playlist
+static void playlist_parse_pls_data (PlayPlaylistData *data,
+                                     const gchar *text,
+                                     gsize length)
 {
     GKeyFile *kf;
     GError *error = NULL;
@@ -825,7 +1112,7 @@ static void playlist_parse_pls_file (PlayPlaylistData *data, const gchar *file)
 
     // Use the glib's ini file parser
     kf = g_key_file_new ();
-    if (!g_key_file_load_from_file (kf, file, G_KEY_FILE_NONE, &error) ||
+    if (!g_key_file_load_from_data (kf, text, length, G_KEY_FILE_NONE, &error) ||
         !g_key_file_has_group (kf, "playlist")) {
         if (error) {
             g_signal_emit (
@@ -901,18 +1188,14 @@ static void playlist_parse_pls_file (PlayPlaylistData *data, const gchar *file)
                     value);
                 g_free (value);
             }
-            g_signal_emit (
-                data->playlist,
-                signals[QUEUE_ITEM],
-                0,
-                data->id,
-                data->item,
-                data->custom);
+            playlist_add_item (data, data->item);
 
             g_object_unref (data->item);
             data->item = NULL;
         }
     }
+    playlist_flush_items (data);
+    playlist_cache_store (data);
     g_signal_emit (
         data->playlist,
         signals[FINISHED],
@@ -926,135 +1209,338 @@ static void playlist_parse_pls_file (PlayPlaylistData *data, const gchar *file)
     g_hash_table_remove (data->playlist->data, GUINT_TO_POINTER (data->id));
 }
 
-// Process a locally stored XSPF playlist
-static void playlist_parse_xspf_file (PlayPlaylistData *data, const gchar *file)
+// Process a locally stored ASX or XSPF playlist
+static void playlist_parse_xml_file (PlayPlaylistData *data, const gchar *file)
 {
-    xmlDocPtr doc;
-    xmlNode  *root, *n1, *n2, *n3;
-    xmlChar  *value;
+    GMappedFile *mapped;
+
+    playlist_parse_xml_begin (data);
+
+    // A file which cannot be read is reported as a parsing error when
+    // the parser finds no root element
+    mapped = g_mapped_file_new (file, FALSE, NULL);
+    if (mapped) {
+        const gchar *contents = g_mapped_file_get_contents (mapped);
+        gsize        length   = g_mapped_file_get_length (mapped);
+        gsize        offset;
+
+        // Pass the file to the parser in chunks to keep its buffers small
+        for (offset = 0; offset < length; offset += PLAYLIST_CHUNK_SIZE)
+            if (!playlist_parse_xml_chunk (
+                    data,
+                    contents + offset,
+                    MIN (PLAYLIST_CHUNK_SIZE, length - offset),
+                    FALSE))
+                break;
 
-    doc = xmlReadFile (
-        file,
-        NULL,
-        XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
-    if (!doc) {
+        g_mapped_file_unref (mapped);
+    }
+    playlist_parse_xml_chunk (data, NULL, 0, TRUE);
+    playlist_parse_xml_end (data);
+}
+
+// Create a streaming XML parser for an ASX or XSPF playlist
+static void playlist_parse_xml_begin (PlayPlaylistData *data)
+{
+    xmlSAXHandler sax;
+
+    // Only the elements and their text are of interest, no document
+    // tree is built
+    memset (&sax, 0, sizeof (sax));
+    sax.initialized    = XML_SAX2_MAGIC;
+    sax.startElementNs = (startElementNsSAX2Func) playlist_xml_start_element;
+    sax.endElementNs   = (endElementNsSAX2Func) playlist_xml_end_element;
+    sax.characters     = (charactersSAXFunc) playlist_xml_characters;
+    sax.cdataBlock     = (cdataBlockSAXFunc) playlist_xml_characters;
+
+    data->parser = xmlCreatePushParserCtxt (&sax, data, NULL, 0, NULL);
+    if (G_LIKELY (data->parser))
+        xmlCtxtUseOptions (
+            data->parser,
+            XML_PARSE_RECOVER | XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+
+    data->text = g_string_new (NULL);
+}
+
+// Pass a chunk of an ASX or XSPF playlist to the streaming XML parser
+// Returns FALSE if the playlist has turned out not to be valid
+static gboolean playlist_parse_xml_chunk (PlayPlaylistData *data,
+                                          const gchar *chunk,
+                                          gsize length,
+                                          gboolean terminate)
+{
+    if (G_UNLIKELY (!data->parser))
+        return FALSE;
+
+    xmlParseChunk (data->parser, chunk, (int) length, terminate);
+
+    return !data->invalid;
+}
+
+// Finish parsing an ASX or XSPF playlist
+static void playlist_parse_xml_end (PlayPlaylistData *data)
+{
+    const gchar *error = NULL;
+
+    if (!data->has_root)
+        error = "Error parsing XML file format";
+    else if (data->invalid)
+        error = "Invalid file format";
+
+    playlist_flush_items (data);
+    if (error) {
         g_signal_emit (
             data->playlist,
             signals[ERROR],
             0,
             data->id,
-            "Error parsing XML file format",
+            error,
             data->custom);
+    } else {
+        playlist_cache_store (data);
 
-        // Delete data of the current item
-        g_hash_table_remove (
-            data->playlist->data,
-            GUINT_TO_POINTER (data->id));
-        return;
-    }
-    // Get the root element - must be called <playlist>
-    root = xmlDocGetRootElement (doc);
-    if (!root ||
-        !root->name ||
-        xmlStrcasecmp (root->name, (const xmlChar *) "playlist")) {
-        xmlFreeDoc (doc);
+        // Signal that parsing of the playlist has finished
         g_signal_emit (
             data->playlist,
-            signals[ERROR],
+            signals[FINISHED],
             0,
             data->id,
-            "Invalid file format",
             data->custom);
+    }
+    // Delete data of the current item
+    g_hash_table_remove (data->playlist->data, GUINT_TO_POINTER (data->id));
+}
 
-        // Delete data of the current item
-        g_hash_table_remove (
-            data->playlist->data,
-            GUINT_TO_POINTER (data->id));
+// XML parser callback for an opening tag
+// ASX items are <entry> elements inside the root <asx>, XSPF items are
+// <track> elements inside the <trackList> of the root <playlist>
+static void playlist_xml_start_element (PlayPlaylistData *data,
+                                        const xmlChar *name,
+                                        const xmlChar *prefix,
+                                        const xmlChar *uri,
+                                        int nb_namespaces,
+                                        const xmlChar **namespaces,
+                                        int nb_attributes,
+                                        int nb_defaulted,
+                                        const xmlChar **attributes)
+{
+    const gchar *element = (const gchar *) name;
+
+    data->depth++;
+    if (data->depth == 1) {
+        const gchar *root;
+
+        // Check the root element and stop parsing if it is not correct
+        if (data->type == PLAY_PLAYLIST_TYPE_ASX)
+            root = "asx";
+        else
+            root = "playlist";
+
+        data->has_root = TRUE;
+        if (g_ascii_strcasecmp (element, root)) {
+            data->invalid = TRUE;
+            xmlStopParser (data->parser);
+        }
         return;
     }
 
-    // Read all the child nodes inside the parent <playlist>
-    for (n1 = root->children; n1 != NULL; n1 = n1->next) {
-        // Only read nodes inside the <trackList>
-        if (g_ascii_strcasecmp ((const gchar *) n1->name, "trackList"))
-            continue;
-
-        for (n2 = n1->children; n2 != NULL; n2 = n2->next) {
-            PlayQueueItem *item;
+    if (data->type == PLAY_PLAYLIST_TYPE_ASX) {
+        if (data->depth == 2) {
+            // Only read <entry> nodes which contain playlist items
+            if (!g_ascii_strcasecmp (element, "entry"))
+                data->item = play_queue_item_new ();
+            return;
+        }
+        if (data->depth != 3 || !data->item)
+            return;
 
-            // Only read <track> nodes which contain playlist items
-            if (g_ascii_strcasecmp ((const gchar *) n2->name, "track") ||
-                !n2->children)
-                continue;
+        // <ref> specifies a URI
+        if (!g_ascii_strcasecmp (element, "ref")) {
+            gint i;
 
-            item = play_queue_item_new ();
+            // The URI is inside the href attribute, each attribute is
+            // described by its name, prefix, URI, value and value end
+            for (i = 0; i < nb_attributes; i++) {
+                const xmlChar **attribute = attributes + i * 5;
+                gchar          *location;
 
-            for (n3 = n2->children; n3 != NULL; n3 = n3->next) {
-                value = xmlNodeGetContent (n3);
-                if (G_UNLIKELY (!value))
+                if (g_ascii_strcasecmp ((const gchar *) attribute[0], "href"))
                     continue;
 
-                // Location
-                if (!g_ascii_strcasecmp ((const gchar *) n3->name, "location")) {
-                    gchar *unescaped = xmlURIUnescapeString(
-                        (const char *) value, 0,
-                        NULL);
-                    if (G_LIKELY (unescaped)) {
-                        play_queue_item_set_file_or_uri (
-                            item,
-                            (const gchar *) unescaped);
-                        xmlFree (unescaped);
-                    }
-                }
-                // Artist
-                if (!g_ascii_strcasecmp ((const gchar *) n3->name, "creator")) {
-                    play_queue_item_set_metadata (
-                        item,
-                        PLAY_METADATA_ARTIST,
-                        (const gchar *) value);
-                }
-                // Track title
-                if (!g_ascii_strcasecmp ((const gchar *) n3->name, "title")) {
-                    play_queue_item_set_metadata (
-                        item,
-                        PLAY_METADATA_TITLE,
-                        (const gchar *) value);
+                location = g_strndup (
+                    (const gchar *) attribute[3],
+                    attribute[4] - attribute[3]);
+
+                play_queue_item_set_file_or_uri (data->item, location);
+                g_free (location);
+                break;
+            }
+        }
+        // Optional track artist
+        else if (!g_ascii_strcasecmp (element, "author"))
+            data->field = PLAYLIST_FIELD_ARTIST;
+        // Optional track title
+        else if (!g_ascii_strcasecmp (element, "title"))
+            data->field = PLAYLIST_FIELD_TITLE;
+    } else {
+        if (data->depth == 2) {
+            // Only read nodes inside the <trackList>
+            data->in_list = !g_ascii_strcasecmp (element, "trackList");
+            return;
+        }
+        if (!data->in_list)
+            return;
+        if (data->depth == 3) {
+            // Only read <track> nodes which contain playlist items
+            if (!g_ascii_strcasecmp (element, "track"))
+                data->item = play_queue_item_new ();
+            return;
+        }
+        if (data->depth != 4 || !data->item)
+            return;
+
+        if (!g_ascii_strcasecmp (element, "location"))
+            data->field = PLAYLIST_FIELD_LOCATION;
+        else if (!g_ascii_strcasecmp (element, "creator"))
+            data->field = PLAYLIST_FIELD_ARTIST;
+        else if (!g_ascii_strcasecmp (element, "title"))
+            data->field = PLAYLIST_FIELD_TITLE;
+    }
+    // Collect the text content of the element
+    if (data->field != PLAYLIST_FIELD_NONE)
+        g_string_truncate (data->text, 0);
+}
+
+// XML parser callback for a closing tag
+static void playlist_xml_end_element (PlayPlaylistData *data,
+                                      const xmlChar *name,
+                                      const xmlChar *prefix,
+                                      const xmlChar *uri)
+{
+    guint depth;
+
+    // Depth of the element which contains a playlist item
+    if (data->type == PLAY_PLAYLIST_TYPE_ASX)
+        depth = 2;
+    else
+        depth = 3;
+
+    if (data->item && data->depth == depth + 1 &&
+        data->field != PLAYLIST_FIELD_NONE) {
+        gchar *value = g_strstrip (data->text->str);
+
+        switch (data->field) {
+            case PLAYLIST_FIELD_LOCATION: {
+                gchar *unescaped = xmlURIUnescapeString (value, 0, NULL);
+
+                if (G_LIKELY (unescaped)) {
+                    play_queue_item_set_file_or_uri (
+                        data->item,
+                        (const gchar *) unescaped);
+                    xmlFree (unescaped);
                 }
-                xmlFree (value);
+                break;
             }
-            // Check if a URI was found in the current <track> and if so,
-            // add the item to the queue
-            if (play_queue_item_is_valid (item))
-                g_signal_emit (
-                    data->playlist,
-                    signals[QUEUE_ITEM],
-                    0,
-                    data->id,
-                    item,
-                    data->custom);
-            g_object_unref (item);
+            case PLAYLIST_FIELD_ARTIST:
+                play_queue_item_set_metadata (
+                    data->item,
+                    PLAY_METADATA_ARTIST,
+                    value);
+                break;
+            case PLAYLIST_FIELD_TITLE:
+                play_queue_item_set_metadata (
+                    data->item,
+                    PLAY_METADATA_TITLE,
+                    value);
+                break;
         }
+        data->field = PLAYLIST_FIELD_NONE;
+    } else if (data->item && data->depth == depth) {
+        // Check if a URI was found in the item and if so, add the item
+        // to the queue right away
+        if (play_queue_item_is_valid (data->item))
+            playlist_add_item (data, data->item);
+
+        g_object_unref (data->item);
+        data->item = NULL;
     }
-    xmlFreeDoc (doc);
-    xmlCleanupParser ();
+    if (data->depth == 2)
+        data->in_list = FALSE;
+
+    data->depth--;
+}
+
+// XML parser callback for text content
+static void playlist_xml_characters (PlayPlaylistData *data,
+                                     const xmlChar *text,
+                                     int length)
+{
+    if (data->field != PLAYLIST_FIELD_NONE)
+        g_string_append_len (data->text, (const gchar *) text, length);
+}
+
+// Add an item found in the playlist to the current batch
+// The batch is emitted when it reaches the maximum size
+static void playlist_add_item (PlayPlaylistData *data, PlayQueueItem *item)
+{
+    if (!data->items)
+        data->items = g_ptr_array_new_full (
+            PLAYLIST_BATCH_SIZE,
+            g_object_unref);
+
+    g_ptr_array_add (data->items, g_object_ref (item));
+    if (data->cache_items)
+        g_ptr_array_add (data->cache_items, g_object_ref (item));
+
+    if (data->items->len >= PLAYLIST_BATCH_SIZE)
+        playlist_flush_items (data);
+}
+
+// Emit the current batch of items found in the playlist
+static void playlist_flush_items (PlayPlaylistData *data)
+{
+    if (!data->items || !data->items->len)
+        return;
+
+    PLAY_STATS_COUNT ("playlists.items", data->items->len);
 
-    // Signal that parsing of the playlist has finished
     g_signal_emit (
         data->playlist,
-        signals[FINISHED],
+        signals[QUEUE_ITEMS],
         0,
         data->id,
+        data->items,
         data->custom);
 
-    // Delete data of the current item
-    g_hash_table_remove (data->playlist->data, GUINT_TO_POINTER (data->id));
+    // Release the items and keep the array for the next batch
+    g_ptr_array_set_size (data->items, 0);
 }
 
 // Free memory allocated for a temporary data structure
 static void playlist_free_data (PlayPlaylistData *data)
 {
+    // Time taken to download, read and parse the playlist
+    PLAY_STATS_COUNT ("playlists.count", 1);
+    PLAY_STATS_RECORD (
+        "playlists.load_ms",
+        (g_get_monotonic_time () - data->time_started) / 1000);
+
     if (data->item)
         g_object_unref (data->item);
+    if (data->items)
+        g_ptr_array_unref (data->items);
+    if (data->cache_items)
+        g_ptr_array_unref (data->cache_items);
+    if (data->cache_info)
+        g_object_unref (data->cache_info);
+
+    g_free (data->cache_path);
+    if (data->buffer)
+        g_byte_array_unref (data->buffer);
+    if (data->parser)
+        xmlFreeParserCtxt (data->parser);
+    if (data->text)
+        g_string_free (data->text, TRUE);
 
     g_object_unref (data->file);
     g_slice_free (PlayPlaylistData, data);
@@ -7,6 +7,7 @@
 #define _PLAY_PLAYLIST_H_
 
 #include "play-common.h"
+#include "play-cache.h"
 #include "play-downloader.h"
 #include "play-queue-item.h"
 
@@ -35,12 +36,17 @@ typedef enum {
 #define PLAY_PLAYLIST_GET_CLASS(o)             \
     (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_PLAYLIST, PlayPlaylistClass))
 
-typedef struct {
+typedef struct _PlayPlaylist PlayPlaylist;
+
+struct _PlayPlaylist {
     GObject         parent_instance;
     guint           id_next;
     PlayDownloader *downloader;
+    PlayCache      *cache;
+    gboolean        cache_read;
+    PlayPlaylist   *refresh;
     GHashTable     *data;
-} PlayPlaylist;
+};
 
 typedef struct {
     GObjectClass    parent_class;
@@ -66,11 +72,13 @@ typedef struct {
                       guint id,
                       gpointer custom);
 
-    // A file or URI entry has been found in the playlist
-    void (*queue_item) (PlayPlaylist *playlist,
-                        guint id,
-                        PlayQueueItem *item,
-                        gpointer custom);
+    // A batch of file or URI entries has been found in the playlist
+    // The GPtrArray of PlayQueueItems is only valid during the signal
+    // emission, use g_object_ref() to keep the items
+    void (*queue_items) (PlayPlaylist *playlist,
+                         guint id,
+                         GPtrArray *items,
+                         gpointer custom);
 } PlayPlaylistClass;
 
 extern GType play_playlist_get_type (void);
@@ -98,6 +106,26 @@ extern guint play_playlist_parse_gfile (PlayPlaylist *playlist,
                                         GFile *file,
                                         gpointer custom);
 
+// Set the priority of downloading a remote playlist specified by
+// the playlist ID, playlists with lower values are downloaded first
+// Returns TRUE on success
+extern gboolean play_playlist_set_priority (PlayPlaylist *playlist,
+                                            guint id,
+                                            gint priority);
+
+// Set the maximum number of remote playlists downloaded at the same time
+// in total and from a single host, use 0 for no limit
+extern void play_playlist_set_max_downloads (PlayPlaylist *playlist,
+                                             guint max_downloads,
+                                             guint max_downloads_host);
+
+// Set the number of seconds to wait for a connection to be established
+// and for more data to arrive before a download fails, use 0 to wait
+// indefinitely
+extern void play_playlist_set_download_timeouts (PlayPlaylist *playlist,
+                                                 guint timeout_connect,
+                                                 guint timeout_read);
+
 // Return TRUE if the given file or URI is a supported playlist
 extern gboolean play_playlist_file_is_playlist (const gchar *file);
 
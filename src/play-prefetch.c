@@ -0,0 +1,344 @@
+/**
+ * PLAY
+ * play-prefetch.c: Read metadata of queue items ahead of time
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-prefetch.h"
+#include "play-queue-item.h"
+
+#include <gst/pbutils/pbutils.h>
+
+G_DEFINE_TYPE (PlayPrefetch, play_prefetch, G_TYPE_OBJECT);
+
+// An item to be read by a pool thread, the result is passed back to
+// the main loop in the same structure
+typedef struct {
+    PlayQueueItem  *item;
+    gchar          *uri;
+    gint            generation;
+    gboolean        found;
+    gchar          *artist;
+    gchar          *title;
+    gint64          duration;
+} PlayPrefetchJob;
+
+// Discoverer of each of the pool threads
+static GPrivate prefetch_discoverer = G_PRIVATE_INIT (g_object_unref);
+
+// Pool thread function, read the metadata of a single item
+static void prefetch_thread (PlayPrefetchJob *job, PlayPrefetch *prefetch);
+
+// Pass the result of a job to the main loop
+static void prefetch_deliver (PlayPrefetch *prefetch, PlayPrefetchJob *job);
+
+// Apply the results of the finished jobs in the main loop
+static gboolean prefetch_finished (PlayPrefetch *prefetch);
+
+// Apply the result of a single job
+static void prefetch_apply (PlayPrefetch *prefetch, PlayPrefetchJob *job);
+
+// Return TRUE if the item is missing any of the information read by
+// the prefetch
+static gboolean prefetch_item_is_incomplete (PlayQueueItem *item);
+
+// Free memory allocated for a job
+static void prefetch_free_job (PlayPrefetchJob *job);
+
+// Signals
+enum {
+    ITEM_UPDATED,
+    LAST_SIGNAL
+};
+static guint signals[LAST_SIGNAL];
+
+// GObject/dispose
+static void play_prefetch_dispose (GObject *object)
+{
+    PlayPrefetch *prefetch = PLAY_PREFETCH (object);
+
+    // Let the waiting items be skipped and wait for all of them to finish
+    if (prefetch->pool) {
+        play_prefetch_cancel (prefetch);
+        g_thread_pool_free (prefetch->pool, FALSE, TRUE);
+        prefetch->pool = NULL;
+    }
+
+    // The results which have not been applied yet are dropped, the main
+    // loop may not be running anymore
+    if (prefetch->results_source) {
+        g_source_destroy (prefetch->results_source);
+        g_source_unref (prefetch->results_source);
+        prefetch->results_source = NULL;
+    }
+    g_queue_foreach (&prefetch->results, (GFunc) prefetch_free_job, NULL);
+    g_queue_clear (&prefetch->results);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_prefetch_parent_class)->dispose (object);
+}
+
+// GObject/finalize
+static void play_prefetch_finalize (GObject *object)
+{
+    PlayPrefetch *prefetch = PLAY_PREFETCH (object);
+
+    // Clean up
+    g_hash_table_destroy (prefetch->pending);
+    g_main_context_unref (prefetch->context);
+    g_mutex_clear (&prefetch->lock);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_prefetch_parent_class)->finalize (object);
+}
+
+// GObject/class init
+static void play_prefetch_class_init (PlayPrefetchClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->dispose  = play_prefetch_dispose;
+    gobject_class->finalize = play_prefetch_finalize;
+
+    signals[ITEM_UPDATED] =
+        g_signal_new ("item-updated",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayPrefetchClass, item_updated),
+                      NULL,
+                      NULL,
+                      g_cclosure_marshal_VOID__OBJECT,
+                      G_TYPE_NONE,
+                      1,
+                      PLAY_TYPE_QUEUE_ITEM);
+}
+
+// GObject/init
+static void play_prefetch_init (PlayPrefetch *prefetch)
+{
+    prefetch->pool = g_thread_pool_new (
+        (GFunc) prefetch_thread,
+        prefetch,
+        PLAY_PREFETCH_THREADS,
+        FALSE,
+        NULL);
+
+    // Items being read, each item is only read once at a time
+    prefetch->pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    // The results are applied in the context of the thread which created
+    // the object
+    prefetch->context = g_main_context_ref_thread_default ();
+    g_mutex_init (&prefetch->lock);
+    g_queue_init (&prefetch->results);
+}
+
+// Create a new prefetch object
+PlayPrefetch *play_prefetch_new (void)
+{
+    return PLAY_PREFETCH (g_object_new (PLAY_TYPE_PREFETCH, NULL));
+}
+
+// Read the duration and metadata of the given queue items in the background
+// Items which have not been read yet from an earlier call are dropped,
+// the items are expected to be the ones which are going to be played next
+// Local files are read only, reading a stream would open a connection
+void play_prefetch_items (PlayPrefetch *prefetch,
+                          PlayQueueItem **items,
+                          guint count)
+{
+    gint  generation;
+    guint i;
+
+    g_return_if_fail (PLAY_IS_PREFETCH (prefetch));
+
+    // The queue position has moved, the waiting items are not needed
+    // anymore unless they are requested again
+    play_prefetch_cancel (prefetch);
+    generation = g_atomic_int_get (&prefetch->generation);
+
+    for (i = 0; i < count; i++) {
+        PlayPrefetchJob *job;
+
+        if (!items[i] || g_hash_table_contains (prefetch->pending, items[i]))
+            continue;
+        if (!prefetch_item_is_incomplete (items[i]))
+            continue;
+        if (!play_queue_item_is_native (items[i]))
+            continue;
+
+        job = g_slice_new0 (PlayPrefetchJob);
+        job->item = g_object_ref (items[i]);
+        job->uri  = play_queue_item_dup_uri (items[i]);
+        job->generation = generation;
+        job->duration = -1;
+
+        g_hash_table_add (prefetch->pending, items[i]);
+        g_thread_pool_push (prefetch->pool, job, NULL);
+    }
+}
+
+// Drop all the items waiting to be read
+void play_prefetch_cancel (PlayPrefetch *prefetch)
+{
+    g_return_if_fail (PLAY_IS_PREFETCH (prefetch));
+
+    // The pool threads skip the jobs of the previous generations
+    g_atomic_int_inc (&prefetch->generation);
+}
+
+// Pool thread function, read the metadata of a single item
+static void prefetch_thread (PlayPrefetchJob *job, PlayPrefetch *prefetch)
+{
+    GstDiscoverer     *discoverer;
+    GstDiscovererInfo *info;
+
+    // The object is kept alive until the pool is freed in dispose
+    if (job->generation != g_atomic_int_get (&prefetch->generation))
+        goto done;
+
+    discoverer = g_private_get (&prefetch_discoverer);
+    if (!discoverer) {
+        discoverer = gst_discoverer_new (
+            PLAY_PREFETCH_TIMEOUT * GST_SECOND,
+            NULL);
+        if (!discoverer)
+            goto done;
+
+        g_private_set (&prefetch_discoverer, discoverer);
+    }
+    info = gst_discoverer_discover_uri (discoverer, job->uri, NULL);
+    if (!info)
+        goto done;
+
+    if (gst_discoverer_info_get_result (info) == GST_DISCOVERER_OK) {
+        const GstTagList *tags;
+        GstClockTime      duration;
+
+        duration = gst_discoverer_info_get_duration (info);
+        if (GST_CLOCK_TIME_IS_VALID (duration))
+            job->duration = (gint64) duration;
+
+        tags = gst_discoverer_info_get_tags (info);
+        if (tags) {
+            gst_tag_list_get_string (tags, GST_TAG_ARTIST, &job->artist);
+            gst_tag_list_get_string (tags, GST_TAG_TITLE, &job->title);
+        }
+        job->found = TRUE;
+    }
+    gst_discoverer_info_unref (info);
+
+done:
+    // The result is delivered even for a skipped item so that it can be
+    // requested again
+    prefetch_deliver (prefetch, job);
+}
+
+// Pass the result of a job to the main loop
+static void prefetch_deliver (PlayPrefetch *prefetch, PlayPrefetchJob *job)
+{
+    g_mutex_lock (&prefetch->lock);
+    g_queue_push_tail (&prefetch->results, job);
+
+    // A single idle source applies all the results waiting at the time
+    // it is dispatched, invoking a function in the context directly would
+    // run it in the pool thread when the main loop is not running
+    if (!prefetch->results_source) {
+        prefetch->results_source = g_idle_source_new ();
+        g_source_set_priority (prefetch->results_source, G_PRIORITY_DEFAULT);
+        g_source_set_callback (
+            prefetch->results_source,
+            (GSourceFunc) prefetch_finished,
+            prefetch,
+            NULL);
+        g_source_attach (prefetch->results_source, prefetch->context);
+    }
+    g_mutex_unlock (&prefetch->lock);
+}
+
+// Apply the results of the finished jobs in the main loop
+static gboolean prefetch_finished (PlayPrefetch *prefetch)
+{
+    GQueue           results;
+    PlayPrefetchJob *job;
+
+    g_mutex_lock (&prefetch->lock);
+    results = prefetch->results;
+    g_queue_init (&prefetch->results);
+
+    // The source is destroyed once this function returns, the next result
+    // attaches a new one
+    g_source_unref (prefetch->results_source);
+    prefetch->results_source = NULL;
+    g_mutex_unlock (&prefetch->lock);
+
+    while ((job = g_queue_pop_head (&results)) != NULL)
+        prefetch_apply (prefetch, job);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Apply the result of a single job
+static void prefetch_apply (PlayPrefetch *prefetch, PlayPrefetchJob *job)
+{
+    PlayQueueItem *item = job->item;
+
+    g_hash_table_remove (prefetch->pending, item);
+
+    // The information read from the playing stream takes precedence
+    if (job->found) {
+        gboolean updated = FALSE;
+
+        if (job->duration >= 0 && play_queue_item_get_duration (item) < 0) {
+            play_queue_item_set_duration (item, job->duration);
+            updated = TRUE;
+        }
+        if (!play_queue_item_get_metadata (item, PLAY_METADATA_TITLE_FULL)) {
+            if (job->artist) {
+                play_queue_item_set_metadata (
+                    item,
+                    PLAY_METADATA_ARTIST,
+                    job->artist);
+                updated = TRUE;
+            }
+            if (job->title) {
+                play_queue_item_set_metadata (
+                    item,
+                    PLAY_METADATA_TITLE,
+                    job->title);
+                updated = TRUE;
+            }
+        }
+        if (updated)
+            g_signal_emit (
+                prefetch,
+                signals[ITEM_UPDATED],
+                0,
+                item);
+    }
+    prefetch_free_job (job);
+}
+
+// Return TRUE if the item is missing any of the information read by
+// the prefetch
+static gboolean prefetch_item_is_incomplete (PlayQueueItem *item)
+{
+    if (play_queue_item_get_duration (item) < 0)
+        return TRUE;
+    if (!play_queue_item_get_metadata (item, PLAY_METADATA_TITLE_FULL))
+        return TRUE;
+
+    return FALSE;
+}
+
+// Free memory allocated for a job
+static void prefetch_free_job (PlayPrefetchJob *job)
+{
+    g_object_unref (job->item);
+    g_free (job->uri);
+    g_free (job->artist);
+    g_free (job->title);
+
+    g_slice_free (PlayPrefetchJob, job);
+}
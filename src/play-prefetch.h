@@ -0,0 +1,75 @@
+/**
+ * PLAY
+ * play-prefetch.h: Read metadata of queue items ahead of time
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#ifndef _PLAY_PREFETCH_H_
+#define _PLAY_PREFETCH_H_
+
+#include "play-common.h"
+#include "play-queue-item.h"
+
+G_BEGIN_DECLS
+
+// Default number of upcoming queue items to read the metadata of
+#define PLAY_PREFETCH_COUNT     3
+
+// Maximum number of threads reading the metadata at the same time
+#define PLAY_PREFETCH_THREADS   2
+
+// Number of seconds to wait for the metadata of a single item
+#define PLAY_PREFETCH_TIMEOUT   5
+
+#define PLAY_TYPE_PREFETCH                     \
+    (play_prefetch_get_type())
+#define PLAY_PREFETCH(o)                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((o), PLAY_TYPE_PREFETCH, PlayPrefetch))
+#define PLAY_PREFETCH_CLASS(k)                 \
+    (G_TYPE_CHECK_CLASS_CAST((k), PLAY_TYPE_PREFETCH, PlayPrefetchClass))
+#define PLAY_IS_PREFETCH(o)                    \
+    (G_TYPE_CHECK_INSTANCE_TYPE((o), PLAY_TYPE_PREFETCH))
+#define PLAY_IS_PREFETCH_CLASS(k)              \
+    (G_TYPE_CHECK_CLASS_TYPE((k), PLAY_TYPE_PREFETCH))
+#define PLAY_PREFETCH_GET_CLASS(o)             \
+    (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_PREFETCH, PlayPrefetchClass))
+
+typedef struct {
+    GObject         parent_instance;
+    GThreadPool    *pool;
+    GHashTable     *pending;
+    volatile gint   generation;
+    GMainContext   *context;
+    GMutex          lock;
+    GQueue          results;
+    GSource        *results_source;
+} PlayPrefetch;
+
+typedef struct {
+    GObjectClass    parent_class;
+
+    // Signals
+    // The duration or metadata of a queue item have been read
+    void (*item_updated) (PlayPrefetch *prefetch,
+                          PlayQueueItem *item,
+                          gpointer user_data);
+} PlayPrefetchClass;
+
+extern GType play_prefetch_get_type (void);
+
+// Create a new prefetch object
+extern PlayPrefetch *play_prefetch_new (void);
+
+// Read the duration and metadata of the given queue items in the background
+// Items which have not been read yet from an earlier call are dropped,
+// the items are expected to be the ones which are going to be played next
+// Local files are read only, reading a stream would open a connection
+extern void play_prefetch_items (PlayPrefetch *prefetch,
+                                 PlayQueueItem **items,
+                                 guint count);
+
+// Drop all the items waiting to be read
+extern void play_prefetch_cancel (PlayPrefetch *prefetch);
+
+G_END_DECLS
+
+#endif // _PLAY_PREFETCH_H_
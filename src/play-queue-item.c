@@ -8,6 +8,54 @@
 
 G_DEFINE_TYPE (PlayQueueItem, play_queue_item, G_TYPE_OBJECT);
 
+// Return the metadata slot of the given metadata type
+#define QUEUE_ITEM_META(item, type) \
+    ((item)->meta[(type) - PLAY_METADATA_ARTIST])
+
+// Return TRUE if the metadata type has a slot in the queue item
+#define QUEUE_ITEM_META_VALID(type) \
+    ((type) >= PLAY_METADATA_ARTIST && (type) <= PLAY_METADATA_TITLE_FULL)
+
+// Directory part of a location shared by the queue items
+typedef struct {
+    guint         refs;
+    gchar         str[1];
+} PlayQueueItemPrefix;
+
+// Shared directory parts indexed by their strings, items are created
+// by the directory scanner thread as well
+static GHashTable *queue_item_prefixes;
+static GMutex      queue_item_prefixes_lock;
+
+// Return the shared copy of the first length bytes of the location and
+// take a reference to it
+static const gchar *queue_item_prefix_ref (const gchar *location,
+                                           gsize length);
+
+// Release a reference to a shared directory part, it is freed once no
+// item uses it
+static void queue_item_prefix_unref (const gchar *prefix);
+
+// Unset the location of the queue item
+static void queue_item_clear_uri (PlayQueueItem *item);
+
+// Split the location into the shared directory part and the rest
+static void queue_item_split (PlayQueueItem *item,
+                              const gchar *location,
+                              gboolean resolved);
+
+// Turn a file path or URI set by play_queue_item_set_file_or_uri () into
+// a URI
+static void queue_item_resolve (PlayQueueItem *item);
+
+// Return the cache of values derived from the URI, create it if needed
+static PlayQueueItemCache *queue_item_get_cache (PlayQueueItem *item);
+
+// Replace a metadata value, the value is owned by the queue item
+static void queue_item_set_meta (PlayQueueItem *item,
+                                 PlayMetadata type,
+                                 gchar *value);
+
 GType play_metadata_get_type (void)
 {
     static GType etype = 0;
@@ -31,14 +79,8 @@ static void play_queue_item_finalize (GObject *object)
     PlayQueueItem *item = PLAY_QUEUE_ITEM (object);
     
     // Clean up
-    if (item->file)
-        g_object_unref (item->file);
-    if (item->uri)
-        g_free (item->uri);
-    if (item->name)
-        g_free (item->name);
-
-    g_hash_table_destroy (item->meta);
+    queue_item_clear_uri (item);
+    play_queue_item_clear_metadata (item);
 
     // Chain up to the parent class
     G_OBJECT_CLASS (play_queue_item_parent_class)->finalize (object);
@@ -55,11 +97,7 @@ static void play_queue_item_class_init (PlayQueueItemClass *klass)
 // GObject/init
 static void play_queue_item_init (PlayQueueItem *item)
 {
-    item->meta = g_hash_table_new_full (
-        g_direct_hash,
-        g_direct_equal,
-        NULL,
-        g_free);
+    item->duration = -1;
 }
 
 // Create a new empty queue item object
@@ -69,44 +107,45 @@ PlayQueueItem *play_queue_item_new (void)
 }
 
 // Set the queue item to the given file path or URI
+// The location is only resolved when the URI, GFile or name of the item
+// is requested
 gboolean play_queue_item_set_file_or_uri (PlayQueueItem *item, const gchar *file_or_uri)
 {
-    GFile *file;
-    gboolean ret;
-
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), FALSE);
     g_return_val_if_fail (file_or_uri, FALSE);
 
-    file = g_file_new_for_commandline_arg (file_or_uri);
-    ret  = play_queue_item_set_gfile (item, file);
-
-    g_object_unref (file);
-    return ret;
+    // Playlists may contain a huge number of entries and only few of them
+    // are usually played, so avoid creating a GFile for each of them
+    queue_item_clear_uri (item);
+    queue_item_split (item, file_or_uri, FALSE);
+    return TRUE;
 }
 
 // Set the queue item to the given GFile
 gboolean play_queue_item_set_gfile (PlayQueueItem *item, GFile *file)
 {
+    gchar   *uri;
+    gboolean ret;
+
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), FALSE);
     g_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-    if (item->file)
-        g_object_unref (item->file);
-    if (item->uri)
-        g_free (item->uri);
-    if (item->name)
-        g_free (item->name);
-
-    item->file = g_object_ref (file);
-    item->uri  = g_file_get_uri (item->file);
-    item->name = g_file_get_basename (item->file);
-    if (!strcmp (item->name, "/")) {
-        // If the GFile does not contain a file name component, the
-        // function returns the string "/"
-        // Treat it is as a special case here and use the URI instead
-        g_free (item->name);
-        item->name = g_strdup (item->uri);
-    }
+    // The GFile itself is not kept, it is only created again when needed
+    uri = g_file_get_uri (file);
+    ret = play_queue_item_set_uri (item, uri);
+
+    g_free (uri);
+    return ret;
+}
+
+// Set the queue item to the given URI
+gboolean play_queue_item_set_uri (PlayQueueItem *item, const gchar *uri)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), FALSE);
+    g_return_val_if_fail (uri != NULL, FALSE);
+
+    queue_item_clear_uri (item);
+    queue_item_split (item, uri, TRUE);
     return TRUE;
 }
 
@@ -116,25 +155,86 @@ gboolean play_queue_item_is_valid (PlayQueueItem *item)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), FALSE);
 
-    return item->file ? TRUE : FALSE;
+    return item->suffix ? TRUE : FALSE;
+}
+
+// Return TRUE if the queue item is a local file
+gboolean play_queue_item_is_native (PlayQueueItem *item)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), FALSE);
+
+    if (!item->suffix)
+        return FALSE;
+
+    queue_item_resolve (item);
+    return g_str_has_prefix (item->prefix, "file:");
 }
 
 // Return URI of the queue item
-// The returned value is owned by the PlayQueueItem
+// The returned value is owned by the PlayQueueItem and kept for its
+// lifetime, use play_queue_item_dup_uri() when going through many items
 const gchar *play_queue_item_get_uri (PlayQueueItem *item)
+{
+    PlayQueueItemCache *cache;
+
+    g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), NULL);
+
+    if (!item->suffix)
+        return NULL;
+
+    cache = queue_item_get_cache (item);
+    if (!cache->uri)
+        cache->uri = play_queue_item_dup_uri (item);
+
+    return cache->uri;
+}
+
+// Return a newly allocated URI of the queue item
+// Free the returned value with g_free()
+gchar *play_queue_item_dup_uri (PlayQueueItem *item)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), NULL);
+
+    if (!item->suffix)
+        return NULL;
+    if (item->cache && item->cache->uri)
+        return g_strdup (item->cache->uri);
+
+    queue_item_resolve (item);
+
+    return g_strconcat (item->prefix, item->suffix, NULL);
+}
+
+// Return a newly allocated file path or URI of the queue item as it was
+// set, without resolving it
+// Free the returned value with g_free()
+gchar *play_queue_item_dup_location (PlayQueueItem *item)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), NULL);
 
-    return item->uri;
+    if (!item->suffix)
+        return NULL;
+
+    return g_strconcat (item->prefix, item->suffix, NULL);
 }
 
 // Retrieve GFile of the queue item
-// Use g_object_ref() to keep the reference
+// The GFile is created on the first call and kept for the lifetime of
+// the PlayQueueItem, use g_object_ref() to keep the reference
 GFile *play_queue_item_get_gfile (PlayQueueItem *item)
 {
+    PlayQueueItemCache *cache;
+
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), NULL);
 
-    return item->file;
+    if (!item->suffix)
+        return NULL;
+
+    cache = queue_item_get_cache (item);
+    if (!cache->file)
+        cache->file = g_file_new_for_uri (play_queue_item_get_uri (item));
+
+    return cache->file;
 }
 
 // Return a name to be displayed in the user interface
@@ -142,12 +242,29 @@ GFile *play_queue_item_get_gfile (PlayQueueItem *item)
 // The returned value is owned by the PlayQueueItem
 const gchar *play_queue_item_get_name (PlayQueueItem *item)
 {
+    PlayQueueItemCache *cache;
+
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), NULL);
 
-    if (item->name)
-        return item->name;
+    if (!item->suffix)
+        return NULL;
+
+    queue_item_resolve (item);
+
+    cache = queue_item_get_cache (item);
+    if (!cache->name) {
+        gchar *name = g_strndup (item->suffix, strcspn (item->suffix, "?#"));
+
+        // The file name is the unescaped last part of the path, if there
+        // is none, the URI is used instead
+        if (*name)
+            cache->name = g_uri_unescape_string (name, NULL);
+        if (!cache->name)
+            cache->name = g_strdup (play_queue_item_get_uri (item));
 
-    return item->uri;
+        g_free (name);
+    }
+    return cache->name;
 }
 
 // Retrieve a metadata value for the given metadata type
@@ -157,7 +274,10 @@ const gchar *play_queue_item_get_metadata (PlayQueueItem *item, PlayMetadata typ
 {
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), NULL);
 
-    return g_hash_table_lookup (item->meta, GUINT_TO_POINTER (type));
+    if (!QUEUE_ITEM_META_VALID (type))
+        return NULL;
+
+    return QUEUE_ITEM_META (item, type);
 }
 
 // Set a metadata value for the given metadata type
@@ -167,19 +287,9 @@ gboolean play_queue_item_set_metadata (PlayQueueItem *item,
                                        const gchar *value)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), FALSE);
+    g_return_val_if_fail (QUEUE_ITEM_META_VALID (type), FALSE);
 
-    // The hash table automatically frees the values, so rather than
-    // overwriting a previous value with NULL, unset it by removing it
-    // from the table
-    if (value)
-        g_hash_table_insert (
-            item->meta,
-            GUINT_TO_POINTER (type),
-            (gpointer) g_strdup (value));
-    else
-        g_hash_table_remove (
-            item->meta,
-            GUINT_TO_POINTER (type));
+    queue_item_set_meta (item, type, g_strdup (value));
 
     if (type == PLAY_METADATA_ARTIST) {
         // Remember the time of the last artist update
@@ -192,9 +302,7 @@ gboolean play_queue_item_set_metadata (PlayQueueItem *item,
         // Some online radios send out information about the current song and
         // when interrupted by an advertisment only the title information
         // is sent
-        g_hash_table_remove (
-            item->meta,
-            GUINT_TO_POINTER (PLAY_METADATA_ARTIST));
+        queue_item_set_meta (item, PLAY_METADATA_ARTIST, NULL);
     }
     // Create a custom field that contains the full title which consists of
     // both the artist and track name
@@ -204,14 +312,8 @@ gboolean play_queue_item_set_metadata (PlayQueueItem *item,
         gchar *title_full = NULL;
 
         // The current artist and title
-        if (type == PLAY_METADATA_ARTIST)
-            artist = value;
-        else
-            artist = play_queue_item_get_metadata (item, PLAY_METADATA_ARTIST);
-        if (type == PLAY_METADATA_TITLE)
-            title  = value;
-        else
-            title  = play_queue_item_get_metadata (item, PLAY_METADATA_TITLE);
+        artist = play_queue_item_get_metadata (item, PLAY_METADATA_ARTIST);
+        title  = play_queue_item_get_metadata (item, PLAY_METADATA_TITLE);
 
         // Create the full track title
         if (artist && title) {
@@ -221,23 +323,174 @@ gboolean play_queue_item_set_metadata (PlayQueueItem *item,
         } else if (title) {
             title_full = g_strdup (title);
         }
-        if (title_full)
-            g_hash_table_insert (
-                item->meta,
-                GUINT_TO_POINTER (PLAY_METADATA_TITLE_FULL),
-                (gpointer) title_full);
-        else
-            g_hash_table_remove (
-                item->meta,
-                GUINT_TO_POINTER (PLAY_METADATA_TITLE_FULL));
+        queue_item_set_meta (item, PLAY_METADATA_TITLE_FULL, title_full);
     }
     return TRUE;
 }
 
 // Unset all the saved metadata
 void play_queue_item_clear_metadata (PlayQueueItem *item)
+{
+    guint i;
+
+    g_return_if_fail (PLAY_IS_QUEUE_ITEM (item));
+
+    for (i = 0; i < PLAY_QUEUE_ITEM_METADATA_SLOTS; i++) {
+        g_free (item->meta[i]);
+        item->meta[i] = NULL;
+    }
+}
+
+// Return the duration of the queue item in nanoseconds or -1 if it
+// is not known
+gint64 play_queue_item_get_duration (PlayQueueItem *item)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE_ITEM (item), -1);
+
+    return item->duration;
+}
+
+// Set the duration of the queue item in nanoseconds, use -1 to unset it
+void play_queue_item_set_duration (PlayQueueItem *item, gint64 duration)
 {
     g_return_if_fail (PLAY_IS_QUEUE_ITEM (item));
 
-    g_hash_table_remove_all (item->meta);
+    item->duration = duration;
+}
+
+// Unset the location of the queue item
+static void queue_item_clear_uri (PlayQueueItem *item)
+{
+    if (item->cache) {
+        if (item->cache->file)
+            g_object_unref (item->cache->file);
+
+        g_free (item->cache->uri);
+        g_free (item->cache->name);
+        g_slice_free (PlayQueueItemCache, item->cache);
+        item->cache = NULL;
+    }
+    g_free (item->suffix);
+
+    if (item->prefix)
+        queue_item_prefix_unref (item->prefix);
+
+    item->prefix = NULL;
+    item->suffix = NULL;
+}
+
+// Split the location into the shared directory part and the rest
+static void queue_item_split (PlayQueueItem *item,
+                              const gchar *location,
+                              gboolean resolved)
+{
+    const gchar *end;
+    const gchar *p;
+
+    // The location is split after the last slash of its path, the query
+    // and fragment parts of a URI may contain slashes as well
+    end = location + strcspn (location, "?#");
+    for (p = end; p > location && p[-1] != '/'; p--)
+        ;
+
+    // The directory part including the scheme and host name is shared with
+    // the other items in the same directory or on the same server
+    item->prefix   = queue_item_prefix_ref (location, p - location);
+    item->suffix   = g_strdup (p);
+    item->resolved = resolved;
+}
+
+// Turn a file path or URI set by play_queue_item_set_file_or_uri () into
+// a URI
+static void queue_item_resolve (PlayQueueItem *item)
+{
+    const gchar *prefix;
+    GFile *file;
+    gchar *location;
+    gchar *uri;
+
+    if (item->resolved)
+        return;
+
+    location = g_strconcat (item->prefix, item->suffix, NULL);
+    file = g_file_new_for_commandline_arg (location);
+    uri  = g_file_get_uri (file);
+
+    // The previous directory part is released after taking the new one,
+    // so it is not freed and created again if they are the same
+    prefix = item->prefix;
+    g_free (item->suffix);
+    queue_item_split (item, uri, TRUE);
+    queue_item_prefix_unref (prefix);
+
+    g_object_unref (file);
+    g_free (location);
+    g_free (uri);
+}
+
+// Return the cache of values derived from the URI, create it if needed
+static PlayQueueItemCache *queue_item_get_cache (PlayQueueItem *item)
+{
+    if (!item->cache)
+        item->cache = g_slice_new0 (PlayQueueItemCache);
+
+    return item->cache;
+}
+
+// Replace a metadata value, the value is owned by the queue item
+static void queue_item_set_meta (PlayQueueItem *item,
+                                 PlayMetadata type,
+                                 gchar *value)
+{
+    g_free (QUEUE_ITEM_META (item, type));
+
+    QUEUE_ITEM_META (item, type) = value;
+}
+
+// Return the shared copy of the first length bytes of the location and
+// take a reference to it
+static const gchar *queue_item_prefix_ref (const gchar *location,
+                                           gsize length)
+{
+    PlayQueueItemPrefix *prefix;
+    gchar               *key;
+
+    key = g_strndup (location, length);
+
+    g_mutex_lock (&queue_item_prefixes_lock);
+    if (G_UNLIKELY (!queue_item_prefixes))
+        queue_item_prefixes = g_hash_table_new_full (
+            g_str_hash,
+            g_str_equal,
+            NULL,
+            g_free);
+
+    prefix = g_hash_table_lookup (queue_item_prefixes, key);
+    if (!prefix) {
+        // The string is stored in the same block as the count and also
+        // serves as the key
+        prefix = g_malloc (sizeof (PlayQueueItemPrefix) + length);
+        prefix->refs = 0;
+        memcpy (prefix->str, key, length + 1);
+
+        g_hash_table_insert (queue_item_prefixes, prefix->str, prefix);
+    }
+    prefix->refs++;
+    g_mutex_unlock (&queue_item_prefixes_lock);
+
+    g_free (key);
+    return prefix->str;
+}
+
+// Release a reference to a shared directory part, it is freed once no
+// item uses it
+static void queue_item_prefix_unref (const gchar *prefix)
+{
+    PlayQueueItemPrefix *data;
+
+    g_mutex_lock (&queue_item_prefixes_lock);
+    data = g_hash_table_lookup (queue_item_prefixes, prefix);
+    if (G_LIKELY (data) && !--data->refs)
+        g_hash_table_remove (queue_item_prefixes, prefix);
+    g_mutex_unlock (&queue_item_prefixes_lock);
 }
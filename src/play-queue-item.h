@@ -17,6 +17,10 @@ typedef enum {
     PLAY_METADATA_TITLE_FULL
 } PlayMetadata;
 
+// Number of metadata values kept by each queue item, one for each of the
+// PLAY_METADATA_* types except for PLAY_METADATA_UNKNOWN
+#define PLAY_QUEUE_ITEM_METADATA_SLOTS 3
+
 #define PLAY_TYPE_METADATA                       \
     (play_metadata_get_type())
 #define PLAY_TYPE_QUEUE_ITEM                     \
@@ -32,13 +36,23 @@ typedef enum {
 #define PLAY_QUEUE_ITEM_GET_CLASS(o)             \
     (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_QUEUE_ITEM, PlayQueueItemClass))
 
+// Values derived from the URI, only created for the items which are
+// actually displayed or played
 typedef struct {
-    GObject       parent_instance;
     GFile        *file;
-    GHashTable   *meta;
     gchar        *uri;
     gchar        *name;
-    time_t        time_meta_artist;
+} PlayQueueItemCache;
+
+typedef struct {
+    GObject             parent_instance;
+    const gchar        *prefix;
+    gchar              *suffix;
+    PlayQueueItemCache *cache;
+    gchar              *meta[PLAY_QUEUE_ITEM_METADATA_SLOTS];
+    gint64              duration;
+    time_t              time_meta_artist;
+    gboolean            resolved;
 } PlayQueueItem;
 
 typedef struct {
@@ -52,22 +66,42 @@ extern GType play_queue_item_get_type (void);
 extern PlayQueueItem *play_queue_item_new (void);
 
 // Set the queue item to the given file path or URI
+// The location is only resolved when the URI, GFile or name of the item
+// is requested
 extern gboolean play_queue_item_set_file_or_uri (PlayQueueItem *item,
                                                  const gchar *file_or_uri);
 
 // Set the queue item to the given GFile
 extern gboolean play_queue_item_set_gfile (PlayQueueItem *item, GFile *file);
 
+// Set the queue item to the given URI
+extern gboolean play_queue_item_set_uri (PlayQueueItem *item,
+                                         const gchar *uri);
+
 // Return TRUE if there is a file or location associated with this
 // queue item, otherwise return FALSE
 extern gboolean play_queue_item_is_valid (PlayQueueItem *item);
 
+// Return TRUE if the queue item is a local file
+extern gboolean play_queue_item_is_native (PlayQueueItem *item);
+
 // Return URI of the queue item
-// The returned value is owned by the PlayQueueItem
+// The returned value is owned by the PlayQueueItem and kept for its
+// lifetime, use play_queue_item_dup_uri() when going through many items
 extern const gchar *play_queue_item_get_uri (PlayQueueItem *item);
 
+// Return a newly allocated URI of the queue item
+// Free the returned value with g_free()
+extern gchar *play_queue_item_dup_uri (PlayQueueItem *item);
+
+// Return a newly allocated file path or URI of the queue item as it was
+// set, without resolving it
+// Free the returned value with g_free()
+extern gchar *play_queue_item_dup_location (PlayQueueItem *item);
+
 // Retrieve GFile of the queue item
-// Use g_object_ref() to keep the reference
+// The GFile is created on the first call and kept for the lifetime of
+// the PlayQueueItem, use g_object_ref() to keep the reference
 extern GFile *play_queue_item_get_gfile (PlayQueueItem *item);
 
 // Return a name to be displayed in the user interface
@@ -90,6 +124,14 @@ extern gboolean play_queue_item_set_metadata (PlayQueueItem *item,
 // Unset all the saved metadata
 extern void play_queue_item_clear_metadata (PlayQueueItem *item);
 
+// Return the duration of the queue item in nanoseconds or -1 if it
+// is not known
+extern gint64 play_queue_item_get_duration (PlayQueueItem *item);
+
+// Set the duration of the queue item in nanoseconds, use -1 to unset it
+extern void play_queue_item_set_duration (PlayQueueItem *item,
+                                          gint64 duration);
+
 G_END_DECLS
 
 #endif // _PLAY_QUEUE_ITEM_H_
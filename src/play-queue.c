@@ -4,17 +4,31 @@
  * Copyright (C) 2011-2013 Michal Ratajsky <michal.ratajsky@gmail.com>
  */
 #include "play-common.h"
+#include "play-library.h"
 #include "play-playlist.h"
 #include "play-queue.h"
 #include "play-queue-item.h"
+#include "play-scanner.h"
+#include "play-stats.h"
 
 G_DEFINE_TYPE (PlayQueue, play_queue, G_TYPE_OBJECT);
 
 typedef struct {
-    guint current_bytes;
-    guint total_bytes;
+    guint64 current_bytes;
+    guint64 total_bytes;
 } PlayQueueDownload;
 
+// An item stored in the queue along with the order it was added in
+typedef struct {
+    PlayQueueItem *item;
+    guint          position;
+    guint          serial;
+} PlayQueueEntry;
+
+// Return a pointer to the queue entry at the given index
+#define QUEUE_ENTRY(queue, index) \
+    (&g_array_index ((queue)->items, PlayQueueEntry, (index)))
+
 // Add a GFile to the queue
 static gboolean queue_add_gfile (PlayQueue *queue, GFile *file);
 
@@ -24,20 +38,47 @@ static gboolean queue_add_item (PlayQueue *queue,
                                 PlayQueueItem *item,
                                 guint position);
 
+// Add an array of PlayQueueItems to the queue at the given position
+// If the given position is 0 the items are placed at the end of the queue
+static gboolean queue_add_items (PlayQueue *queue,
+                                 PlayQueueItem **items,
+                                 guint count,
+                                 guint position);
+
+// Scan a directory and add the media files found in it to the queue
+static gboolean queue_add_directory (PlayQueue *queue, GFile *file);
+
 // Read a playlist and add the content to the queue
 static gboolean queue_add_playlist (PlayQueue *queue, GFile *file);
 
 // Free memory allocated for a temporary data structure
 static void queue_download_free (PlayQueueDownload *download);
 
+// A playlist or directory at the given position has been read
+static void queue_pending_remove (PlayQueue *queue, guint position);
+
+// Release the item reference held by a queue entry
+static void queue_entry_clear (PlayQueueEntry *entry);
+
+// Find the lowest position of the items in the queue again after the item
+// with the lowest position has been removed
+static void queue_update_first_position (PlayQueue *queue);
+
 // Download progress of a playlist has been updated
 static void queue_playlist_download_progress (PlayPlaylist *playlist,
                                               guint id,
-                                              guint current_bytes,
-                                              guint total_bytes,
+                                              guint64 current_bytes,
+                                              guint64 total_bytes,
                                               gpointer custom,
                                               PlayQueue *queue);
 
+// Announce the download progress now or schedule it for later to keep
+// the rate of announcements limited
+static void queue_progress_updated (PlayQueue *queue, gboolean now);
+
+// Announce the download progress delayed by queue_progress_updated()
+static gboolean queue_progress_timeout (PlayQueue *queue);
+
 // Handle a playlist reading/parsing error by forwarding it
 // to the queue owner
 static void queue_playlist_error (PlayPlaylist *playlist,
@@ -52,42 +93,56 @@ static void queue_playlist_finished (PlayPlaylist *playlist,
                                      gpointer custom,
                                      PlayQueue *queue);
 
-// A file or URI has been found in a playlist
-static void queue_playlist_item (PlayPlaylist *playlist,
+// A batch of files or URIs has been found in a playlist
+static void queue_playlist_items (PlayPlaylist *playlist,
+                                  guint id,
+                                  GPtrArray *items,
+                                  gpointer custom,
+                                  PlayQueue *queue);
+
+// Handle a directory scanning error by forwarding it to the queue owner
+static void queue_scanner_error (PlayScanner *scanner,
                                  guint id,
-                                 PlayQueueItem *item,
+                                 const gchar *error,
                                  gpointer custom,
                                  PlayQueue *queue);
 
-// Helper sorting function used for position sorting
-static gint queue_sort_position (gconstpointer a,
-                                 gconstpointer b,
-                                 gpointer data);
+// A directory has been completely scanned and no more callbacks will follow
+static void queue_scanner_finished (PlayScanner *scanner,
+                                    guint id,
+                                    gpointer custom,
+                                    PlayQueue *queue);
+
+// A batch of media files has been found in a directory
+static void queue_scanner_items (PlayScanner *scanner,
+                                 guint id,
+                                 GPtrArray *items,
+                                 gpointer custom,
+                                 PlayQueue *queue);
 
-// Helper sorting function used for random sorting
-static gint queue_sort_random (gconstpointer a,
-                               gconstpointer b,
-                               gpointer data);
+// Helper sorting function used for position sorting
+static gint queue_sort_position (gconstpointer a, gconstpointer b);
 
-// Helper sorting function used for reverse sorting
-static gint queue_sort_reverse (gconstpointer a,
-                                gconstpointer b,
-                                gpointer data);
+// Swap two queue entries, the current position follows the item
+// it points to
+static void queue_swap (PlayQueue *queue, guint a, guint b);
 
-// Recalculate the total number of already downloaded bytes
-static void queue_update_download_current (PlayQueue *queue);
+// Announce the replacement content once all of it has been read
+static void queue_replacement_check (PlayQueue *queue);
 
-// Recalculate the total number of already downloaded bytes - helper function
-static void queue_update_download_current_func (gpointer key,
-                                                PlayQueueDownload *download,
-                                                PlayQueue *queue);
+// Forward an error of reading the replacement content
+static void queue_replacement_error (PlayQueue *replacement,
+                                     const gchar *uri,
+                                     const gchar *error,
+                                     PlayQueue *queue);
 
 // Signals
 enum {
-    ITEM_ADDED,
+    ITEMS_ADDED,
     PLAYLIST_ERROR,
     PLAYLIST_FINISHED,
     PLAYLIST_PROGRESS_UPDATED,
+    REPLACEMENT_READY,
     LAST_SIGNAL
 };
 static guint signals[LAST_SIGNAL];
@@ -98,10 +153,24 @@ static void play_queue_finalize (GObject *object)
     PlayQueue *queue = PLAY_QUEUE (object);
 
     // Clean up
-    g_sequence_free (queue->sequence);
+    g_array_unref (queue->items);
+    g_array_unref (queue->pending_positions);
     g_object_unref (queue->playlist);
     g_hash_table_destroy (queue->download);
 
+    if (queue->progress_source)
+        g_source_remove (queue->progress_source);
+
+    // The scanning threads may keep the scanner alive for a while
+    play_scanner_cancel_all (queue->scanner);
+    g_signal_handlers_disconnect_by_data (queue->scanner, queue);
+    g_object_unref (queue->scanner);
+
+    if (queue->replacement) {
+        g_signal_handlers_disconnect_by_data (queue->replacement, queue);
+        g_object_unref (queue->replacement);
+    }
+
     // Chain up to the parent class
     G_OBJECT_CLASS (play_queue_parent_class)->finalize (object);
 }
@@ -114,17 +183,18 @@ static void play_queue_class_init (PlayQueueClass *klass)
     gobject_class->finalize = play_queue_finalize;
 
     // Signals
-    signals[ITEM_ADDED] =
-        g_signal_new ("item-added",
+    signals[ITEMS_ADDED] =
+        g_signal_new ("items-added",
                       G_TYPE_FROM_CLASS (gobject_class),
                       G_SIGNAL_RUN_LAST,
-                      G_STRUCT_OFFSET (PlayQueueClass, item_added),
+                      G_STRUCT_OFFSET (PlayQueueClass, items_added),
                       NULL,
                       NULL,
-                      g_cclosure_marshal_VOID__OBJECT,
+                      play_marshal_VOID__UINT_UINT,
                       G_TYPE_NONE,
-                      1,
-                      PLAY_TYPE_QUEUE_ITEM);
+                      2,
+                      G_TYPE_UINT,
+                      G_TYPE_UINT);
     signals[PLAYLIST_ERROR] =
         g_signal_new ("playlist-error",
                       G_TYPE_FROM_CLASS (gobject_class),
@@ -158,13 +228,30 @@ static void play_queue_class_init (PlayQueueClass *klass)
                       g_cclosure_marshal_VOID__VOID,
                       G_TYPE_NONE,
                       0);
+    signals[REPLACEMENT_READY] =
+        g_signal_new ("replacement-ready",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayQueueClass, replacement_ready),
+                      NULL,
+                      NULL,
+                      g_cclosure_marshal_VOID__VOID,
+                      G_TYPE_NONE,
+                      0);
 }
 
 // GObject/init
 static void play_queue_init (PlayQueue *queue)
 {
-    queue->sequence = g_sequence_new ((GDestroyNotify) g_object_unref);
+    queue->items = g_array_new (FALSE, FALSE, sizeof (PlayQueueEntry));
+    g_array_set_clear_func (
+        queue->items,
+        (GDestroyNotify) queue_entry_clear);
+    queue->current  = -1;
     queue->position = 1;
+    queue->first_position = G_MAXUINT;
+    queue->pending_positions = g_array_new (FALSE, FALSE, sizeof (guint));
+    queue->progress_interval = PLAY_QUEUE_PROGRESS_INTERVAL;
     queue->playlist = play_playlist_new ();
     queue->download = g_hash_table_new_full (
         g_direct_hash,
@@ -188,8 +275,25 @@ static void play_queue_init (PlayQueue *queue)
         queue);
     g_signal_connect (
         queue->playlist,
-        "queue-item",
-        G_CALLBACK (queue_playlist_item),
+        "queue-items",
+        G_CALLBACK (queue_playlist_items),
+        queue);
+
+    queue->scanner = play_scanner_new ();
+    g_signal_connect (
+        queue->scanner,
+        "error",
+        G_CALLBACK (queue_scanner_error),
+        queue);
+    g_signal_connect (
+        queue->scanner,
+        "finished",
+        G_CALLBACK (queue_scanner_finished),
+        queue);
+    g_signal_connect (
+        queue->scanner,
+        "queue-items",
+        G_CALLBACK (queue_scanner_items),
         queue);
 }
 
@@ -215,7 +319,14 @@ gboolean play_queue_add (PlayQueue *queue, const gchar *file_or_uri)
     file = g_file_new_for_commandline_arg (file_or_uri);
     name = g_file_get_basename (file);
     if (name) {
-        if (play_playlist_file_is_playlist (name)) {
+        if (g_file_is_native (file) &&
+            g_file_query_file_type (
+                file,
+                G_FILE_QUERY_INFO_NONE,
+                NULL) == G_FILE_TYPE_DIRECTORY) {
+            // Add the media files found in the directory tree
+            result = queue_add_directory (queue, file);
+        } else if (play_playlist_file_is_playlist (name)) {
             // Read the list of media from a playlist
             result = queue_add_playlist (queue, file);
         } else {
@@ -230,12 +341,48 @@ gboolean play_queue_add (PlayQueue *queue, const gchar *file_or_uri)
     return result;
 }
 
+// Add an array of PlayQueueItems to the end of the queue
+// The items are added at once and announced by a single "items-added" signal
+// Returns TRUE on success
+gboolean play_queue_add_items (PlayQueue *queue, GPtrArray *items)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+    g_return_val_if_fail (items, FALSE);
+
+    return queue_add_items (
+        queue,
+        (PlayQueueItem **) items->pdata,
+        items->len,
+        0);
+}
+
+// Add all the tracks of a media library index to the end of the queue
+// The index is expected to be loaded, the media files are not accessed
+// Returns TRUE on success
+gboolean play_queue_add_library (PlayQueue *queue, PlayLibrary *library)
+{
+    GPtrArray *items;
+    gboolean   ret;
+
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+    g_return_val_if_fail (PLAY_IS_LIBRARY (library), FALSE);
+
+    items = play_library_get_items (library);
+    ret = queue_add_items (
+        queue,
+        (PlayQueueItem **) items->pdata,
+        items->len,
+        0);
+    g_ptr_array_unref (items);
+    return ret;
+}
+
 // Return the count of items in the queue
 guint play_queue_get_count (PlayQueue *queue)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), 0);
 
-    return g_sequence_get_length (queue->sequence);
+    return queue->items->len;
 }
 
 // Return the number of bytes already dowloaded from remote playlists
@@ -250,8 +397,45 @@ guint64 play_queue_get_download_total (PlayQueue *queue)
     return queue->download_total;
 }
 
+// Set the minimum number of milliseconds between two emissions of the
+// "playlist-progress-updated" signal, 0 announces every update
+void play_queue_set_progress_interval (PlayQueue *queue, guint interval)
+{
+    g_return_if_fail (PLAY_IS_QUEUE (queue));
+
+    queue->progress_interval = interval;
+}
+
+// Set the maximum number of remote playlists downloaded at the same time
+// in total and from a single host, use 0 for no limit
+void play_queue_set_max_downloads (PlayQueue *queue,
+                                   guint max_downloads,
+                                   guint max_downloads_host)
+{
+    g_return_if_fail (PLAY_IS_QUEUE (queue));
+
+    play_playlist_set_max_downloads (
+        queue->playlist,
+        max_downloads,
+        max_downloads_host);
+}
+
+// Set the number of seconds to wait for a connection to a server with
+// a remote playlist and for more data to arrive, use 0 to wait indefinitely
+void play_queue_set_download_timeouts (PlayQueue *queue,
+                                       guint timeout_connect,
+                                       guint timeout_read)
+{
+    g_return_if_fail (PLAY_IS_QUEUE (queue));
+
+    play_playlist_set_download_timeouts (
+        queue->playlist,
+        timeout_connect,
+        timeout_read);
+}
+
 // Return the number of items still waiting to be added to the queue
-// These are playlists being downloaded
+// These are playlists being downloaded and directories being scanned
 guint play_queue_get_count_pending (PlayQueue *queue)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), 0);
@@ -259,36 +443,97 @@ guint play_queue_get_count_pending (PlayQueue *queue)
     return queue->pending;
 }
 
+// Return TRUE if the item to be played first after sorting the queue by
+// position is already in the queue, although playlists and directories
+// with later positions may still be being read
+gboolean play_queue_first_is_ready (PlayQueue *queue)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+
+    if (queue->first_position == G_MAXUINT)
+        return FALSE;
+
+    // The items of a playlist or directory arrive in their order, so once
+    // any of them is in the queue, so is the first one
+    // The pending positions are kept in ascending order
+    if (!queue->pending_positions->len)
+        return TRUE;
+
+    return queue->first_position <=
+           g_array_index (queue->pending_positions, guint, 0);
+}
+
 // Return the queue item at the current position or NULL if the queue is empty
 PlayQueueItem *play_queue_get_current (PlayQueue *queue)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), NULL);
 
     // Empty queue
-    if (!queue->iterator)
+    if (queue->current < 0)
+        return NULL;
+
+    return QUEUE_ENTRY (queue, queue->current)->item;
+}
+
+// Return the index of the current position
+// Returns -1 if the queue is empty
+gint play_queue_get_current_index (PlayQueue *queue)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), -1);
+
+    return queue->current;
+}
+
+// Return the queue item at the given index or NULL if the index is
+// out of range
+PlayQueueItem *play_queue_get_nth (PlayQueue *queue, guint index)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), NULL);
+
+    if (index >= queue->items->len)
         return NULL;
 
-    return g_sequence_get (queue->iterator);
+    return QUEUE_ENTRY (queue, index)->item;
 }
 
 // Return the queue item at a random position or NULL if the queue is empty
 PlayQueueItem *play_queue_get_random (PlayQueue *queue)
 {
-    GSequenceIter *iter;
-
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), NULL);
 
     // Empty queue
-    if (!queue->iterator)
+    if (queue->current < 0)
+        return NULL;
+
+    return QUEUE_ENTRY (
+        queue,
+        g_random_int_range (0, queue->items->len))->item;
+}
+
+// Return the queue item following the current position
+// Returns NULL if the queue is empty or already at the last item
+PlayQueueItem *play_queue_get_next (PlayQueue *queue)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), NULL);
+
+    // Empty queue or the last item
+    if (queue->current < 0 || queue->current + 1 >= queue->items->len)
         return NULL;
 
-    iter = g_sequence_get_iter_at_pos (
-        queue->sequence,
-        g_random_int_range (0, play_queue_get_count (queue)));
-    if (!iter)
+    return QUEUE_ENTRY (queue, queue->current + 1)->item;
+}
+
+// Return the queue item at the first position
+// Returns NULL if the queue is empty
+PlayQueueItem *play_queue_get_first (PlayQueue *queue)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), NULL);
+
+    // Empty queue
+    if (queue->current < 0)
         return NULL;
 
-    return g_sequence_get (iter);
+    return QUEUE_ENTRY (queue, 0)->item;
 }
 
 // Set the current queue position to the first item of the queue
@@ -297,7 +542,7 @@ gboolean play_queue_position_set_first (PlayQueue *queue)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    queue->iterator = g_sequence_get_begin_iter (queue->sequence);
+    queue->current = queue->items->len ? 0 : -1;
     return TRUE;
 }
 
@@ -307,9 +552,20 @@ gboolean play_queue_position_set_last (PlayQueue *queue)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    queue->iterator = g_sequence_iter_prev (
-        g_sequence_get_end_iter (queue->sequence));
+    queue->current = (gint) queue->items->len - 1;
+    return TRUE;
+}
+
+// Set the current queue position to the item at the given index
+// Returns FALSE if the index is out of range
+gboolean play_queue_position_set_index (PlayQueue *queue, guint index)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
+    if (index >= queue->items->len)
+        return FALSE;
+
+    queue->current = (gint) index;
     return TRUE;
 }
 
@@ -318,20 +574,13 @@ gboolean play_queue_position_set_last (PlayQueue *queue)
 // Returns FALSE if the queue is empty or already at the last item
 gboolean play_queue_position_set_next (PlayQueue *queue)
 {
-    GSequenceIter *iter;
-
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    // Empty queue
-    if (!queue->iterator)
+    // Empty queue or the last item
+    if (queue->current < 0 || queue->current + 1 >= queue->items->len)
         return FALSE;
 
-    iter = g_sequence_iter_next (queue->iterator);
-    // Do not let the iterator go beyond the last element in the sequence
-    if (iter == g_sequence_get_end_iter (queue->sequence))
-        return FALSE;
-
-    queue->iterator = iter;
+    queue->current++;
     return TRUE;
 }
 
@@ -340,21 +589,13 @@ gboolean play_queue_position_set_next (PlayQueue *queue)
 // Returns FALSE if the queue is empty or already at the first item
 gboolean play_queue_position_set_previous (PlayQueue *queue)
 {
-    GSequenceIter *iter;
-
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    // Empty queue
-    if (!queue->iterator)
-        return FALSE;
-
-    iter = g_sequence_iter_prev (queue->iterator);
-    // If the previous iterator is the same as the current one, we are
-    // already at the first item
-    if (iter == queue->iterator)
+    // Empty queue or the first item
+    if (queue->current <= 0)
         return FALSE;
 
-    queue->iterator = iter;
+    queue->current--;
     return TRUE;
 }
 
@@ -363,11 +604,7 @@ gboolean play_queue_position_is_first (PlayQueue *queue)
 {
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    // Empty queue
-    if (!queue->iterator)
-        return FALSE;
-
-    return g_sequence_iter_is_begin (queue->iterator);
+    return queue->current == 0;
 }
 
 // Return TRUE if the current position is at the last item of the queue
@@ -376,14 +613,10 @@ gboolean play_queue_position_is_last (PlayQueue *queue)
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
     // Empty queue
-    if (!queue->iterator)
+    if (queue->current < 0)
         return FALSE;
 
-    // The GSequence iterator can point behind the last element,
-    // we do not let this happen and instead check if it points one step
-    // before (on the last element)
-    return queue->iterator == g_sequence_iter_prev (
-        g_sequence_get_end_iter (queue->sequence));
+    return queue->current + 1 == queue->items->len;
 }
 
 // Randomize the order of items in the queue
@@ -392,9 +625,17 @@ gboolean play_queue_position_is_last (PlayQueue *queue)
 // to the first item of the queue
 gboolean play_queue_randomize (PlayQueue *queue)
 {
+    guint i;
+
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    g_sequence_sort (queue->sequence, queue_sort_random, NULL);
+    // Fisher-Yates shuffle, the current position follows the item
+    // it points to
+    for (i = queue->items->len; i > 1; i--) {
+        guint j = (guint) g_random_int_range (0, i);
+
+        queue_swap (queue, i - 1, j);
+    }
     return TRUE;
 }
 
@@ -404,9 +645,13 @@ gboolean play_queue_randomize (PlayQueue *queue)
 // to the first item of the queue
 gboolean play_queue_reverse (PlayQueue *queue)
 {
+    guint i;
+
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    g_sequence_sort (queue->sequence, queue_sort_reverse, NULL);
+    for (i = 0; i < queue->items->len / 2; i++)
+        queue_swap (queue, i, queue->items->len - 1 - i);
+
     return TRUE;
 }
 
@@ -416,14 +661,13 @@ gboolean play_queue_remove_all (PlayQueue *queue)
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
     // Empty queue
-    if (!queue->iterator)
+    if (queue->current < 0)
         return FALSE;
 
-    g_sequence_remove_range (
-        g_sequence_get_begin_iter (queue->sequence),
-        g_sequence_get_end_iter (queue->sequence));
+    g_array_set_size (queue->items, 0);
 
-    queue->iterator = NULL;
+    queue->current = -1;
+    queue->first_position = G_MAXUINT;
     return TRUE;
 }
 
@@ -432,28 +676,24 @@ gboolean play_queue_remove_all (PlayQueue *queue)
 // before the removed item (before when removing the last item)
 gboolean play_queue_remove_current (PlayQueue *queue)
 {
-    GSequenceIter *iter;
+    guint position;
 
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
     // Empty queue
-    if (!queue->iterator)
+    if (queue->current < 0)
         return FALSE;
 
-    // Find the nearest valid position to keep the current position on
-    // a valid element
-    // If the removed element is the last one, set the iterator to NULL
-    iter = g_sequence_iter_next (queue->iterator);
-    if (g_sequence_iter_is_end (iter)) {
-        if (g_sequence_iter_is_begin (queue->iterator))
-            iter = NULL;
-        else
-            iter = g_sequence_iter_prev (queue->iterator);
-    }
-    g_sequence_remove (queue->iterator);
+    // The following item takes the place of the removed one, when
+    // removing the last item move back to the previous one
+    position = QUEUE_ENTRY (queue, queue->current)->position;
+    g_array_remove_index (queue->items, queue->current);
+    if (queue->current >= queue->items->len)
+        queue->current = (gint) queue->items->len - 1;
+
+    if (position == queue->first_position)
+        queue_update_first_position (queue);
 
-    // Fix the current position
-    queue->iterator = iter;
     return TRUE;
 }
 
@@ -462,22 +702,25 @@ gboolean play_queue_remove_current (PlayQueue *queue)
 // the nearest valid item
 gboolean play_queue_remove_last (PlayQueue *queue)
 {
-    GSequenceIter *iter;
+    guint position;
 
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
     // Empty queue
-    if (!queue->iterator)
+    if (queue->current < 0)
         return FALSE;
 
-    // Find the last element
-    iter = g_sequence_iter_prev (g_sequence_get_end_iter (queue->sequence));
-    if (iter == queue->iterator) {
-        // The current position is at the iterator to be deleted and it
+    if (queue->current + 1 == queue->items->len) {
+        // The current position is at the item to be deleted and it
         // will have to be adjusted
         return play_queue_remove_current (queue);
     }
-    g_sequence_remove (iter);
+    position = QUEUE_ENTRY (queue, queue->items->len - 1)->position;
+    g_array_remove_index (queue->items, queue->items->len - 1);
+
+    if (position == queue->first_position)
+        queue_update_first_position (queue);
+
     return TRUE;
 }
 
@@ -485,9 +728,179 @@ gboolean play_queue_remove_last (PlayQueue *queue)
 // This function should be called after all items are added to the queue
 gboolean play_queue_sort_by_position (PlayQueue *queue)
 {
+    PlayQueueItem *current;
+    guint i;
+
     g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
 
-    g_sequence_sort (queue->sequence, queue_sort_position, NULL);
+    current = play_queue_get_current (queue);
+
+    g_array_sort (queue->items, queue_sort_position);
+
+    // Find the item which was at the current position before sorting
+    if (current) {
+        for (i = 0; i < queue->items->len; i++)
+            if (QUEUE_ENTRY (queue, i)->item == current) {
+                queue->current = (gint) i;
+                break;
+            }
+    }
+    return TRUE;
+}
+
+// Read a file, directory or URI in the background to replace the content
+// of the queue, the "replacement-ready" signal is emitted once it has
+// been read
+// Returns FALSE on error or if another replacement is still being read
+gboolean play_queue_prepare_replacement (PlayQueue *queue,
+                                         const gchar *file_or_uri)
+{
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+    g_return_val_if_fail (file_or_uri, FALSE);
+
+    if (!queue->replacement) {
+        // The content is read by a queue of its own, which downloads
+        // remote playlists with the same limits
+        queue->replacement = play_queue_new ();
+        play_queue_set_max_downloads (
+            queue->replacement,
+            queue->playlist->downloader->max_downloads,
+            queue->playlist->downloader->max_downloads_host);
+        play_queue_set_download_timeouts (
+            queue->replacement,
+            queue->playlist->downloader->timeout_connect,
+            queue->playlist->downloader->timeout_read);
+        g_signal_connect_swapped (
+            queue->replacement,
+            "items-added",
+            G_CALLBACK (queue_replacement_check),
+            queue);
+        g_signal_connect_swapped (
+            queue->replacement,
+            "playlist-finished",
+            G_CALLBACK (queue_replacement_check),
+            queue);
+        g_signal_connect (
+            queue->replacement,
+            "playlist-error",
+            G_CALLBACK (queue_replacement_error),
+            queue);
+    } else {
+        // Playlists cannot be cancelled, so their items would end up
+        // in the next replacement
+        if (queue->replacement->pending)
+            return FALSE;
+
+        play_queue_remove_all (queue->replacement);
+    }
+    return play_queue_add (queue->replacement, file_or_uri);
+}
+
+// Replace the content of the queue with the prepared replacement at once
+// and set the current position to its first item
+// Returns FALSE if no replacement is ready
+gboolean play_queue_replace (PlayQueue *queue)
+{
+    PlayQueue *replacement;
+    GArray    *items;
+    guint      first_position;
+
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+
+    replacement = queue->replacement;
+    if (!replacement || replacement->pending || !replacement->items->len)
+        return FALSE;
+
+    // Swap the arrays, the replaced items are then released by emptying
+    // the replacement queue
+    items = queue->items;
+    first_position = replacement->first_position;
+    queue->items = replacement->items;
+    replacement->items = items;
+    play_queue_remove_all (replacement);
+    queue->first_position = first_position;
+
+    // Items added later are placed after the new content
+    queue->position = MAX (queue->position, replacement->position);
+    queue->serial   = MAX (queue->serial, replacement->serial);
+    queue->current  = 0;
+
+    PLAY_STATS_SET ("queue.length", queue->items->len);
+    return TRUE;
+}
+
+// Move the items from the given index to the end of the queue to their
+// places by position not before the first index, the items between the
+// first index and the given index are expected to be sorted already
+// The current position is kept at the item it was before the call
+gboolean play_queue_merge_by_position (PlayQueue *queue,
+                                       guint first,
+                                       guint index)
+{
+    PlayQueueItem  *current;
+    PlayQueueEntry *entries;
+    PlayQueueEntry *added;
+    guint count;
+    gint  i, j, k;
+
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+
+    if (index >= queue->items->len)
+        return FALSE;
+
+    current = play_queue_get_current (queue);
+    entries = QUEUE_ENTRY (queue, 0);
+    count   = queue->items->len - index;
+
+    // Sort the added items and merge them with the sorted part from the
+    // end, which only moves the items placed after them
+    // The items before the first index are kept in place
+    added = g_memdup (entries + index, count * sizeof (PlayQueueEntry));
+    g_qsort_with_data (
+        added,
+        count,
+        sizeof (PlayQueueEntry),
+        (GCompareDataFunc) queue_sort_position,
+        NULL);
+
+    i = (gint) index - 1;
+    j = (gint) count - 1;
+    k = (gint) queue->items->len - 1;
+    while (j >= 0) {
+        if (i >= (gint) first &&
+            queue_sort_position (&entries[i], &added[j]) > 0)
+            entries[k] = entries[i--];
+        else
+            entries[k] = added[j--];
+
+        if (entries[k].item == current)
+            queue->current = k;
+        k--;
+    }
+    g_free (added);
+    return TRUE;
+}
+
+// Move the items from the given index to the end of the queue to random
+// places not before the first index, the items between the first index
+// and the given index are expected to be in a random order already
+// The current position is kept at the item it was before the call
+gboolean play_queue_randomize_from (PlayQueue *queue,
+                                    guint first,
+                                    guint index)
+{
+    guint i;
+
+    g_return_val_if_fail (PLAY_IS_QUEUE (queue), FALSE);
+
+    // Continue the inside-out Fisher-Yates shuffle of the range, each
+    // added item swaps places with a random one including itself, which
+    // keeps all orders of the range equally likely
+    for (i = MAX (first, index); i < queue->items->len; i++) {
+        guint j = (guint) g_random_int_range ((gint) first, (gint) i + 1);
+
+        queue_swap (queue, i, j);
+    }
     return TRUE;
 }
 
@@ -513,33 +926,82 @@ static gboolean queue_add_item (PlayQueue *queue,
                                 PlayQueueItem *item,
                                 guint position)
 {
-    // Set the position as the item's custom data
-    g_object_set_data (
-        G_OBJECT (item),
-        "queue-position",
-        GUINT_TO_POINTER (position ? position : queue->position++));
-    // Add to the queue
-    g_sequence_append (queue->sequence, g_object_ref (item));
-    if (!queue->iterator)
-        queue->iterator = g_sequence_get_begin_iter (queue->sequence);
+    return queue_add_items (queue, &item, 1, position);
+}
+
+// Add an array of PlayQueueItems to the queue at the given position
+// If the given position is 0 the items are placed at the end of the queue
+static gboolean queue_add_items (PlayQueue *queue,
+                                 PlayQueueItem **items,
+                                 guint count,
+                                 guint position)
+{
+    guint index;
+    guint i;
+
+    if (!count)
+        return TRUE;
+
+    // Grow the queue once for the whole batch
+    index = queue->items->len;
+    g_array_set_size (queue->items, index + count);
+
+    for (i = 0; i < count; i++) {
+        PlayQueueEntry *entry = QUEUE_ENTRY (queue, index + i);
+
+        entry->item     = g_object_ref (items[i]);
+        entry->position = position ? position : queue->position++;
+        entry->serial   = queue->serial++;
+
+        queue->first_position = MIN (queue->first_position, entry->position);
+    }
+    if (queue->current < 0)
+        queue->current = 0;
+
+    PLAY_STATS_COUNT ("queue.items_added", count);
+    PLAY_STATS_SET ("queue.length", queue->items->len);
 
     g_signal_emit (
         queue,
-        signals[ITEM_ADDED],
+        signals[ITEMS_ADDED],
         0,
-        item);
+        index,
+        count);
     return TRUE;
 }
 
-// Read a playlist and add the content to the queue
-static gboolean queue_add_playlist (PlayQueue *queue, GFile *file)
+// Scan a directory and add the media files found in it to the queue
+static gboolean queue_add_directory (PlayQueue *queue, GFile *file)
 {
-    if (!play_playlist_parse_gfile (
-            queue->playlist,
+    // All the files found in the directory share its position
+    if (!play_scanner_scan_gfile (
+            queue->scanner,
             file,
             GUINT_TO_POINTER (queue->position))) {
         return FALSE;
     }
+    g_array_append_val (queue->pending_positions, queue->position);
+    queue->pending++;
+    queue->position++;
+    return TRUE;
+}
+
+// Read a playlist and add the content to the queue
+static gboolean queue_add_playlist (PlayQueue *queue, GFile *file)
+{
+    guint id;
+
+    id = play_playlist_parse_gfile (
+        queue->playlist,
+        file,
+        GUINT_TO_POINTER (queue->position));
+    if (!id)
+        return FALSE;
+
+    // Remote playlists are downloaded in the order of their places in
+    // the queue, so the ones to be played first arrive first
+    play_playlist_set_priority (queue->playlist, id, (gint) queue->position);
+    g_array_append_val (queue->pending_positions, queue->position);
     queue->pending++;
     queue->position++;
     return TRUE;
@@ -551,11 +1013,46 @@ static void queue_download_free (PlayQueueDownload *download)
     g_slice_free (PlayQueueDownload, download);
 }
 
+// A playlist or directory at the given position has been read
+static void queue_pending_remove (PlayQueue *queue, guint position)
+{
+    guint i;
+
+    queue->pending--;
+
+    // The positions are added in ascending order, which is kept by
+    // the removal
+    for (i = 0; i < queue->pending_positions->len; i++)
+        if (g_array_index (queue->pending_positions, guint, i) == position) {
+            g_array_remove_index (queue->pending_positions, i);
+            break;
+        }
+}
+
+// Release the item reference held by a queue entry
+static void queue_entry_clear (PlayQueueEntry *entry)
+{
+    g_object_unref (entry->item);
+}
+
+// Find the lowest position of the items in the queue again after the item
+// with the lowest position has been removed
+static void queue_update_first_position (PlayQueue *queue)
+{
+    guint i;
+
+    queue->first_position = G_MAXUINT;
+    for (i = 0; i < queue->items->len; i++)
+        queue->first_position = MIN (
+            queue->first_position,
+            QUEUE_ENTRY (queue, i)->position);
+}
+
 // Download progress of a playlist has been updated
 static void queue_playlist_download_progress (PlayPlaylist *playlist,
                                               guint id,
-                                              guint current_bytes,
-                                              guint total_bytes,
+                                              guint64 current_bytes,
+                                              guint64 total_bytes,
                                               gpointer custom,
                                               PlayQueue *queue)
 {
@@ -563,22 +1060,21 @@ static void queue_playlist_download_progress (PlayPlaylist *playlist,
 
     download = g_hash_table_lookup (queue->download, GUINT_TO_POINTER (id));
     if (!download) {
-        download = g_slice_new (PlayQueueDownload);
+        download = g_slice_new0 (PlayQueueDownload);
         g_hash_table_insert (
             queue->download,
             GUINT_TO_POINTER (id),
             download);
-
-        queue->download_total += total_bytes;
     }
-    // Update and recalculate the download progress
+    // Update the totals by the difference, the total size of a download
+    // may only become known after it has started
+    queue->download_current += current_bytes - download->current_bytes;
+    queue->download_total   += total_bytes - download->total_bytes;
+
     download->current_bytes = current_bytes;
-    download->total_bytes = total_bytes;
-    queue_update_download_current (queue);
-    g_signal_emit (
-        queue,
-        signals[PLAYLIST_PROGRESS_UPDATED],
-        0);
+    download->total_bytes   = total_bytes;
+
+    queue_progress_updated (queue, FALSE);
 }
 
 // A playlist has been completely processed and no more callbacks will follow
@@ -595,11 +1091,17 @@ static void queue_playlist_finished (PlayPlaylist *playlist,
     // On very small and fast downloads the progress may not be emitted
     // at all and then the hash entry would not exist
     if (download) {
-        // Update and recalculate the download progress
-        download->current_bytes = download->total_bytes;
-        queue_update_download_current (queue);
+        // The whole size counts as downloaded, if the size has never been
+        // known the downloaded amount becomes the size
+        if (download->total_bytes)
+            queue->download_current +=
+                download->total_bytes - download->current_bytes;
+        else
+            queue->download_total += download->current_bytes;
+
+        g_hash_table_remove (queue->download, GUINT_TO_POINTER (id));
     }
-    queue->pending--;
+    queue_pending_remove (queue, GPOINTER_TO_UINT (custom));
 
     if (g_signal_has_handler_pending (
             queue,
@@ -616,21 +1118,22 @@ static void queue_playlist_finished (PlayPlaylist *playlist,
             uri);
         g_free (uri);
     }
-    g_signal_emit (
-        queue,
-        signals[PLAYLIST_PROGRESS_UPDATED],
-        0);
+    queue_progress_updated (queue, TRUE);
 }
 
-// A file or URI has been found in a playlist
-static void queue_playlist_item (PlayPlaylist *playlist,
-                                 guint id,
-                                 PlayQueueItem *item,
-                                 gpointer custom,
-                                 PlayQueue *queue)
+// A batch of files or URIs has been found in a playlist
+static void queue_playlist_items (PlayPlaylist *playlist,
+                                  guint id,
+                                  GPtrArray *items,
+                                  gpointer custom,
+                                  PlayQueue *queue)
 {
-    // Add an item to the queue with the assigned position
-    queue_add_item (queue, item, (gint) GPOINTER_TO_UINT (custom));
+    // Add the items to the queue with the assigned position
+    queue_add_items (
+        queue,
+        (PlayQueueItem **) items->pdata,
+        items->len,
+        GPOINTER_TO_UINT (custom));
 }
 
 // Handle a playlist reading/parsing error by forwarding it
@@ -647,10 +1150,11 @@ static void queue_playlist_error (PlayPlaylist *playlist,
         queue->download,
         GUINT_TO_POINTER (id));
     if (download) {
-        // Update the download progress
-        queue->download_total -= download->total_bytes;
+        // The failed download is not counted anymore
+        queue->download_current -= download->current_bytes;
+        queue->download_total   -= download->total_bytes;
     }
-    queue->pending--;
+    queue_pending_remove (queue, GPOINTER_TO_UINT (custom));
     g_hash_table_remove (queue->download, GUINT_TO_POINTER (id));
 
     if (g_signal_has_handler_pending (
@@ -669,53 +1173,180 @@ static void queue_playlist_error (PlayPlaylist *playlist,
             error);
         g_free (uri);
     }
-    g_signal_emit (
+    queue_progress_updated (queue, TRUE);
+}
+
+// Handle a directory scanning error by forwarding it to the queue owner
+static void queue_scanner_error (PlayScanner *scanner,
+                                 guint id,
+                                 const gchar *error,
+                                 gpointer custom,
+                                 PlayQueue *queue)
+{
+    queue_pending_remove (queue, GPOINTER_TO_UINT (custom));
+
+    if (g_signal_has_handler_pending (
+            queue,
+            signals[PLAYLIST_ERROR],
+            0,
+            FALSE)) {
+        GFile *file = play_scanner_get_gfile (scanner, id);
+        gchar *uri  = g_file_get_uri (file);
+
+        g_signal_emit (
+            queue,
+            signals[PLAYLIST_ERROR],
+            0,
+            uri,
+            error);
+        g_free (uri);
+    }
+}
+
+// A directory has been completely scanned and no more callbacks will follow
+static void queue_scanner_finished (PlayScanner *scanner,
+                                    guint id,
+                                    gpointer custom,
+                                    PlayQueue *queue)
+{
+    queue_pending_remove (queue, GPOINTER_TO_UINT (custom));
+
+    if (g_signal_has_handler_pending (
+            queue,
+            signals[PLAYLIST_FINISHED],
+            0,
+            FALSE)) {
+        GFile *file = play_scanner_get_gfile (scanner, id);
+        gchar *uri  = g_file_get_uri (file);
+
+        g_signal_emit (
+            queue,
+            signals[PLAYLIST_FINISHED],
+            0,
+            uri);
+        g_free (uri);
+    }
+}
+
+// A batch of media files has been found in a directory
+static void queue_scanner_items (PlayScanner *scanner,
+                                 guint id,
+                                 GPtrArray *items,
+                                 gpointer custom,
+                                 PlayQueue *queue)
+{
+    // Add the items to the queue with the position of the directory
+    queue_add_items (
         queue,
-        signals[PLAYLIST_PROGRESS_UPDATED],
-        0);
+        (PlayQueueItem **) items->pdata,
+        items->len,
+        GPOINTER_TO_UINT (custom));
 }
 
 // Helper sorting function used for position sorting
-static gint queue_sort_position (gconstpointer a,
-                                 gconstpointer b,
-                                 gpointer data)
+// Items with the same position, such as the content of a playlist, are kept
+// in the order they were added in
+static gint queue_sort_position (gconstpointer a, gconstpointer b)
 {
-    return
-        g_object_get_data (G_OBJECT (a), "queue-position") -
-        g_object_get_data (G_OBJECT (b), "queue-position");
+    const PlayQueueEntry *ea = a;
+    const PlayQueueEntry *eb = b;
+
+    if (ea->position != eb->position)
+        return ea->position < eb->position ? -1 : 1;
+    if (ea->serial != eb->serial)
+        return ea->serial < eb->serial ? -1 : 1;
+    return 0;
 }
 
-// Helper sorting function used for random sorting
-static gint queue_sort_random (gconstpointer a,
-                               gconstpointer b,
-                               gpointer data)
+// Swap two queue entries, the current position follows the item
+// it points to
+static void queue_swap (PlayQueue *queue, guint a, guint b)
 {
-    return g_random_boolean () ? 1 : -1;
+    PlayQueueEntry entry;
+
+    if (a == b)
+        return;
+
+    entry = *QUEUE_ENTRY (queue, a);
+    *QUEUE_ENTRY (queue, a) = *QUEUE_ENTRY (queue, b);
+    *QUEUE_ENTRY (queue, b) = entry;
+
+    if (queue->current == (gint) a)
+        queue->current = (gint) b;
+    else if (queue->current == (gint) b)
+        queue->current = (gint) a;
 }
 
-// Helper sorting function used for reverse sorting
-static gint queue_sort_reverse (gconstpointer a,
-                                gconstpointer b,
-                                gpointer data)
+// Announce the download progress now or schedule it for later to keep
+// the rate of announcements limited
+static void queue_progress_updated (PlayQueue *queue, gboolean now)
 {
-    return 1;
+    gint64 elapsed;
+
+    if (!now) {
+        // An announcement is already scheduled and will include this update
+        if (queue->progress_source)
+            return;
+
+        elapsed = (g_get_monotonic_time () - queue->progress_time) / 1000;
+        if (elapsed < queue->progress_interval) {
+            queue->progress_source = g_timeout_add (
+                queue->progress_interval - (guint) elapsed,
+                (GSourceFunc) queue_progress_timeout,
+                queue);
+            return;
+        }
+    } else if (queue->progress_source) {
+        // Finished and failed downloads are announced right away along
+        // with the scheduled update
+        g_source_remove (queue->progress_source);
+        queue->progress_source = 0;
+    }
+    queue->progress_time = g_get_monotonic_time ();
+
+    g_signal_emit (
+        queue,
+        signals[PLAYLIST_PROGRESS_UPDATED],
+        0);
 }
 
-// Recalculate the total number of already downloaded bytes
-static void queue_update_download_current (PlayQueue *queue)
+// Announce the download progress delayed by queue_progress_updated()
+static gboolean queue_progress_timeout (PlayQueue *queue)
 {
-    queue->download_current = 0;
+    queue->progress_source = 0;
+    queue_progress_updated (queue, TRUE);
 
-    g_hash_table_foreach (
-        queue->download,
-        (GHFunc) queue_update_download_current_func,
-        queue);
+    // Return FALSE to stop the function from being called again
+    return FALSE;
 }
 
-// Recalculate the total number of already downloaded bytes - helper function
-static void queue_update_download_current_func (gpointer key,
-                                                PlayQueueDownload *download,
-                                                PlayQueue *queue)
+// Announce the replacement content once all of it has been read
+static void queue_replacement_check (PlayQueue *queue)
 {
-    queue->download_current += download->current_bytes;
+    PlayQueue *replacement = queue->replacement;
+
+    if (replacement->pending || !replacement->items->len)
+        return;
+
+    g_signal_emit (
+        queue,
+        signals[REPLACEMENT_READY],
+        0);
+}
+
+// Forward an error of reading the replacement content
+static void queue_replacement_error (PlayQueue *replacement,
+                                     const gchar *uri,
+                                     const gchar *error,
+                                     PlayQueue *queue)
+{
+    g_signal_emit (
+        queue,
+        signals[PLAYLIST_ERROR],
+        0,
+        uri,
+        error);
+
+    // Other parts of the replacement might have been read successfully
+    queue_replacement_check (queue);
 }
@@ -7,11 +7,17 @@
 #define _PLAY_QUEUE_H_
 
 #include "play-common.h"
+#include "play-library.h"
 #include "play-playlist.h"
 #include "play-queue-item.h"
+#include "play-scanner.h"
 
 G_BEGIN_DECLS
 
+// Default minimum number of milliseconds between two emissions of the
+// "playlist-progress-updated" signal
+#define PLAY_QUEUE_PROGRESS_INTERVAL 100
+
 #define PLAY_TYPE_QUEUE                     \
     (play_queue_get_type())
 #define PLAY_QUEUE(o)                       \
@@ -25,42 +31,60 @@ G_BEGIN_DECLS
 #define PLAY_QUEUE_GET_CLASS(o)             \
     (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_QUEUE, PlayQueueClass))
 
-typedef struct {
+typedef struct _PlayQueue {
     GObject        parent_instance;
     PlayPlaylist  *playlist;
+    PlayScanner   *scanner;
     guint          pending;
+    GArray        *pending_positions;
+    guint          first_position;
     guint          position;
-    GSequence     *sequence;
-    GSequenceIter *iterator;
+    guint          serial;
+    GArray        *items;
+    gint           current;
     GHashTable    *download;
     guint64        download_current;
     guint64        download_total;
+    guint          progress_interval;
+    guint          progress_source;
+    gint64         progress_time;
+    struct _PlayQueue *replacement;
 } PlayQueue;
 
 typedef struct {
     GObjectClass   parent_class;
 
     // Signals
-    // An item has been added to the queue
-    void (*item_added) (PlayQueue *queue,
-                        PlayQueueItem *item,
-                        gpointer user_data);
-
-    // An error occured while reading a playlist at the given URI
+    // A number of items has been added to the queue starting at the
+    // given index
+    void (*items_added) (PlayQueue *queue,
+                         guint index,
+                         guint count,
+                         gpointer user_data);
+
+    // An error occured while reading a playlist or a directory at the
+    // given URI
     void (*playlist_error) (PlayQueue *queue,
                             const gchar *uri,
                             const gchar *error,
                             gpointer user_data);
 
-    // Playlist download has finished
+    // Playlist download or a directory scan has finished
     void (*playlist_finished) (PlayQueue *queue,
                                const gchar *uri,
                                gpointer user_data);
 
     // Playlist download progress has been updated
     // Use play_queue_get_download_current() to read the new value
+    // Updates arriving in quick succession are announced at most once per
+    // the interval set by play_queue_set_progress_interval()
     void (*playlist_progress_updated) (PlayQueue *queue,
                                        gpointer user_data);
+
+    // The content prepared by play_queue_prepare_replacement() has been
+    // read, use play_queue_replace() to swap it in
+    void (*replacement_ready) (PlayQueue *queue,
+                               gpointer user_data);
 } PlayQueueClass;
 
 extern GType play_queue_get_type (void);
@@ -72,25 +96,74 @@ extern PlayQueue *play_queue_new (void);
 // Returns TRUE on success
 extern gboolean play_queue_add (PlayQueue *queue, const gchar *file_or_uri);
 
+// Add an array of PlayQueueItems to the end of the queue
+// The items are added at once and announced by a single "items-added" signal
+// Returns TRUE on success
+extern gboolean play_queue_add_items (PlayQueue *queue, GPtrArray *items);
+
+// Add all the tracks of a media library index to the end of the queue
+// The index is expected to be loaded, the media files are not accessed
+// Returns TRUE on success
+extern gboolean play_queue_add_library (PlayQueue *queue,
+                                        PlayLibrary *library);
+
 // Return the count of items in the queue
 extern guint play_queue_get_count (PlayQueue *queue);
 
 // Return the number of items still waiting to be added to the queue
-// These are playlists being downloaded
+// These are playlists being downloaded and directories being scanned
 extern guint play_queue_get_count_pending (PlayQueue *queue);
 
+// Return TRUE if the item to be played first after sorting the queue by
+// position is already in the queue, although playlists and directories
+// with later positions may still be being read
+extern gboolean play_queue_first_is_ready (PlayQueue *queue);
+
 // Return the number of bytes already dowloaded from remote playlists
 extern guint64 play_queue_get_download_current (PlayQueue *queue);
 
 // Return the total number of bytes of remote playlists
 extern guint64 play_queue_get_download_total (PlayQueue *queue);
 
+// Set the minimum number of milliseconds between two emissions of the
+// "playlist-progress-updated" signal, 0 announces every update
+extern void play_queue_set_progress_interval (PlayQueue *queue,
+                                              guint interval);
+
+// Set the maximum number of remote playlists downloaded at the same time
+// in total and from a single host, use 0 for no limit
+extern void play_queue_set_max_downloads (PlayQueue *queue,
+                                          guint max_downloads,
+                                          guint max_downloads_host);
+
+// Set the number of seconds to wait for a connection to a server with
+// a remote playlist and for more data to arrive, use 0 to wait indefinitely
+extern void play_queue_set_download_timeouts (PlayQueue *queue,
+                                              guint timeout_connect,
+                                              guint timeout_read);
+
 // Return the queue item at the current position
 extern PlayQueueItem *play_queue_get_current (PlayQueue *queue);
 
+// Return the index of the current position
+// Returns -1 if the queue is empty
+extern gint play_queue_get_current_index (PlayQueue *queue);
+
+// Return the queue item at the given index or NULL if the index is
+// out of range
+extern PlayQueueItem *play_queue_get_nth (PlayQueue *queue, guint index);
+
 // Return the queue item at a random position
 extern PlayQueueItem *play_queue_get_random (PlayQueue *queue);
 
+// Return the queue item following the current position
+// Returns NULL if the queue is empty or already at the last item
+extern PlayQueueItem *play_queue_get_next (PlayQueue *queue);
+
+// Return the queue item at the first position
+// Returns NULL if the queue is empty
+extern PlayQueueItem *play_queue_get_first (PlayQueue *queue);
+
 // Set the current queue position to the first item of the queue
 // Returns TRUE on success
 extern gboolean play_queue_position_set_first (PlayQueue *queue);
@@ -99,6 +172,10 @@ extern gboolean play_queue_position_set_first (PlayQueue *queue);
 // Returns TRUE on success
 extern gboolean play_queue_position_set_last (PlayQueue *queue);
 
+// Set the current queue position to the item at the given index
+// Returns FALSE if the index is out of range
+extern gboolean play_queue_position_set_index (PlayQueue *queue, guint index);
+
 // Move the queue position one item forward in the queue
 // Returns TRUE on success
 // Returns FALSE if the queue is empty or already at the last item
@@ -142,6 +219,34 @@ extern gboolean play_queue_remove_last (PlayQueue *queue);
 // This function should be called after all items are added to the queue
 extern gboolean play_queue_sort_by_position (PlayQueue *queue);
 
+// Move the items from the given index to the end of the queue to their
+// places by position not before the first index, the items between the
+// first index and the given index are expected to be sorted already
+// The current position is kept at the item it was before the call
+extern gboolean play_queue_merge_by_position (PlayQueue *queue,
+                                              guint first,
+                                              guint index);
+
+// Move the items from the given index to the end of the queue to random
+// places not before the first index, the items between the first index
+// and the given index are expected to be in a random order already
+// The current position is kept at the item it was before the call
+extern gboolean play_queue_randomize_from (PlayQueue *queue,
+                                           guint first,
+                                           guint index);
+
+// Read a file, directory or URI in the background to replace the content
+// of the queue, the "replacement-ready" signal is emitted once it has
+// been read
+// Returns FALSE on error or if another replacement is still being read
+extern gboolean play_queue_prepare_replacement (PlayQueue *queue,
+                                                const gchar *file_or_uri);
+
+// Replace the content of the queue with the prepared replacement at once
+// and set the current position to its first item
+// Returns FALSE if no replacement is ready
+extern gboolean play_queue_replace (PlayQueue *queue);
+
 G_END_DECLS
 
 #endif // _PLAY_QUEUE_H_
@@ -0,0 +1,554 @@
+/**
+ * PLAY
+ * play-scanner.c: Scan directories for media files
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-queue-item.h"
+#include "play-scanner.h"
+
+G_DEFINE_TYPE (PlayScanner, play_scanner, G_TYPE_OBJECT);
+
+// Maximum number of items delivered by a single "queue-items" signal
+#define SCANNER_BATCH_SIZE 256
+
+// File attributes needed to walk through a directory
+#define SCANNER_ATTRIBUTES                  \
+    G_FILE_ATTRIBUTE_STANDARD_NAME ","      \
+    G_FILE_ATTRIBUTE_STANDARD_TYPE ","      \
+    G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+    G_FILE_ATTRIBUTE_ID_FILE
+
+typedef struct {
+    guint           id;
+    PlayScanner    *scanner;
+    GFile          *file;
+    GCancellable   *cancellable;
+    gpointer        custom;
+} PlayScannerData;
+
+// A batch of items passed from the scanning thread to the main loop
+typedef struct {
+    PlayScanner    *scanner;
+    guint           id;
+    GPtrArray      *items;
+} PlayScannerBatch;
+
+// A directory entry along with a key used to sort the entries by name
+typedef struct {
+    gchar          *key;
+    GFileInfo      *info;
+} PlayScannerEntry;
+
+// Suffixes of the files which are considered to be media files
+static const gchar *scanner_suffixes[] = {
+    "aac", "ac3", "aif", "aifc", "aiff", "ape", "au", "dts", "flac",
+    "it", "m4a", "m4b", "mid", "midi", "mka", "mod", "mp+", "mp2",
+    "mp3", "mpc", "mpga", "oga", "ogg", "opus", "ra", "s3m", "shn",
+    "spx", "tta", "wav", "webm", "wma", "wv", "xm",
+    NULL
+};
+
+// Scanning thread, walk through the directory tree
+static void scanner_thread (GTask *task,
+                            PlayScanner *scanner,
+                            PlayScannerData *data,
+                            GCancellable *cancellable);
+
+// Read a single directory, add its media files to the item array and
+// its subdirectories to the list of directories to be read
+static gboolean scanner_read_directory (GTask *task,
+                                        PlayScannerData *data,
+                                        GFile *directory,
+                                        GQueue *directories,
+                                        GHashTable *visited,
+                                        GPtrArray **items,
+                                        GError **error);
+
+// Pass the found items to the main loop and start a new item array
+static void scanner_flush (GTask *task,
+                           PlayScannerData *data,
+                           GPtrArray **items);
+
+// Deliver a batch of items in the main loop
+static gboolean scanner_batch (PlayScannerBatch *batch);
+
+// Function called in the main loop after the scanning thread has finished
+static void scanner_finished (PlayScanner *scanner,
+                              GAsyncResult *result,
+                              PlayScannerData *data);
+
+// Helper sorting function used to order the directory entries by name
+static gint scanner_compare_entries (gconstpointer a, gconstpointer b);
+
+// Internal function to cancel a scan when destroying the scanner
+static void scanner_cancel (gpointer key,
+                            PlayScannerData *data,
+                            gpointer user_data);
+
+// Free memory allocated for a temporary data structure
+static void scanner_free_data (PlayScannerData *data);
+
+// Signals
+enum {
+    ERROR,
+    FINISHED,
+    QUEUE_ITEMS,
+    LAST_SIGNAL
+};
+static guint signals[LAST_SIGNAL];
+
+// GObject/finalize
+static void play_scanner_finalize (GObject *object)
+{
+    PlayScanner *scanner = PLAY_SCANNER (object);
+
+    // Clean up
+    g_hash_table_destroy (scanner->data);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_scanner_parent_class)->finalize (object);
+}
+
+// GObject/class init
+static void play_scanner_class_init (PlayScannerClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->finalize = play_scanner_finalize;
+
+    signals[ERROR] =
+        g_signal_new ("error",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayScannerClass, error),
+                      NULL,
+                      NULL,
+                      play_marshal_VOID__UINT_STRING_POINTER,
+                      G_TYPE_NONE,
+                      3,
+                      G_TYPE_UINT,
+                      G_TYPE_STRING,
+                      G_TYPE_POINTER);
+    signals[FINISHED] =
+        g_signal_new ("finished",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayScannerClass, finished),
+                      NULL,
+                      NULL,
+                      g_cclosure_marshal_VOID__UINT_POINTER,
+                      G_TYPE_NONE,
+                      2,
+                      G_TYPE_UINT,
+                      G_TYPE_POINTER);
+    signals[QUEUE_ITEMS] =
+        g_signal_new ("queue-items",
+                      G_TYPE_FROM_CLASS (gobject_class),
+                      G_SIGNAL_RUN_LAST,
+                      G_STRUCT_OFFSET (PlayScannerClass, queue_items),
+                      NULL,
+                      NULL,
+                      play_marshal_VOID__UINT_POINTER_POINTER,
+                      G_TYPE_NONE,
+                      3,
+                      G_TYPE_UINT,
+                      G_TYPE_POINTER,
+                      G_TYPE_POINTER);
+}
+
+// GObject/init
+static void play_scanner_init (PlayScanner *scanner)
+{
+    scanner->data = g_hash_table_new_full (
+        g_direct_hash,
+        g_direct_equal,
+        NULL,
+        (GDestroyNotify) scanner_free_data);
+
+    // Initial ID
+    scanner->id_next = 1;
+}
+
+// Return TRUE if the given file name has a suffix of a supported media file
+gboolean play_scanner_file_is_media (const gchar *file)
+{
+    const gchar *suffix;
+    gint i;
+
+    g_return_val_if_fail (file, FALSE);
+
+    suffix = strrchr (file, '.');
+    if (!suffix || !*++suffix)
+        return FALSE;
+
+    for (i = 0; scanner_suffixes[i]; i++)
+        if (!g_ascii_strcasecmp (suffix, scanner_suffixes[i]))
+            return TRUE;
+
+    return FALSE;
+}
+
+// Create a new scanner object
+PlayScanner *play_scanner_new (void)
+{
+    return PLAY_SCANNER (g_object_new (PLAY_TYPE_SCANNER, NULL));
+}
+
+// Retrieve a GFile of the directory that is being scanned
+GFile *play_scanner_get_gfile (PlayScanner *scanner, guint id)
+{
+    PlayScannerData *data;
+
+    g_return_val_if_fail (PLAY_IS_SCANNER (scanner), NULL);
+    g_return_val_if_fail (id, NULL); // starts at 1
+
+    data = g_hash_table_lookup (
+        scanner->data,
+        GUINT_TO_POINTER (id));
+    if (!data)
+        return NULL;
+
+    return data->file;
+}
+
+// Scan a directory and its subdirectories for media files
+// Returns a scan ID or 0 on error
+// The directory is read in a separate thread and the found files are
+// delivered by the "queue-items" signal, either the "finished" or the
+// "error" signal will be emitted at the end
+guint play_scanner_scan_gfile (PlayScanner *scanner,
+                               GFile *file,
+                               gpointer custom)
+{
+    PlayScannerData *data;
+    GTask           *task;
+
+    g_return_val_if_fail (PLAY_IS_SCANNER (scanner), 0);
+    g_return_val_if_fail (G_IS_FILE (file), 0);
+
+    data = g_slice_new0 (PlayScannerData);
+    data->id = scanner->id_next++;
+    data->scanner = scanner;
+    data->file = g_object_ref (file);
+    data->cancellable = g_cancellable_new ();
+    data->custom = custom;
+
+    // Store the temporary data, it is deleted in the main loop after
+    // the thread has finished
+    g_hash_table_insert (
+        scanner->data,
+        GUINT_TO_POINTER (data->id),
+        data);
+
+    // The task keeps a reference to the scanner until it is finished
+    task = g_task_new (
+        scanner,
+        data->cancellable,
+        (GAsyncReadyCallback) scanner_finished,
+        data);
+    g_task_set_task_data (task, data, NULL);
+    g_task_run_in_thread (task, (GTaskThreadFunc) scanner_thread);
+    g_object_unref (task);
+
+    return data->id;
+}
+
+// Stop all the ongoing scans, no more signals will be emitted for them
+void play_scanner_cancel_all (PlayScanner *scanner)
+{
+    g_return_if_fail (PLAY_IS_SCANNER (scanner));
+
+    g_hash_table_foreach (
+        scanner->data,
+        (GHFunc) scanner_cancel,
+        NULL);
+}
+
+// Scanning thread, walk through the directory tree
+// The tree is walked depth-first with the entries of each directory
+// sorted by name, files before subdirectories, which gives the same
+// order as a sorted listing of the whole tree
+static void scanner_thread (GTask *task,
+                            PlayScanner *scanner,
+                            PlayScannerData *data,
+                            GCancellable *cancellable)
+{
+    GQueue     *directories;
+    GHashTable *visited;
+    GPtrArray  *items;
+    GFileInfo  *info;
+    GFile      *directory;
+    GError     *error = NULL;
+    gboolean    root = TRUE;
+
+    directories = g_queue_new ();
+    visited = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    items = g_ptr_array_new_with_free_func (g_object_unref);
+
+    // Remember the identifiers of the visited directories to avoid
+    // symbolic link loops
+    info = g_file_query_info (
+        data->file,
+        G_FILE_ATTRIBUTE_ID_FILE,
+        G_FILE_QUERY_INFO_NONE,
+        cancellable,
+        NULL);
+    if (info) {
+        const gchar *id = g_file_info_get_attribute_string (
+            info,
+            G_FILE_ATTRIBUTE_ID_FILE);
+
+        if (id)
+            g_hash_table_add (visited, g_strdup (id));
+
+        g_object_unref (info);
+    }
+
+    g_queue_push_head (directories, g_object_ref (data->file));
+    while ((directory = g_queue_pop_head (directories)) != NULL) {
+        gboolean ret;
+
+        ret = scanner_read_directory (
+            task,
+            data,
+            directory,
+            directories,
+            visited,
+            &items,
+            root ? &error : NULL);
+        g_object_unref (directory);
+
+        // Unreadable subdirectories are skipped, only the failure to read
+        // the given directory is reported
+        if ((!ret && root) || g_cancellable_is_cancelled (cancellable))
+            break;
+
+        root = FALSE;
+    }
+    g_queue_free_full (directories, g_object_unref);
+    g_hash_table_destroy (visited);
+    g_ptr_array_unref (items);
+
+    if (error)
+        g_task_return_error (task, error);
+    else
+        g_task_return_boolean (task, TRUE);
+}
+
+// Read a single directory, add its media files to the item array and
+// its subdirectories to the list of directories to be read
+static gboolean scanner_read_directory (GTask *task,
+                                        PlayScannerData *data,
+                                        GFile *directory,
+                                        GQueue *directories,
+                                        GHashTable *visited,
+                                        GPtrArray **items,
+                                        GError **error)
+{
+    GFileEnumerator  *enumerator;
+    GFileInfo        *info;
+    GArray           *entries;
+    GCancellable     *cancellable;
+    guint             subdirectories = 0;
+    guint             i;
+
+    cancellable = g_task_get_cancellable (task);
+    enumerator = g_file_enumerate_children (
+        directory,
+        SCANNER_ATTRIBUTES,
+        G_FILE_QUERY_INFO_NONE,
+        cancellable,
+        error);
+    if (!enumerator)
+        return FALSE;
+
+    entries = g_array_new (FALSE, FALSE, sizeof (PlayScannerEntry));
+
+    while ((info = g_file_enumerator_next_file (enumerator, cancellable, NULL))) {
+        PlayScannerEntry entry;
+        const gchar *name = g_file_info_get_name (info);
+
+        if (g_file_info_get_is_hidden (info) || name[0] == '.') {
+            g_object_unref (info);
+            continue;
+        }
+        if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+            const gchar *id = g_file_info_get_attribute_string (
+                info,
+                G_FILE_ATTRIBUTE_ID_FILE);
+
+            if (id) {
+                if (g_hash_table_contains (visited, id)) {
+                    g_object_unref (info);
+                    continue;
+                }
+                g_hash_table_add (visited, g_strdup (id));
+            }
+            subdirectories++;
+        } else if (!play_scanner_file_is_media (name)) {
+            g_object_unref (info);
+            continue;
+        }
+        entry.key  = g_utf8_collate_key_for_filename (name, -1);
+        entry.info = info;
+        g_array_append_val (entries, entry);
+    }
+    g_object_unref (enumerator);
+
+    g_array_sort (entries, scanner_compare_entries);
+
+    // Add the files in the sorted order and push the subdirectories
+    // in the reverse order so that the first one is read next
+    for (i = 0; i < entries->len; i++) {
+        PlayScannerEntry *entry = &g_array_index (entries, PlayScannerEntry, i);
+
+        if (g_file_info_get_file_type (entry->info) != G_FILE_TYPE_DIRECTORY) {
+            PlayQueueItem *item = play_queue_item_new ();
+            GFile *file = g_file_get_child (
+                directory,
+                g_file_info_get_name (entry->info));
+
+            play_queue_item_set_gfile (item, file);
+            g_ptr_array_add (*items, item);
+            g_object_unref (file);
+
+            if ((*items)->len >= SCANNER_BATCH_SIZE)
+                scanner_flush (task, data, items);
+        }
+    }
+    for (i = entries->len; i > 0 && subdirectories; i--) {
+        PlayScannerEntry *entry = &g_array_index (entries, PlayScannerEntry, i - 1);
+
+        if (g_file_info_get_file_type (entry->info) == G_FILE_TYPE_DIRECTORY) {
+            g_queue_push_head (
+                directories,
+                g_file_get_child (
+                    directory,
+                    g_file_info_get_name (entry->info)));
+            subdirectories--;
+        }
+    }
+    for (i = 0; i < entries->len; i++) {
+        PlayScannerEntry *entry = &g_array_index (entries, PlayScannerEntry, i);
+
+        g_free (entry->key);
+        g_object_unref (entry->info);
+    }
+    g_array_free (entries, TRUE);
+
+    // Deliver the files of each directory right away, this lets the
+    // playback start before the whole tree is read
+    if ((*items)->len)
+        scanner_flush (task, data, items);
+
+    return TRUE;
+}
+
+// Pass the found items to the main loop and start a new item array
+static void scanner_flush (GTask *task,
+                           PlayScannerData *data,
+                           GPtrArray **items)
+{
+    PlayScannerBatch *batch;
+    GSource          *source;
+
+    batch = g_slice_new0 (PlayScannerBatch);
+    batch->scanner = g_object_ref (data->scanner);
+    batch->id = data->id;
+    batch->items = *items;
+
+    // The batches are dispatched in the order they were added in and
+    // before the task result which is added last
+    // An idle source is used as invoking the function directly would run
+    // it in this thread when no other thread owns the main context, which
+    // is the case before the main loop is started
+    source = g_idle_source_new ();
+    g_source_set_priority (source, G_PRIORITY_DEFAULT);
+    g_source_set_callback (source, (GSourceFunc) scanner_batch, batch, NULL);
+    g_source_attach (source, g_task_get_context (task));
+    g_source_unref (source);
+
+    *items = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+// Deliver a batch of items in the main loop
+static gboolean scanner_batch (PlayScannerBatch *batch)
+{
+    PlayScannerData *data;
+
+    data = g_hash_table_lookup (
+        batch->scanner->data,
+        GUINT_TO_POINTER (batch->id));
+
+    if (data && !g_cancellable_is_cancelled (data->cancellable))
+        g_signal_emit (
+            batch->scanner,
+            signals[QUEUE_ITEMS],
+            0,
+            data->id,
+            batch->items,
+            data->custom);
+
+    g_ptr_array_unref (batch->items);
+    g_object_unref (batch->scanner);
+    g_slice_free (PlayScannerBatch, batch);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Function called in the main loop after the scanning thread has finished
+static void scanner_finished (PlayScanner *scanner,
+                              GAsyncResult *result,
+                              PlayScannerData *data)
+{
+    GError *error = NULL;
+
+    if (!g_task_propagate_boolean (G_TASK (result), &error)) {
+        if (!g_cancellable_is_cancelled (data->cancellable))
+            g_signal_emit (
+                scanner,
+                signals[ERROR],
+                0,
+                data->id,
+                error->message,
+                data->custom);
+        g_error_free (error);
+    } else if (!g_cancellable_is_cancelled (data->cancellable)) {
+        g_signal_emit (
+            scanner,
+            signals[FINISHED],
+            0,
+            data->id,
+            data->custom);
+    }
+    // Delete data of the current scan
+    g_hash_table_remove (scanner->data, GUINT_TO_POINTER (data->id));
+}
+
+// Helper sorting function used to order the directory entries by name
+static gint scanner_compare_entries (gconstpointer a, gconstpointer b)
+{
+    const PlayScannerEntry *ea = a;
+    const PlayScannerEntry *eb = b;
+
+    return strcmp (ea->key, eb->key);
+}
+
+// Internal function to cancel a scan when destroying the scanner
+static void scanner_cancel (gpointer key,
+                            PlayScannerData *data,
+                            gpointer user_data)
+{
+    g_cancellable_cancel (data->cancellable);
+}
+
+// Free memory allocated for a temporary data structure
+static void scanner_free_data (PlayScannerData *data)
+{
+    g_object_unref (data->file);
+    g_object_unref (data->cancellable);
+
+    g_slice_free (PlayScannerData, data);
+}
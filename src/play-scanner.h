@@ -0,0 +1,86 @@
+/**
+ * PLAY
+ * play-scanner.h: Scan directories for media files
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#ifndef _PLAY_SCANNER_H_
+#define _PLAY_SCANNER_H_
+
+#include "play-common.h"
+#include "play-queue-item.h"
+
+G_BEGIN_DECLS
+
+#define PLAY_TYPE_SCANNER                     \
+    (play_scanner_get_type())
+#define PLAY_SCANNER(o)                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((o), PLAY_TYPE_SCANNER, PlayScanner))
+#define PLAY_SCANNER_CLASS(k)                 \
+    (G_TYPE_CHECK_CLASS_CAST((k), PLAY_TYPE_SCANNER, PlayScannerClass))
+#define PLAY_IS_SCANNER(o)                    \
+    (G_TYPE_CHECK_INSTANCE_TYPE((o), PLAY_TYPE_SCANNER))
+#define PLAY_IS_SCANNER_CLASS(k)              \
+    (G_TYPE_CHECK_CLASS_TYPE((k), PLAY_TYPE_SCANNER))
+#define PLAY_SCANNER_GET_CLASS(o)             \
+    (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_SCANNER, PlayScannerClass))
+
+typedef struct {
+    GObject         parent_instance;
+    guint           id_next;
+    GHashTable     *data;
+} PlayScanner;
+
+typedef struct {
+    GObjectClass    parent_class;
+
+    // Signals
+    // The directory could not be read
+    // After this signal the scan is discarded
+    void (*error) (PlayScanner *scanner,
+                   guint id,
+                   const gchar *error,
+                   gpointer custom);
+
+    // The whole directory tree has been scanned
+    // After this signal the scan is discarded
+    void (*finished) (PlayScanner *scanner,
+                      guint id,
+                      gpointer custom);
+
+    // A batch of media files has been found, the batches follow the order
+    // of the files in the directory tree
+    // The GPtrArray of PlayQueueItems is only valid during the signal
+    // emission, use g_object_ref() to keep the items
+    void (*queue_items) (PlayScanner *scanner,
+                         guint id,
+                         GPtrArray *items,
+                         gpointer custom);
+} PlayScannerClass;
+
+extern GType play_scanner_get_type (void);
+
+// Global function
+// Return TRUE if the given file name has a suffix of a supported media file
+extern gboolean play_scanner_file_is_media (const gchar *file);
+
+// Create a new scanner object
+extern PlayScanner *play_scanner_new (void);
+
+// Retrieve a GFile of the directory that is being scanned
+extern GFile *play_scanner_get_gfile (PlayScanner *scanner, guint id);
+
+// Scan a directory and its subdirectories for media files
+// Returns a scan ID or 0 on error
+// The directory is read in a separate thread and the found files are
+// delivered by the "queue-items" signal, either the "finished" or the
+// "error" signal will be emitted at the end
+extern guint play_scanner_scan_gfile (PlayScanner *scanner,
+                                      GFile *file,
+                                      gpointer custom);
+
+// Stop all the ongoing scans, no more signals will be emitted for them
+extern void play_scanner_cancel_all (PlayScanner *scanner);
+
+G_END_DECLS
+
+#endif // _PLAY_SCANNER_H_
@@ -95,6 +95,25 @@ PlayQueueItem *play_simple_queue_get_current (PlaySimpleQueue *queue)
     return g_sequence_get (queue->iterator);
 }
 
+// Return the queue item following the current position
+// Returns NULL if the queue is empty or already at the last item
+PlayQueueItem *play_simple_queue_get_next (PlaySimpleQueue *queue)
+{
+    GSequenceIter *iter;
+
+    g_return_val_if_fail (PLAY_IS_SIMPLE_QUEUE (queue), NULL);
+
+    // Empty queue
+    if (!queue->iterator)
+        return NULL;
+
+    iter = g_sequence_iter_next (queue->iterator);
+    if (g_sequence_iter_is_end (iter))
+        return NULL;
+
+    return g_sequence_get (iter);
+}
+
 // Set the current queue position to the first item of the queue
 // Returns TRUE on success
 gboolean play_simple_queue_position_set_first (PlaySimpleQueue *queue)
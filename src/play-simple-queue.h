@@ -57,6 +57,10 @@ extern guint play_simple_queue_get_count (PlaySimpleQueue *queue);
 // Return the queue item at the current position
 extern PlayQueueItem *play_simple_queue_get_current (PlaySimpleQueue *queue);
 
+// Return the queue item following the current position
+// Returns NULL if the queue is empty or already at the last item
+extern PlayQueueItem *play_simple_queue_get_next (PlaySimpleQueue *queue);
+
 // Set the current queue position to the first item of the queue
 // Returns TRUE on success
 extern gboolean play_simple_queue_position_set_first (PlaySimpleQueue *queue);
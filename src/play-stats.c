@@ -0,0 +1,426 @@
+/**
+ * PLAY
+ * play-stats.c: Runtime statistics
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#include "play-common.h"
+#include "play-stats.h"
+
+G_DEFINE_TYPE (PlayStats, play_stats, G_TYPE_OBJECT);
+
+// Values added to a histogram
+typedef struct {
+    guint64 count;
+    gint64  sum;
+    gint64  min;
+    gint64  max;
+    guint64 buckets[PLAY_STATS_BUCKETS];
+} PlayStatsHistogram;
+
+// Statistics object updated by the PLAY_STATS_* macros
+static PlayStats *stats_default;
+
+// Poll function of the default main context replaced by the one
+// counting the wakeups
+static GPollFunc stats_poll_func;
+
+// Poll function counting the wakeups of the default main context
+static gint stats_poll (GPollFD *fds, guint nfds, gint timeout);
+
+// Return the names of a hash table in the alphabetical order
+// Free the returned list with g_list_free()
+static GList *stats_get_sorted_keys (GHashTable *table);
+
+// Append a JSON object with the values of a hash table holding gint64
+// values to a string
+static void stats_append_values (GString *json,
+                                 const gchar *name,
+                                 GHashTable *table,
+                                 gboolean is_unsigned);
+
+// Append a JSON object with the histograms to a string
+static void stats_append_histograms (GString *json, GHashTable *table);
+
+// Return the resident memory size of the process in bytes or -1 if it
+// is not known
+static gint64 stats_get_rss (void);
+
+// Free memory allocated for a histogram
+static void stats_free_histogram (PlayStatsHistogram *histogram);
+
+// GObject/finalize
+static void play_stats_finalize (GObject *object)
+{
+    PlayStats *stats = PLAY_STATS (object);
+
+    // Clean up
+    g_hash_table_destroy (stats->counters);
+    g_hash_table_destroy (stats->gauges);
+    g_hash_table_destroy (stats->histograms);
+
+    // Chain up to the parent class
+    G_OBJECT_CLASS (play_stats_parent_class)->finalize (object);
+}
+
+// GObject/class init
+static void play_stats_class_init (PlayStatsClass *klass)
+{
+    GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+    gobject_class->finalize = play_stats_finalize;
+}
+
+// GObject/init
+static void play_stats_init (PlayStats *stats)
+{
+    stats->time_created = g_get_monotonic_time ();
+
+    // The names are expected to be static strings
+    stats->counters = g_hash_table_new_full (
+        g_str_hash,
+        g_str_equal,
+        NULL,
+        g_free);
+    stats->gauges = g_hash_table_new_full (
+        g_str_hash,
+        g_str_equal,
+        NULL,
+        g_free);
+    stats->histograms = g_hash_table_new_full (
+        g_str_hash,
+        g_str_equal,
+        NULL,
+        (GDestroyNotify) stats_free_histogram);
+}
+
+// Create a new statistics object
+PlayStats *play_stats_new (void)
+{
+    return PLAY_STATS (g_object_new (PLAY_TYPE_STATS, NULL));
+}
+
+// Return the statistics object updated by the PLAY_STATS_* macros or NULL
+// if statistics are not being collected
+PlayStats *play_stats_get_default (void)
+{
+    return stats_default;
+}
+
+// Set the statistics object updated by the PLAY_STATS_* macros, the object
+// is referenced, use NULL to stop collecting statistics
+void play_stats_set_default (PlayStats *stats)
+{
+    g_return_if_fail (stats == NULL || PLAY_IS_STATS (stats));
+
+    if (stats)
+        g_object_ref (stats);
+    if (stats_default)
+        g_object_unref (stats_default);
+
+    stats_default = stats;
+}
+
+// Increase a counter by the given value
+// Does nothing if the object is NULL
+void play_stats_count (PlayStats *stats, const gchar *name, guint64 value)
+{
+    guint64 *counter;
+
+    if (!stats)
+        return;
+
+    g_return_if_fail (PLAY_IS_STATS (stats));
+    g_return_if_fail (name != NULL);
+
+    counter = g_hash_table_lookup (stats->counters, name);
+    if (!counter) {
+        counter = g_new0 (guint64, 1);
+        g_hash_table_insert (stats->counters, (gpointer) name, counter);
+    }
+    *counter += value;
+}
+
+// Set a value which replaces the previous one
+// Does nothing if the object is NULL
+void play_stats_set (PlayStats *stats, const gchar *name, gint64 value)
+{
+    gint64 *gauge;
+
+    if (!stats)
+        return;
+
+    g_return_if_fail (PLAY_IS_STATS (stats));
+    g_return_if_fail (name != NULL);
+
+    gauge = g_hash_table_lookup (stats->gauges, name);
+    if (!gauge) {
+        gauge = g_new0 (gint64, 1);
+        g_hash_table_insert (stats->gauges, (gpointer) name, gauge);
+    }
+    *gauge = value;
+}
+
+// Add a value to a histogram
+// Does nothing if the object is NULL
+void play_stats_record (PlayStats *stats, const gchar *name, gint64 value)
+{
+    PlayStatsHistogram *histogram;
+    guint bucket;
+
+    if (!stats)
+        return;
+
+    g_return_if_fail (PLAY_IS_STATS (stats));
+    g_return_if_fail (name != NULL);
+
+    histogram = g_hash_table_lookup (stats->histograms, name);
+    if (!histogram) {
+        histogram = g_slice_new0 (PlayStatsHistogram);
+        histogram->min = G_MAXINT64;
+        histogram->max = G_MININT64;
+        g_hash_table_insert (stats->histograms, (gpointer) name, histogram);
+    }
+    histogram->count++;
+    histogram->sum += value;
+    histogram->min  = MIN (histogram->min, value);
+    histogram->max  = MAX (histogram->max, value);
+
+    // Negative values are counted in the first bucket
+    bucket = value > 0 ? g_bit_storage ((guint64) value) : 0;
+    histogram->buckets[MIN (bucket, PLAY_STATS_BUCKETS - 1)]++;
+}
+
+// Count the wakeups of the default main context in the "mainloop.wakeups"
+// counter of the default statistics object
+void play_stats_watch_main_loop (void)
+{
+    GMainContext *context = g_main_context_default ();
+
+    if (stats_poll_func)
+        return;
+
+    stats_poll_func = g_main_context_get_poll_func (context);
+    g_main_context_set_poll_func (context, stats_poll);
+}
+
+// Return all the statistics as a single-line JSON object
+// Free the returned value with g_free()
+gchar *play_stats_to_json (PlayStats *stats)
+{
+    GString *json;
+    gint64   rss;
+
+    g_return_val_if_fail (PLAY_IS_STATS (stats), NULL);
+
+    // The current memory use is sampled when writing
+    rss = stats_get_rss ();
+    if (rss >= 0)
+        play_stats_set (stats, "memory.rss_bytes", rss);
+
+    json = g_string_sized_new (1024);
+    g_string_append_printf (
+        json,
+        "{\"time\":%" G_GINT64_FORMAT ",\"uptime_ms\":%" G_GINT64_FORMAT,
+        g_get_real_time () / G_USEC_PER_SEC,
+        (g_get_monotonic_time () - stats->time_created) / 1000);
+
+    stats_append_values (json, "counters", stats->counters, TRUE);
+    stats_append_values (json, "values", stats->gauges, FALSE);
+    stats_append_histograms (json, stats->histograms);
+
+    g_string_append_c (json, '}');
+    return g_string_free (json, FALSE);
+}
+
+// Replace the contents of a file with the statistics
+// Returns TRUE on success
+gboolean play_stats_write_file (PlayStats *stats,
+                                const gchar *path,
+                                GError **error)
+{
+    gchar   *json;
+    gboolean ret;
+
+    g_return_val_if_fail (PLAY_IS_STATS (stats), FALSE);
+    g_return_val_if_fail (path != NULL, FALSE);
+
+    // The file is replaced atomically, so a reader never sees a partially
+    // written file
+    json = play_stats_to_json (stats);
+    ret  = g_file_set_contents (path, json, -1, error);
+
+    g_free (json);
+    return ret;
+}
+
+// Write the statistics as a line to a file descriptor
+// Returns TRUE on success
+gboolean play_stats_write_fd (PlayStats *stats, gint fd, GError **error)
+{
+    gchar *json;
+    gchar *line;
+    gsize  length;
+    gsize  written = 0;
+
+    g_return_val_if_fail (PLAY_IS_STATS (stats), FALSE);
+    g_return_val_if_fail (fd >= 0, FALSE);
+
+    json = play_stats_to_json (stats);
+    line = g_strconcat (json, "\n", NULL);
+    length = strlen (line);
+    g_free (json);
+
+    while (written < length) {
+        gssize ret = write (fd, line + written, length - written);
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+
+            g_set_error (
+                error,
+                G_FILE_ERROR,
+                g_file_error_from_errno (errno),
+                "Could not write statistics: %s",
+                g_strerror (errno));
+            g_free (line);
+            return FALSE;
+        }
+        written += ret;
+    }
+    g_free (line);
+    return TRUE;
+}
+
+// Poll function counting the wakeups of the default main context
+static gint stats_poll (GPollFD *fds, guint nfds, gint timeout)
+{
+    gint ret = stats_poll_func (fds, nfds, timeout);
+
+    PLAY_STATS_COUNT ("mainloop.wakeups", 1);
+    return ret;
+}
+
+// Return the names of a hash table in the alphabetical order
+// Free the returned list with g_list_free()
+static GList *stats_get_sorted_keys (GHashTable *table)
+{
+    return g_list_sort (
+        g_hash_table_get_keys (table),
+        (GCompareFunc) strcmp);
+}
+
+// Append a JSON object with the values of a hash table holding gint64
+// values to a string
+static void stats_append_values (GString *json,
+                                 const gchar *name,
+                                 GHashTable *table,
+                                 gboolean is_unsigned)
+{
+    GList *keys;
+    GList *l;
+
+    g_string_append_printf (json, ",\"%s\":{", name);
+
+    keys = stats_get_sorted_keys (table);
+    for (l = keys; l; l = l->next) {
+        gpointer value = g_hash_table_lookup (table, l->data);
+
+        if (l != keys)
+            g_string_append_c (json, ',');
+
+        if (is_unsigned)
+            g_string_append_printf (
+                json,
+                "\"%s\":%" G_GUINT64_FORMAT,
+                (const gchar *) l->data,
+                *(guint64 *) value);
+        else
+            g_string_append_printf (
+                json,
+                "\"%s\":%" G_GINT64_FORMAT,
+                (const gchar *) l->data,
+                *(gint64 *) value);
+    }
+    g_list_free (keys);
+
+    g_string_append_c (json, '}');
+}
+
+// Append a JSON object with the histograms to a string
+static void stats_append_histograms (GString *json, GHashTable *table)
+{
+    GList *keys;
+    GList *l;
+
+    g_string_append (json, ",\"histograms\":{");
+
+    keys = stats_get_sorted_keys (table);
+    for (l = keys; l; l = l->next) {
+        PlayStatsHistogram *histogram = g_hash_table_lookup (table, l->data);
+        gboolean first = TRUE;
+        guint    i;
+
+        if (l != keys)
+            g_string_append_c (json, ',');
+
+        g_string_append_printf (
+            json,
+            "\"%s\":{\"count\":%" G_GUINT64_FORMAT
+            ",\"sum\":%" G_GINT64_FORMAT
+            ",\"min\":%" G_GINT64_FORMAT
+            ",\"max\":%" G_GINT64_FORMAT
+            ",\"buckets\":[",
+            (const gchar *) l->data,
+            histogram->count,
+            histogram->sum,
+            histogram->min,
+            histogram->max);
+
+        // Only the used buckets are listed as pairs of the exclusive upper
+        // bound and the number of values
+        for (i = 0; i < PLAY_STATS_BUCKETS; i++) {
+            if (!histogram->buckets[i])
+                continue;
+
+            g_string_append_printf (
+                json,
+                "%s[%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT "]",
+                first ? "" : ",",
+                (i < PLAY_STATS_BUCKETS - 1) ? G_GUINT64_CONSTANT (1) << i : G_MAXUINT64,
+                histogram->buckets[i]);
+            first = FALSE;
+        }
+        g_string_append (json, "]}");
+    }
+    g_list_free (keys);
+
+    g_string_append_c (json, '}');
+}
+
+// Return the resident memory size of the process in bytes or -1 if it
+// is not known
+static gint64 stats_get_rss (void)
+{
+    gchar  *contents;
+    gchar **fields;
+    gint64  rss = -1;
+
+    if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+        return -1;
+
+    // The second field is the number of resident pages
+    fields = g_strsplit (contents, " ", 3);
+    if (fields[0] && fields[1])
+        rss = g_ascii_strtoll (fields[1], NULL, 10) * sysconf (_SC_PAGESIZE);
+
+    g_strfreev (fields);
+    g_free (contents);
+    return rss;
+}
+
+// Free memory allocated for a histogram
+static void stats_free_histogram (PlayStatsHistogram *histogram)
+{
+    g_slice_free (PlayStatsHistogram, histogram);
+}
@@ -0,0 +1,103 @@
+/**
+ * PLAY
+ * play-stats.h: Runtime statistics
+ * Copyright (C) 2011-2014 Michal Ratajsky <michal.ratajsky@gmail.com>
+ */
+#ifndef _PLAY_STATS_H_
+#define _PLAY_STATS_H_
+
+#include "play-common.h"
+
+G_BEGIN_DECLS
+
+// Number of histogram buckets, the bucket N holds values lower than 2^N
+#define PLAY_STATS_BUCKETS 64
+
+// Shortcuts updating the default statistics object, they do nothing
+// unless statistics are being collected
+#define PLAY_STATS_COUNT(name, value) \
+    play_stats_count (play_stats_get_default (), (name), (value))
+#define PLAY_STATS_SET(name, value) \
+    play_stats_set (play_stats_get_default (), (name), (value))
+#define PLAY_STATS_RECORD(name, value) \
+    play_stats_record (play_stats_get_default (), (name), (value))
+
+#define PLAY_TYPE_STATS                     \
+    (play_stats_get_type())
+#define PLAY_STATS(o)                       \
+    (G_TYPE_CHECK_INSTANCE_CAST((o), PLAY_TYPE_STATS, PlayStats))
+#define PLAY_STATS_CLASS(k)                 \
+    (G_TYPE_CHECK_CLASS_CAST((k), PLAY_TYPE_STATS, PlayStatsClass))
+#define PLAY_IS_STATS(o)                    \
+    (G_TYPE_CHECK_INSTANCE_TYPE((o), PLAY_TYPE_STATS))
+#define PLAY_IS_STATS_CLASS(k)              \
+    (G_TYPE_CHECK_CLASS_TYPE((k), PLAY_TYPE_STATS))
+#define PLAY_STATS_GET_CLASS(o)             \
+    (G_TYPE_INSTANCE_GET_CLASS((o), PLAY_TYPE_STATS, PlayStatsClass))
+
+typedef struct {
+    GObject        parent_instance;
+    gint64         time_created;
+    GHashTable    *counters;
+    GHashTable    *gauges;
+    GHashTable    *histograms;
+} PlayStats;
+
+typedef struct {
+    GObjectClass   parent_class;
+} PlayStatsClass;
+
+extern GType play_stats_get_type (void);
+
+// Create a new statistics object
+extern PlayStats *play_stats_new (void);
+
+// Return the statistics object updated by the PLAY_STATS_* macros or NULL
+// if statistics are not being collected
+extern PlayStats *play_stats_get_default (void);
+
+// Set the statistics object updated by the PLAY_STATS_* macros, the object
+// is referenced, use NULL to stop collecting statistics
+extern void play_stats_set_default (PlayStats *stats);
+
+// Increase a counter by the given value
+// Does nothing if the object is NULL
+extern void play_stats_count (PlayStats *stats,
+                              const gchar *name,
+                              guint64 value);
+
+// Set a value which replaces the previous one
+// Does nothing if the object is NULL
+extern void play_stats_set (PlayStats *stats,
+                            const gchar *name,
+                            gint64 value);
+
+// Add a value to a histogram
+// Does nothing if the object is NULL
+extern void play_stats_record (PlayStats *stats,
+                               const gchar *name,
+                               gint64 value);
+
+// Count the wakeups of the default main context in the "mainloop.wakeups"
+// counter of the default statistics object
+extern void play_stats_watch_main_loop (void);
+
+// Return all the statistics as a single-line JSON object
+// Free the returned value with g_free()
+extern gchar *play_stats_to_json (PlayStats *stats);
+
+// Replace the contents of a file with the statistics
+// Returns TRUE on success
+extern gboolean play_stats_write_file (PlayStats *stats,
+                                       const gchar *path,
+                                       GError **error);
+
+// Write the statistics as a line to a file descriptor
+// Returns TRUE on success
+extern gboolean play_stats_write_fd (PlayStats *stats,
+                                     gint fd,
+                                     GError **error);
+
+G_END_DECLS
+
+#endif // _PLAY_STATS_H_
@@ -8,16 +8,35 @@
 
 G_DEFINE_TYPE (PlayTerminal, play_terminal, G_TYPE_OBJECT);
 
+// Number of milliseconds to wait for the rest of an escape sequence
+#define TERMINAL_ESCAPE_TIMEOUT 25
+
 // Read the current width of the terminal screen and return it
 static guint terminal_read_width (void);
 
-// Read terminal input and emit input-read signal when a known character or
-// character sequence is read
-static gboolean terminal_input_read (PlayTerminal *terminal);
-
-// Non-blocking read of a single character from STDIN
-// Returns the character or 0 on error or when there is no input to be read
-static guchar terminal_input_read_character (void);
+// Read terminal input and emit input-read signal for each known character or
+// character sequence
+// All the available input is read at once and an incomplete escape sequence
+// is kept in the buffer until the rest of it arrives
+static gboolean terminal_input_read (GIOChannel *channel,
+                                     GIOCondition condition,
+                                     PlayTerminal *terminal);
+
+// Timeout callback, process the incomplete escape sequence left in the buffer
+static gboolean terminal_input_escape (PlayTerminal *terminal);
+
+// Emit the input-read signal for each key in the input buffer
+// Unless the flush argument is TRUE, an incomplete escape sequence at the
+// end of the buffer is kept for later
+static void terminal_input_process (PlayTerminal *terminal, gboolean flush);
+
+// Parse a single character or character sequence at the beginning of the
+// given buffer and store the key or PLAY_TERMINAL_KEY_NONE if the input is
+// not known
+// Returns the number of bytes used or 0 if the sequence is incomplete
+static guint terminal_input_parse (const guchar *chars,
+                                   guint length,
+                                   gint *key);
 
 // Signals
 enum {
@@ -36,6 +55,8 @@ static void play_terminal_finalize (GObject *object)
         play_terminal_stop_listening (terminal);
     if (terminal->tty_old)
         g_free (terminal->tty_old);
+    if (terminal->channel)
+        g_io_channel_unref (terminal->channel);
 
     // Chain up to the parent class
     G_OBJECT_CLASS (play_terminal_parent_class)->finalize (object);
@@ -110,9 +131,14 @@ gboolean play_terminal_listen (PlayTerminal *terminal)
         terminal->initialized = TRUE;
     }
     if (!terminal->listener) {
-        terminal->listener = g_timeout_add (
-            50,
-            (GSourceFunc) terminal_input_read,
+        // Wake up only when there is input to be read
+        if (!terminal->channel)
+            terminal->channel = g_io_channel_unix_new (STDIN_FILENO);
+
+        terminal->listener = g_io_add_watch (
+            terminal->channel,
+            G_IO_IN | G_IO_HUP | G_IO_ERR,
+            (GIOFunc) terminal_input_read,
             terminal);
     }
     return TRUE;
@@ -131,6 +157,11 @@ gboolean play_terminal_stop_listening (PlayTerminal *terminal)
         g_source_remove (terminal->listener);
         terminal->listener = 0;
     }
+    if (terminal->escape) {
+        g_source_remove (terminal->escape);
+        terminal->escape = 0;
+    }
+    terminal->length = 0;
     return TRUE;
 }
 
@@ -172,134 +203,206 @@ static guint terminal_read_width (void)
     return 80;
 }
 
-// Read terminal input and emit input-read signal when a known character or
-// character sequence is read
-static gboolean terminal_input_read (PlayTerminal *terminal)
+// Read terminal input and emit input-read signal for each known character or
+// character sequence
+// All the available input is read at once and an incomplete escape sequence
+// is kept in the buffer until the rest of it arrives
+static gboolean terminal_input_read (GIOChannel *channel,
+                                     GIOCondition condition,
+                                     PlayTerminal *terminal)
 {
-    guchar          chars[16];
-    guint           length = 0;
-    PlayTerminalKey result = PLAY_TERMINAL_KEY_NONE;
+    gssize size;
 
-    while (1) {
-        guchar key = terminal_input_read_character ();
-        if (!key)
-            break;
-        if (!length && key >= 0x20 && key < 0x80) {
-            // A regular character
+    if (terminal->escape) {
+        g_source_remove (terminal->escape);
+        terminal->escape = 0;
+    }
+    size = read (
+        STDIN_FILENO,
+        terminal->buffer + terminal->length,
+        sizeof (terminal->buffer) - terminal->length);
+    if (size < 0 && (errno == EINTR || errno == EAGAIN))
+        return TRUE;
+    if (size <= 0) {
+        // The input has been closed, there is nothing more to listen to
+        terminal->listener = 0;
+        return FALSE;
+    }
+    terminal->length += (guint) size;
+
+    terminal_input_process (terminal, FALSE);
+
+    // A lone escape character is either the escape key or the beginning of
+    // a sequence whose rest has not arrived yet, wait shortly to find out
+    if (terminal->length)
+        terminal->escape = g_timeout_add (
+            TERMINAL_ESCAPE_TIMEOUT,
+            (GSourceFunc) terminal_input_escape,
+            terminal);
+    return TRUE;
+}
+
+// Timeout callback, process the incomplete escape sequence left in the buffer
+static gboolean terminal_input_escape (PlayTerminal *terminal)
+{
+    terminal->escape = 0;
+
+    terminal_input_process (terminal, TRUE);
+
+    // Return FALSE to stop the function from being called again
+    return FALSE;
+}
+
+// Emit the input-read signal for each key in the input buffer
+// Unless the flush argument is TRUE, an incomplete escape sequence at the
+// end of the buffer is kept for later
+static void terminal_input_process (PlayTerminal *terminal, gboolean flush)
+{
+    guint offset = 0;
+
+    while (offset < terminal->length) {
+        gint  key;
+        guint size;
+
+        size = terminal_input_parse (
+            terminal->buffer + offset,
+            terminal->length - offset,
+            &key);
+        if (!size) {
+            if (!flush) {
+                // A full buffer cannot be completed anymore
+                if (offset || terminal->length < sizeof (terminal->buffer))
+                    break;
+                size = terminal->length;
+            } else if (terminal->length - offset == 1) {
+                // Nothing has followed the escape character, it must have
+                // been the escape key
+                key  = PLAY_TERMINAL_KEY_ESC;
+                size = 1;
+            } else {
+                // Discard the rest of an unfinished sequence
+                size = terminal->length - offset;
+            }
+        }
+        offset += size;
+
+        if (key != PLAY_TERMINAL_KEY_NONE)
             g_signal_emit (
                 G_OBJECT (terminal),
                 signals[INPUT_READ],
                 0,
                 key);
-            return TRUE;
-        }
-        if (length >= sizeof (chars))
-            length = 0;
 
-        chars[length++] = key;
+        // Stop processing if a signal handler has stopped listening
+        if (!terminal->listener) {
+            terminal->length = 0;
+            return;
+        }
     }
-    if (!length)
-        return TRUE;
+    terminal->length -= offset;
+    if (terminal->length)
+        memmove (
+            terminal->buffer,
+            terminal->buffer + offset,
+            terminal->length);
+}
 
-    // Check the read character sequence
+// Parse a single character or character sequence at the beginning of the
+// given buffer and store the key or PLAY_TERMINAL_KEY_NONE if the input is
+// not known
+// Returns the number of bytes used or 0 if the sequence is incomplete
+static guint terminal_input_parse (const guchar *chars,
+                                   guint length,
+                                   gint *key)
+{
+    guint i;
+
+    *key = PLAY_TERMINAL_KEY_NONE;
+
+    if (chars[0] >= 0x20 && chars[0] < 0x7f) {
+        // A regular character
+        *key = chars[0];
+        return 1;
+    }
     switch (chars[0]) {
         case 3:
-            result = PLAY_TERMINAL_KEY_CTRL_C;
-            break;
+            *key = PLAY_TERMINAL_KEY_CTRL_C;
+            return 1;
         case 9:
-            result = PLAY_TERMINAL_KEY_TAB;
-            break;
+            *key = PLAY_TERMINAL_KEY_TAB;
+            return 1;
         case 13:
-            result = PLAY_TERMINAL_KEY_ENTER;
-            break;
+            *key = PLAY_TERMINAL_KEY_ENTER;
+            return 1;
+        case 127:
+            *key = PLAY_TERMINAL_KEY_BACKSPACE;
+            return 1;
         case 27:
             // Escape sequence
-            if (length == 1) {
-                result = PLAY_TERMINAL_KEY_ESC;
-                break;
-            }
-            if (length == 2)
-                break;
-            switch (chars[1]) {
-                case 79:
-                    switch (chars[2]) {
-                        case 70:
-                            result = PLAY_TERMINAL_KEY_HOME;
-                            break;
-                        case 72:
-                            result = PLAY_TERMINAL_KEY_END;
-                            break;
-                        default:
-                            break;
-                    }
+            break;
+        default:
+            return 1;
+    }
+    if (length < 2)
+        return 0;
+
+    switch (chars[1]) {
+        case 79:
+            if (length < 3)
+                return 0;
+            switch (chars[2]) {
+                case 70:
+                    *key = PLAY_TERMINAL_KEY_HOME;
                     break;
-                case 91:
-                    switch (chars[2]) {
-                        case 53:
-                            if (length > 3 && chars[3] == 126) {
-                                result = PLAY_TERMINAL_KEY_PAGE_UP;
-                            }
-                            break;
-                        case 54:
-                            if (length > 3 && chars[3] == 126) {
-                                result = PLAY_TERMINAL_KEY_PAGE_DOWN;
-                            }
-                            break;
-                        case 65:
-                            result = PLAY_TERMINAL_KEY_UP;
-                            break;
-                        case 66:
-                            result = PLAY_TERMINAL_KEY_DOWN;
-                            break;
-                        case 67:
-                            result = PLAY_TERMINAL_KEY_RIGHT;
-                            break;
-                        case 68:
-                            result = PLAY_TERMINAL_KEY_LEFT;
-                            break;
-                        default:
-                            break;
-                    }
+                case 72:
+                    *key = PLAY_TERMINAL_KEY_END;
                     break;
                 default:
                     break;
             }
-            break;
-        case 127:
-            result = PLAY_TERMINAL_KEY_BACKSPACE;
-            break;
+            return 3;
+        case 91:
+            // Control sequence, parameter bytes are followed by a final
+            // byte in the range 64-126
+            for (i = 2; i < length; i++)
+                if (chars[i] >= 64 && chars[i] <= 126)
+                    break;
+            if (i == length)
+                return 0;
+
+            if (i == 2) {
+                switch (chars[2]) {
+                    case 65:
+                        *key = PLAY_TERMINAL_KEY_UP;
+                        break;
+                    case 66:
+                        *key = PLAY_TERMINAL_KEY_DOWN;
+                        break;
+                    case 67:
+                        *key = PLAY_TERMINAL_KEY_RIGHT;
+                        break;
+                    case 68:
+                        *key = PLAY_TERMINAL_KEY_LEFT;
+                        break;
+                    default:
+                        break;
+                }
+            } else if (i == 3 && chars[3] == 126) {
+                switch (chars[2]) {
+                    case 53:
+                        *key = PLAY_TERMINAL_KEY_PAGE_UP;
+                        break;
+                    case 54:
+                        *key = PLAY_TERMINAL_KEY_PAGE_DOWN;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            return i + 1;
         default:
-            break;
-    }
-    if (result != PLAY_TERMINAL_KEY_NONE)
-        g_signal_emit (
-            G_OBJECT (terminal),
-            signals[INPUT_READ],
-            0,
-            result);
-    return TRUE;
-}
-
-// Non-blocking read of a single character from STDIN
-// Returns the character or 0 on error or when there is no input to be read
-static guchar terminal_input_read_character (void)
-{
-    unsigned char   ch;
-    fd_set          fds;
-    struct timeval  tv;
-
-    FD_ZERO (&fds);
-    FD_SET (STDIN_FILENO, &fds);
-
-    tv.tv_sec  = 0;
-    tv.tv_usec = 0;
-
-    if (select (1, &fds, NULL, NULL, &tv) < 0)
-        return 0;
-    if (FD_ISSET (STDIN_FILENO, &fds)) {
-        if (read (STDIN_FILENO, &ch, 1) < 1)
-            return 0;
-        return ch;
+            // Not a known sequence, such as the escape key pressed along
+            // with the alt key
+            return 2;
     }
-    return 0;
 }
@@ -33,6 +33,9 @@ typedef enum {
 #  define STDIN_FILENO 0
 #endif
 
+// Size of the buffer holding unprocessed terminal input
+#define PLAY_TERMINAL_BUFFER_SIZE 64
+
 #define PLAY_TYPE_TERMINAL                     \
     (play_terminal_get_type())
 #define PLAY_TERMINAL(o)                       \
@@ -51,6 +54,10 @@ typedef struct {
     guint           width;
     gboolean        initialized;
     guint           listener;
+    guint           escape;
+    GIOChannel     *channel;
+    guchar          buffer[PLAY_TERMINAL_BUFFER_SIZE];
+    guint           length;
     struct termios *tty_old;
 } PlayTerminal;
 
@@ -4,10 +4,15 @@
  * Copyright (C) 2011-2013 Michal Ratajsky <michal.ratajsky@gmail.com>
  */
 #include "play-common.h"
+#include "play-control.h"
+#include "play-downloader.h"
 #include "play-gstreamer.h"
+#include "play-library.h"
+#include "play-prefetch.h"
 #include "play-queue.h"
 #include "play-queue-item.h"
 #include "play-simple-queue.h"
+#include "play-stats.h"
 #include "play-terminal.h"
 
 // File size constants for play_format_size ()
@@ -18,6 +23,13 @@
 #define PLAY_PB (1000LLU * PLAY_TB)
 #define PLAY_EB (1000LLU * PLAY_PB)
 
+// Delay in milliseconds before retrying a redraw when the position
+// in the current track is not known yet
+#define PLAY_REDRAW_RETRY 250
+
+// Default number of seconds between writes of the runtime statistics
+#define PLAY_STATS_INTERVAL 10
+
 // Initialize the backend, queue, main loop and signal handlers
 static gboolean play_init (int *argcp, char **argvp[]);
 
@@ -27,17 +39,63 @@ static void play_cleanup (void);
 // Start playing the first item in the queue
 static void play_start (void);
 
-// Watch the position in the current track and schedule an information
-// line redraw when the number of seconds has changed
-static gboolean play_loop (void);
+// Start playing the queue item at the given index after playing has been
+// stopped in the daemon mode
+static gboolean play_resume (gint index);
+
+// Stop after the last item in the queue, the program quits unless it is
+// running as a daemon waiting for more items
+static void play_finish (void);
+
+// Pause or unpause playing
+static void play_set_paused (gboolean pause);
+
+// Schedule an information line redraw as soon as possible
+static void play_schedule_redraw (void);
+
+// Schedule an information line redraw at the moment the position in
+// the current track reaches the next whole second
+static void play_schedule_redraw_tick (void);
+
+// Redraw the information line and schedule the next redraw
+static gboolean play_redraw_timeout (void);
 
 // Draw or redraw the information about the current track and position
-static gboolean play_redraw (void);
+static void play_redraw (void);
+
+// Write the part of the status line which differs from the displayed one
+// using a single write
+static void play_write_status (void);
+
+// Return the title shortened to fit the given number of terminal columns
+// and converted to the charset of the terminal
+// The result for the last item is cached as the title rarely changes
+// between redraws
+static const gchar *play_get_display_title (PlayQueueItem *item,
+                                            const gchar *title,
+                                            gint columns);
+
+// Shorten a string to be narrower than the given number of terminal columns,
+// the string .. is appended to a shortened string
+static gchar *play_shorten_to_width (const gchar *text, gint columns);
+
+// Return the number of terminal columns taken by a character
+static gint play_get_char_width (gunichar c);
+
+// Return the queue item to be played after the current one depending
+// on the queue position and command line options
+// When peeking, the queue position is not changed and NULL is also returned
+// when the next item cannot be known in advance
+static PlayQueueItem *play_get_next (gboolean peek);
 
 // Set the next queue item to be played using the backend depending
 // on the queue position and command line options
 static gboolean play_set_next (gboolean stop_before_set);
 
+// Let the backend know which item follows the current one to allow
+// switching to it without a gap
+static void play_prepare_next (void);
+
 // Set the previous queue item to be played using the backend depending
 // on the queue position and command line options
 static gboolean play_set_previous (gboolean stop_before_set);
@@ -54,13 +112,16 @@ static gboolean play_seek_next (void);
 // Seek to the previous queue item and play it
 static gboolean play_seek_previous (void);
 
-// Schedule a function to run periodically waiting until playlists have
-// been downloaded and allow simple keyboard controls
+// Wait until the first item to be played has been read from playlists
+// or directories and allow simple keyboard controls
 static void play_wait_for_queue (void);
 
-// Function executed periodically that checks if playlists have been
-// downloaded and the queue now contains media files
-static gboolean play_watch_playlists (void);
+// Start playing once the first item to be played is in the queue
+// Executed whenever playlists or directories have been read in part
+static void play_check_queue (void);
+
+// Display the progress of playlist downloads while waiting
+static void play_print_download_progress (void);
 
 // Playing of the current stream has finished
 static void play_gst_end_of_stream (PlayGstreamer *backend);
@@ -73,15 +134,66 @@ static void play_gst_metadata_updated (PlayGstreamer *backend,
                                        PlayMetadata meta,
                                        const gchar *value);
 
+// The duration of the currently played track has become known
+static void play_gst_duration_updated (PlayGstreamer *backend);
+
 // Handle backend events that may be important for the displayed
 // information
 static void play_gst_redraw_event (PlayGstreamer *backend);
 
+// The backend has continued playing the item set by play_prepare_next ()
+static void play_gst_track_changed (PlayGstreamer *backend,
+                                    PlayQueueItem *item);
+
+// Audio has reached the sink after a measured delay
+static void play_gst_latency (PlayGstreamer *backend,
+                              guint type,
+                              gint64 latency);
+
+// Buffer fill of a stream has been changed
+static void play_gst_buffering (PlayGstreamer *backend, guint progress);
+
+// A stalled stream is going to be reconnected
+static void play_gst_reconnecting (PlayGstreamer *backend,
+                                   guint attempt,
+                                   guint delay);
+
+// Write the runtime statistics to the file and descriptor given on
+// the command line
+static void play_write_stats (void);
+
+// Periodically write the runtime statistics
+static gboolean play_write_stats_timeout (void);
+
+// The duration or metadata of a queue item have been read in advance
+static void play_prefetch_item_updated (PlayPrefetch *prefetch,
+                                        PlayQueueItem *item);
+
 // An error has occured while reading a playlist
 static void play_queue_playlist_error (PlayQueue *queue,
                                        const gchar *uri,
                                        const gchar *error);
 
+// Execute a command received through the control socket
+static void play_control_command (PlayControl *control,
+                                  guint client,
+                                  const gchar *command,
+                                  const gchar *argument);
+
+// Reply to the status command of a control socket client
+static void play_control_status (guint client);
+
+// Items have been added to the queue
+static void play_queue_items_added (PlayQueue *queue,
+                                    guint index,
+                                    guint count);
+
+// The content replacing the queue has been read
+static void play_queue_replacement_ready (PlayQueue *queue);
+
+// A playlist or directory has been completely read
+static void play_queue_playlist_finished (PlayQueue *queue, const gchar *uri);
+
 // Update progress of playlist downloads
 static void play_queue_playlist_progress (PlayQueue *queue);
 
@@ -94,19 +206,71 @@ static void play_signal_winch (int signum);
 // Format size for display
 static gchar *play_format_size (guint64 size);
 
+// Return an array of the queue items in the order they were added in
+static GPtrArray *play_get_queue_items (void);
+
 // Global variables
 static GMainLoop       *loop;
 static PlayQueue       *queue;
 static PlaySimpleQueue *history;
 static PlayTerminal    *terminal;
 static PlayGstreamer   *backend;
+static PlayLibrary     *library;
+static PlayPrefetch    *prefetch;
+static PlayStats       *stats;
+static PlayControl     *control;
+
+// Source of the periodic statistics writes
+static guint stats_timeout;
+
+// Time of the program start and whether any audio has been played since
+static gint64   time_started;
+static gboolean audio_started;
+
+// Set to TRUE when the library index should be checked for information
+// about the tracks given on the command line, the tracks are checked as
+// they are added to the queue
+static gboolean library_refresh;
+
+// Set to TRUE when the information line is displayed
+static gboolean redraw_enabled;
+
+// Timeout or idle source of the next information line redraw
+static guint redraw_source;
+
+// The displayed information line and the buffer for building the next one
+static GString *status_shown;
+static GString *status_frame;
 
-// When set to TRUE the information line will be redrawn
-static gboolean redraw = TRUE;
+// Terminal width the information line has been displayed with and
+// whether the displayed line is known
+static guint    status_width;
+static gboolean status_valid;
 
 // Set to TRUE when playing is paused
 static gboolean paused;
 
+// Set to TRUE once playing has started
+static gboolean started;
+
+// Set to TRUE while waiting for the first item to be played to be read
+static gboolean waiting;
+
+// Time the waiting for the first item has started at
+static time_t download_start;
+
+// Set to TRUE when the daemon has stopped playing and waits for commands
+// or new items
+static gboolean idle;
+
+// Set to TRUE when the queue content should be replaced without waiting
+// for the current track to finish
+static gboolean replace_now;
+
+// Set to TRUE when the queue content has been replaced while playing
+// a track of the previous content, the first item follows it then
+static gboolean replaced;
+
 // Set to TRUE when the cursor is not at the beginning of a line and
 // a newline is need to be print
 static gboolean newline;
@@ -125,12 +289,32 @@ static gboolean opt_quiet;
 static gboolean opt_no_controls;
 static gboolean opt_repeat;
 static gboolean opt_shuffle;
+static gint     opt_max_downloads = PLAY_DOWNLOADER_MAX_DOWNLOADS;
+static gint     opt_max_downloads_host = PLAY_DOWNLOADER_MAX_DOWNLOADS_HOST;
+static gint     opt_connect_timeout = PLAY_DOWNLOADER_TIMEOUT_CONNECT;
+static gint     opt_read_timeout = PLAY_DOWNLOADER_TIMEOUT_READ;
+static gboolean opt_library;
+static gboolean opt_daemon;
+static gchar   *opt_socket;
+static gboolean opt_latency;
+static gchar   *opt_audio_sink;
+static gint     opt_buffer_size = -1;
+static gdouble  opt_buffer_duration = -1;
+static gboolean opt_download;
+static gint     opt_stall_timeout = PLAY_GSTREAMER_STALL_TIMEOUT;
+static gchar   *opt_stats;
+static gint     opt_stats_fd = -1;
+static gint     opt_stats_interval = PLAY_STATS_INTERVAL;
+
+// Delays measured by the backend for each PLAY_GSTREAMER_LATENCY_* type
+static GArray *latencies[PLAY_GSTREAMER_LATENCY_COUNT];
 
 // Print a newline when the cursor is not at the beginning of a line
 #define PRINT_NEWLINE_IF_NEEDED() \
- if (newline) {         \
-     putchar ('\n');    \
-     newline = FALSE;   \
+ if (newline) {             \
+     putchar ('\n');        \
+     newline = FALSE;       \
+     status_valid = FALSE;  \
  }
 
 // Initialize the backend, queue, main loop and signal handlers
@@ -139,11 +323,27 @@ static gboolean play_init (int *argcp, char **argvp[])
     GError *error = NULL;
     int i;
 
+    time_started = g_get_monotonic_time ();
+
+    // Collect the runtime statistics, this includes counting the main
+    // loop wakeups, so it has to be set up before any sources are added
+    if (opt_stats || opt_stats_fd >= 0) {
+        stats = play_stats_new ();
+        play_stats_set_default (stats);
+        play_stats_watch_main_loop ();
+
+        if (opt_stats_interval > 0)
+            stats_timeout = g_timeout_add_seconds (
+                opt_stats_interval,
+                (GSourceFunc) play_write_stats_timeout,
+                NULL);
+    }
+
     // Initialize the backend
     play_gstreamer_global_initialize (argcp, argvp);
 
     // Prepare the backend
-    backend = play_gstreamer_new (&error);
+    backend = play_gstreamer_new (opt_audio_sink, &error);
     if (!backend) {
         g_printerr ("Error: %s\n", error->message);
         g_error_free (error);
@@ -154,6 +354,38 @@ static gboolean play_init (int *argcp, char **argvp[])
         "end-of-stream",
         G_CALLBACK (play_gst_end_of_stream),
         NULL);
+    if (opt_latency)
+        for (i = 0; i < G_N_ELEMENTS (latencies); i++)
+            latencies[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+    if (opt_latency || stats)
+        g_signal_connect (
+            backend,
+            "latency",
+            G_CALLBACK (play_gst_latency),
+            NULL);
+    g_signal_connect (
+        backend,
+        "buffering",
+        G_CALLBACK (play_gst_buffering),
+        NULL);
+
+    // Network stream buffering
+    play_gstreamer_set_buffer (
+        backend,
+        opt_buffer_size,
+        opt_buffer_duration < 0 ? -1 : (gint64) (opt_buffer_duration * GST_SECOND));
+    if (opt_download)
+        play_gstreamer_set_download (backend, TRUE);
+
+    // Reconnecting of network streams which stop delivering data
+    play_gstreamer_set_stall_timeout (backend, MAX (opt_stall_timeout, 0));
+    g_signal_connect (
+        backend,
+        "reconnecting",
+        G_CALLBACK (play_gst_reconnecting),
+        NULL);
+
     g_signal_connect (
         backend,
         "metadata-updated",
@@ -164,6 +396,16 @@ static gboolean play_init (int *argcp, char **argvp[])
         "error",
         G_CALLBACK (play_gst_error),
         NULL);
+    g_signal_connect (
+        backend,
+        "track-changed",
+        G_CALLBACK (play_gst_track_changed),
+        NULL);
+    g_signal_connect (
+        backend,
+        "duration-updated",
+        G_CALLBACK (play_gst_duration_updated),
+        NULL);
     if (!opt_quiet) {
         g_signal_connect (
             backend,
@@ -180,12 +422,34 @@ static gboolean play_init (int *argcp, char **argvp[])
             "state-paused",
             G_CALLBACK (play_gst_redraw_event),
             NULL);
+        g_signal_connect (
+            backend,
+            "position-changed",
+            G_CALLBACK (play_gst_redraw_event),
+            NULL);
     }
     // Prepare the terminal input
     terminal = play_terminal_new ();
 
+    // Read the information about the upcoming tracks in advance
+    prefetch = play_prefetch_new ();
+    if (!opt_quiet)
+        g_signal_connect (
+            prefetch,
+            "item-updated",
+            G_CALLBACK (play_prefetch_item_updated),
+            NULL);
+
     // Prepare the queue
     queue = play_queue_new ();
+    play_queue_set_max_downloads (
+        queue,
+        MAX (opt_max_downloads, 0),
+        MAX (opt_max_downloads_host, 0));
+    play_queue_set_download_timeouts (
+        queue,
+        MAX (opt_connect_timeout, 0),
+        MAX (opt_read_timeout, 0));
     g_signal_connect (
         queue,
         "playlist-error",
@@ -196,12 +460,58 @@ static gboolean play_init (int *argcp, char **argvp[])
         "playlist-progress-updated",
         G_CALLBACK (play_queue_playlist_progress),
         NULL);
+    g_signal_connect (
+        queue,
+        "playlist-finished",
+        G_CALLBACK (play_queue_playlist_finished),
+        NULL);
+    g_signal_connect (
+        queue,
+        "items-added",
+        G_CALLBACK (play_queue_items_added),
+        NULL);
+
+    // Accept commands through a Unix domain socket
+    if (opt_socket) {
+        g_signal_connect (
+            queue,
+            "replacement-ready",
+            G_CALLBACK (play_queue_replacement_ready),
+            NULL);
+
+        control = play_control_new ();
+        if (!play_control_listen (control, opt_socket, &error)) {
+            g_printerr ("Error: %s\n", error->message);
+            g_error_free (error);
+            return FALSE;
+        }
+        g_signal_connect (
+            control,
+            "command",
+            G_CALLBACK (play_control_command),
+            NULL);
+    }
 
     // If shuffling along with repetition is enabled, use a separate
     // queue to hold the history of what has been played
     if (opt_shuffle && opt_repeat && !opt_no_controls)
         history = play_simple_queue_new ();
 
+    if (opt_library) {
+        // A missing index is not an error, it is created on exit
+        library = play_library_new (NULL);
+        play_library_load (library, NULL);
+
+        if (*argcp < 2) {
+            // Play the whole library straight from the index
+            if (!play_library_get_count (library)) {
+                g_print ("The media library is empty.\n");
+                return FALSE;
+            }
+            play_queue_add_library (queue, library);
+        } else
+            library_refresh = TRUE;
+    }
     // The command line arguments don't contain any options anymore
     for (i = 1; i < *argcp; i++)
         play_queue_add (queue, (*argvp)[i]);
@@ -230,14 +540,56 @@ static void play_cleanup (void)
 
     PRINT_NEWLINE_IF_NEEDED ();
 
+    // Wait for the metadata being read in the background before anything
+    // it may update is released, the results which have not been applied
+    // are dropped
+    g_object_unref (prefetch);
+
+    if (opt_latency)
+        play_gstreamer_print_latency (latencies);
+
+    // Write the final statistics
+    if (stats) {
+        if (stats_timeout)
+            g_source_remove (stats_timeout);
+
+        play_write_stats ();
+        play_stats_set_default (NULL);
+        g_object_unref (stats);
+    }
+
     // Make sure to unmute the sound output when done playing
     if (play_gstreamer_get_mute (backend, &mute) && mute) {
         play_gstreamer_set_mute (backend, FALSE);
     }
+    // Store the tracks along with the information learned while playing
+    // them in the library index
+    if (library) {
+        if (play_queue_get_count (queue)) {
+            GPtrArray *items;
+
+            play_queue_sort_by_position (queue);
+            items = play_get_queue_items ();
+            play_library_save (library, items, NULL);
+            g_ptr_array_unref (items);
+        }
+        g_object_unref (library);
+    }
+    if (control)
+        g_object_unref (control);
+
     g_object_unref (backend);
+    g_free (opt_audio_sink);
+    g_free (opt_socket);
+    g_free (opt_stats);
     g_object_unref (terminal);
     g_object_unref (queue);
     g_main_loop_unref (loop);
+
+    if (status_shown)
+        g_string_free (status_shown, TRUE);
+    if (status_frame)
+        g_string_free (status_frame, TRUE);
 }
 
 // Start playing the first item in the queue
@@ -256,20 +608,17 @@ static void play_start (void)
             play_queue_get_current (queue),
             TRUE);
 
-    // Play the first item in the queue, seeking to the next ones
-    // will be done in the end-of-stream callback
+    // Play the first item in the queue, the following ones are handed
+    // to the backend in advance to be played without a gap
     play_gstreamer_set_item (backend, play_queue_get_current (queue));
+    play_prepare_next ();
+    started = TRUE;
 
     if (!opt_quiet) {
-        // Create timers to update the display
-        g_timeout_add (
-            50,
-            (GSourceFunc) play_loop,
-            NULL);
-        g_timeout_add (
-            50,
-            (GSourceFunc) play_redraw,
-            NULL);
+        // Start updating the display, further redraws are scheduled
+        // by the display itself and by backend events
+        redraw_enabled = TRUE;
+        play_schedule_redraw ();
     }
     if (!opt_no_controls) {
         g_signal_connect (
@@ -283,45 +632,131 @@ static void play_start (void)
     play_gstreamer_set_state_playing (backend);
 }
 
-// Watch the position in the current track and schedule an information
-// line redraw when the number of seconds has changed
-static gboolean play_loop (void)
+// Start playing the queue item at the given index after playing has been
+// stopped in the daemon mode
+static gboolean play_resume (gint index)
+{
+    if (index < 0 || !play_queue_position_set_index (queue, index))
+        return FALSE;
+
+    idle    = FALSE;
+    paused  = FALSE;
+    started = TRUE;
+    if (history)
+        play_simple_queue_append (
+            history,
+            play_queue_get_current (queue),
+            TRUE);
+
+    play_gstreamer_set_item (backend, play_queue_get_current (queue));
+    play_prepare_next ();
+    play_gstreamer_set_state_playing (backend);
+    return TRUE;
+}
+
+// Stop after the last item in the queue, the program quits unless it is
+// running as a daemon waiting for more items
+static void play_finish (void)
+{
+    if (!opt_daemon) {
+        g_main_loop_quit (loop);
+        return;
+    }
+    play_gstreamer_set_state_stopped (backend);
+
+    // The play command starts over from the beginning, items added in
+    // the meantime are played right away
+    play_queue_position_set_first (queue);
+    idle = TRUE;
+}
+
+// Pause or unpause playing
+static void play_set_paused (gboolean pause)
+{
+    if (pause)
+        play_gstreamer_set_state_paused (backend);
+    else
+        play_gstreamer_set_state_playing (backend);
+
+    paused = pause;
+    play_schedule_redraw ();
+}
+
+// Schedule an information line redraw as soon as possible
+static void play_schedule_redraw (void)
+{
+    if (!redraw_enabled)
+        return;
+
+    // Replace the pending redraw, several events arriving at once
+    // result in a single redraw
+    if (redraw_source)
+        g_source_remove (redraw_source);
+
+    redraw_source = g_idle_add ((GSourceFunc) play_redraw_timeout, NULL);
+}
+
+// Schedule an information line redraw at the moment the position in
+// the current track reaches the next whole second
+static void play_schedule_redraw_tick (void)
 {
-    gint64 position;
-    static gint seconds = 0;
+    PlayGstreamerState state;
+    gint64             position;
+    guint              delay;
+
+    // The displayed information does not change unless playing, the next
+    // tick is scheduled by the redraw following the change of the state
+    // to playing
+    if (paused)
+        return;
+    if (!play_gstreamer_get_state (backend, &state) ||
+        state != PLAY_GSTREAMER_PLAYING)
+        return;
 
     if (play_gstreamer_get_position (backend, &position)) {
-        gint current = PLAY_GSTREAMER_TIME_SECONDS (position);
-        if (current != seconds) {
-            redraw = TRUE;
-            seconds = current;
-        }
+        // Wake up just after the next second has been reached
+        delay = (guint) ((GST_SECOND - position % GST_SECOND) / GST_MSECOND) + 1;
+    } else {
+        // This function can be executed during switching to a different
+        // track and the position will then be unknown
+        delay = PLAY_REDRAW_RETRY;
     }
-    return TRUE;
+    redraw_source = g_timeout_add (
+        delay,
+        (GSourceFunc) play_redraw_timeout,
+        NULL);
+}
+
+// Redraw the information line and schedule the next redraw
+static gboolean play_redraw_timeout (void)
+{
+    redraw_source = 0;
+
+    play_redraw ();
+    play_schedule_redraw_tick ();
+
+    // Return FALSE as the source is replaced by a new one with
+    // a different delay
+    return FALSE;
 }
 
 // Draw or redraw the information about the current track and position
-static gboolean play_redraw (void)
+static void play_redraw (void)
 {
     PlayQueueItem *item;
     const gchar   *title;
-    GString       *line;
+    gchar         *state = NULL;
     gint64         position;
     gint64         duration;
     gint           length = 0;
-    gint           i;
+    guint          progress;
 
-    if (!redraw) {
-        // The line is redrawn only when something has changed
-        return TRUE;
-    }
     if (!play_gstreamer_get_position (backend, &position)) {
         // This function can be executed during switching to a different
         // track and the position will then be unknown
-        return TRUE;
+        return;
     }
     item = play_gstreamer_get_current (backend);
-    line = g_string_new (NULL);
 
     // The displayed track title will be either title read from the
     // track by gstreamer, file name or URI
@@ -329,17 +764,19 @@ static gboolean play_redraw (void)
     if (!title)
         title = play_queue_item_get_name (item);
 
-    // Clear the current line
-    putchar ('\r');
-    for (i = 0; i < width; i++)
-        putchar (' ');
-    putchar ('\r');
+    // The line is built in the buffer of the previous redraw
+    if (!status_frame)
+        status_frame = g_string_sized_new (256);
+    else
+        g_string_truncate (status_frame, 0);
 
     // Time information of the current track
-    // Duration is not present in live streams
-    if (play_gstreamer_get_duration (backend, &duration)) {
+    // Duration is not present in live streams, until the backend knows it
+    // use the one read in advance
+    if (play_gstreamer_get_duration (backend, &duration) ||
+        (duration = play_queue_item_get_duration (item)) >= 0) {
         g_string_append_printf (
-            line,
+            status_frame,
             "[ %02u:%02u:%02u / %02u:%02u:%02u ]",
             PLAY_GSTREAMER_TIME_HOURS (position),
             PLAY_GSTREAMER_TIME_MINUTES (position),
@@ -349,108 +786,324 @@ static gboolean play_redraw (void)
             PLAY_GSTREAMER_TIME_SECONDS (duration));
     } else {
         g_string_append_printf (
-            line,
+            status_frame,
             "[ %02u:%02u:%02u ]",
             PLAY_GSTREAMER_TIME_HOURS (position),
             PLAY_GSTREAMER_TIME_MINUTES (position),
             PLAY_GSTREAMER_TIME_SECONDS (position));
     }
+    // The playing state follows the title, the network stream buffer
+    // fill is displayed while playing waits for it
+    if (paused)
+        state = g_strdup (" [PAUSED]");
+    else if (play_gstreamer_get_buffering (backend, &progress))
+        state = g_strdup_printf (" [BUFFERING %u%%]", progress);
+
     // The length variable includes the number of characters to follow
     // excluding the track title
-    if (paused)
-        length = 10;
-    else
-        length = 1;
-    if (width > line->len) {
-        length = width - (line->len + length);
+    length = (state ? strlen (state) : 0) + 1;
+    if (width > status_frame->len) {
+        length = width - (status_frame->len + length);
         if (length > 2) {
             if (title) {
-                g_string_append_c (line, ' ');
-                if (g_utf8_strlen (title, -1) < length) {
-                    // The terminal is wide enough to contain the whole
-                    // information line
-                    g_string_append (line, title);
-                } else {
-                    // The terminal is not wide enough, the title is shortened
-                    // and the string .. is appened
-                    // XXX breaks unicode chars
-                    g_string_append_len (line, title, length - 3);
-                    g_string_append (line, "..");
-                }
-            }
-            if (paused)
-                g_string_append (line, " [PAUSED]");
-        }
-        if (!g_get_charset (NULL)) {
-            // The terminal uses a non-utf8 charset and all of our
-            // strings are in utf8
-            gchar *converted = g_locale_from_utf8 (
-                line->str,
-                -1,
-                NULL, NULL, NULL);
-            if (converted) {
-                g_print ("%s", converted);
-                g_free (converted);
-            } else {
-                g_print ("%s", line->str);
+                g_string_append_c (status_frame, ' ');
+                g_string_append (
+                    status_frame,
+                    play_get_display_title (item, title, length));
             }
-        } else {
-            g_print ("%s", line->str);
+            if (state)
+                g_string_append (status_frame, state);
         }
-        g_string_free (line, TRUE);
+    } else {
+        // The terminal is too narrow to display anything
+        g_string_truncate (status_frame, 0);
     }
-    redraw  = FALSE;
+    g_free (state);
+
+    play_write_status ();
     newline = TRUE;
-    return TRUE;
 }
 
-// Set the next queue item to be played using the backend depending
+// Write the part of the status line which differs from the displayed one
+// using a single write
+static void play_write_status (void)
+{
+    GString *output;
+    GString *shown;
+    gsize    prefix = 0;
+    gsize    written = 0;
+
+    if (!status_shown)
+        status_shown = g_string_sized_new (256);
+
+    // The displayed line is not known after printing other messages and
+    // might have been wrapped after resizing the terminal
+    if (status_width != width) {
+        status_width = width;
+        status_valid = FALSE;
+    }
+    if (status_valid) {
+        if (g_string_equal (status_frame, status_shown))
+            return;
+
+        // Only the leading ASCII characters are compared as their number
+        // is the number of columns to skip regardless of the charset
+        while (prefix < status_frame->len &&
+               prefix < status_shown->len &&
+               status_frame->str[prefix] == status_shown->str[prefix] &&
+               !(status_frame->str[prefix] & 0x80))
+            prefix++;
+    }
+    output = g_string_sized_new (status_frame->len + 16);
+
+    // Move to the first changed column, write the rest of the line and
+    // erase what is left of the previous one
+    g_string_append_c (output, '\r');
+    if (prefix)
+        g_string_append_printf (output, "\033[%uC", (guint) prefix);
+
+    g_string_append_len (
+        output,
+        status_frame->str + prefix,
+        status_frame->len - prefix);
+    g_string_append (output, "\033[K");
+
+    // Anything printed through stdio must reach the terminal first
+    fflush (stdout);
+    while (written < output->len) {
+        gssize ret = write (
+            STDOUT_FILENO,
+            output->str + written,
+            output->len - written);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        written += ret;
+    }
+    g_string_free (output, TRUE);
+
+    // The built line becomes the displayed one and its buffer is reused
+    // for the next redraw
+    shown = status_shown;
+    status_shown = status_frame;
+    status_frame = shown;
+    status_valid = TRUE;
+}
+
+// Return the title shortened to fit the given number of terminal columns
+// and converted to the charset of the terminal
+// The result for the last item is cached as the title rarely changes
+// between redraws
+static const gchar *play_get_display_title (PlayQueueItem *item,
+                                            const gchar *title,
+                                            gint columns)
+{
+    static PlayQueueItem *cached_item;
+    static gchar         *cached_source;
+    static gchar         *cached_title;
+    static gint           cached_columns;
+    gchar *shortened;
+
+    // The item is only compared, a different item allocated at the same
+    // address would still need the same title to use the cached one
+    if (cached_title &&
+        cached_item == item &&
+        cached_columns == columns &&
+        !strcmp (cached_source, title))
+        return cached_title;
+
+    g_free (cached_source);
+    g_free (cached_title);
+
+    shortened = play_shorten_to_width (title, columns);
+    if (!g_get_charset (NULL)) {
+        // The terminal uses a non-utf8 charset and all of our
+        // strings are in utf8
+        cached_title = g_locale_from_utf8 (shortened, -1, NULL, NULL, NULL);
+        if (cached_title)
+            g_free (shortened);
+        else
+            cached_title = shortened;
+    } else
+        cached_title = shortened;
+
+    cached_item    = item;
+    cached_source  = g_strdup (title);
+    cached_columns = columns;
+    return cached_title;
+}
+
+// Shorten a string to be narrower than the given number of terminal columns,
+// the string .. is appended to a shortened string
+static gchar *play_shorten_to_width (const gchar *text, gint columns)
+{
+    const gchar *p;
+    gint used = 0;
+
+    if (!g_utf8_validate (text, -1, NULL)) {
+        // Not a valid utf8 string, count each byte as a column
+        if ((gint) strlen (text) < columns)
+            return g_strdup (text);
+
+        return g_strdup_printf ("%.*s..", columns - 3, text);
+    }
+    for (p = text; *p; p = g_utf8_next_char (p))
+        used += play_get_char_width (g_utf8_get_char (p));
+
+    // The terminal is wide enough to contain the whole string
+    if (used < columns)
+        return g_strdup (text);
+
+    // Keep the characters fitting in the columns left for the string ..
+    used = 0;
+    for (p = text; *p; p = g_utf8_next_char (p)) {
+        gint char_width = play_get_char_width (g_utf8_get_char (p));
+
+        if (used + char_width > columns - 3)
+            break;
+        used += char_width;
+    }
+    return g_strdup_printf ("%.*s..", (gint) (p - text), text);
+}
+
+// Return the number of terminal columns taken by a character
+static gint play_get_char_width (gunichar c)
+{
+    if (g_unichar_iszerowidth (c))
+        return 0;
+    if (g_unichar_iswide (c))
+        return 2;
+
+    return 1;
+}
+
+// Return the queue item to be played after the current one depending
 // on the queue position and command line options
-static gboolean play_set_next (gboolean stop_before_set)
+// When peeking, the queue position is not changed and NULL is also returned
+// when the next item cannot be known in advance
+static PlayQueueItem *play_get_next (gboolean peek)
 {
     PlayQueueItem *item;
 
+    if (replaced) {
+        // The queue content has been replaced while playing, continue
+        // with its first item
+        if (peek)
+            return play_queue_get_first (queue);
+
+        replaced = FALSE;
+        play_queue_position_set_first (queue);
+
+        item = play_queue_get_current (queue);
+        if (history)
+            play_simple_queue_append (history, item, TRUE);
+
+        return item;
+    }
     if (history && !play_simple_queue_position_is_last (history)) {
         // Playing accordingly to shuffle queue history
         // Advance the queue and use the next item in the history
+        if (peek)
+            return play_simple_queue_get_next (history);
+
         play_simple_queue_position_set_next (history);
+        return play_simple_queue_get_current (history);
+    }
+    if (play_queue_position_is_last (queue)) {
+        if (!opt_repeat) {
+            // Report a failure to advance the queue position as
+            // repetition is disabled and we are at the end
+            return NULL;
+        }
+        if (opt_shuffle) {
+            // If shuffling is enabled the queue order is
+            // randomized each time we reach the end, so the next
+            // item is not known until then
+            if (peek)
+                return NULL;
+
+            play_queue_randomize (queue);
+        }
+        // If repetition is enabled the queue position is
+        // moved back to the start
+        if (peek)
+            return play_queue_get_first (queue);
 
-        item = play_simple_queue_get_current (history);
+        play_queue_position_set_first (queue);
     } else {
-        // Try to advance the queue position by one item
-        // If it fails we have reached the end of the queue
-        if (!play_queue_position_set_next (queue)) {
-            if (!opt_repeat) {
-                // Report a failure to advance the queue position as
-                // repetition is disabled and we are at the end
-                return FALSE;
-            }
-            if (opt_shuffle) {
-                // If shuffling is enabled the queue order is
-                // randomized each time we reach the end
-                play_queue_randomize (queue);
-            }
-            // If repetition is enabled the queue position is
-            // moved back to the start
-            play_queue_position_set_first (queue);
-        }
-        item = play_queue_get_current (queue);
-        if (history)
-            play_simple_queue_append (history, item, TRUE);
+        if (peek)
+            return play_queue_get_next (queue);
+
+        play_queue_position_set_next (queue);
     }
+    item = play_queue_get_current (queue);
+    if (history)
+        play_simple_queue_append (history, item, TRUE);
+
+    return item;
+}
+
+// Set the next queue item to be played using the backend depending
+// on the queue position and command line options
+static gboolean play_set_next (gboolean stop_before_set)
+{
+    PlayQueueItem *item;
+
+    item = play_get_next (FALSE);
+    if (!item)
+        return FALSE;
+
     if (stop_before_set)
         play_gstreamer_set_state_stopped (backend);
 
     play_gstreamer_set_item (backend, item);
+    play_prepare_next ();
     return TRUE;
 }
 
+// Let the backend know which item follows the current one to allow
+// switching to it without a gap
+static void play_prepare_next (void)
+{
+    PlayQueueItem *items[PLAY_PREFETCH_COUNT];
+    gint  index;
+    guint count = 0;
+
+    play_gstreamer_set_next_item (backend, play_get_next (TRUE));
+
+    // Read the information about the tracks following the current one,
+    // the items read so far for a different position are dropped
+    index = play_queue_get_current_index (queue);
+    if (index >= 0) {
+        // After replacing the queue content its first item follows
+        if (!replaced)
+            index++;
+
+        while (count < PLAY_PREFETCH_COUNT) {
+            PlayQueueItem *item = play_queue_get_nth (
+                queue,
+                (guint) index + count);
+            if (!item)
+                break;
+
+            items[count++] = item;
+        }
+    }
+    play_prefetch_items (prefetch, items, count);
+}
+
 // Set the previous queue item to be played using the backend depending
 // on the queue position and command line options
 static gboolean play_set_previous (gboolean stop_before_set)
 {
     PlayQueueItem *item;
 
+    // Nothing of the replaced queue content has been played yet
+    if (replaced)
+        return FALSE;
+
     if (history) {
         if (play_simple_queue_position_is_first (history)) {
             // Already at the start of the history
@@ -478,6 +1131,7 @@ static gboolean play_set_previous (gboolean stop_before_set)
         play_gstreamer_set_state_stopped (backend);
 
     play_gstreamer_set_item (backend, item);
+    play_prepare_next ();
     return TRUE;
 }
 
@@ -489,13 +1143,7 @@ static void play_process_input (PlayTerminal *terminal, gint key)
         case 'P':
         case ' ':
             // Pause/unpause
-            if (paused) {
-                play_gstreamer_set_state_playing (backend);
-                paused = FALSE;
-            } else {
-                play_gstreamer_set_state_paused (backend);
-                paused = TRUE;
-            }
+            play_set_paused (!paused);
             break;
         case PLAY_TERMINAL_KEY_UP:
             // Seek 10 seconds forward
@@ -580,8 +1228,8 @@ static gboolean play_seek_previous (void)
     return FALSE;
 }
 
-// Schedule a function to run periodically waiting until playlists have
-// been downloaded and allow simple keyboard controls
+// Wait until the first item to be played has been read from playlists
+// or directories and allow simple keyboard controls
 static void play_wait_for_queue (void)
 {
     if (!opt_no_controls) {
@@ -593,55 +1241,35 @@ static void play_wait_for_queue (void)
         // Change the input mode
         play_terminal_listen (terminal);
     }
-    g_timeout_add (
-        100,
-        (GSourceFunc) play_watch_playlists,
-        NULL);
+    download_start = time (NULL);
+    waiting = TRUE;
+
+    // Local files given before the playlists can be played right away
+    play_check_queue ();
 }
 
-// Function executed periodically that checks if playlists have been
-// downloaded and the queue now contains media files
-static gboolean play_watch_playlists (void)
-{
-    if (play_queue_get_count_pending (queue)) {
-        static gboolean print_message = FALSE;
-        static gboolean print_progress = FALSE;
-        // Timestamp of the first execution of this function
-        static time_t download_start = 0;
-
-        if (print_message) {
-            gint i;
-
-            putchar ('\r');
-            for (i = 0; i < width; i++)
-                putchar (' ');
-            putchar ('\r');
-            g_print ("Downloading playlists...");
-            if (print_progress) {
-                gchar *current = play_format_size (download_current);
-                gchar *total   = play_format_size (download_total);
-
-                g_print (" %s / %s", current, total);
-                g_free (current);
-                g_free (total);
-            } else {
-                // Start printing the progress if the download is
-                // taking more than 1 second
-                if ((time (NULL) - download_start) > 1)
-                    print_progress = TRUE;
-            }
-            newline = TRUE;
-        } else {
-            if (!download_start)
-                download_start = time (NULL);
-
-            // Start printing a progress message when the download is
-            // taking at least 1 second
-            if (!opt_quiet && (time (NULL) - download_start))
-                print_message = TRUE;
-        }
-        return TRUE;
+// Start playing once the first item to be played is in the queue
+// Executed whenever playlists or directories have been read in part
+static void play_check_queue (void)
+{
+    gboolean ready;
+
+    if (!waiting)
+        return;
+
+    // When shuffling any item can be played first, otherwise the items
+    // following the first one are merged into their places later
+    if (opt_shuffle)
+        ready = play_queue_get_count (queue) > 0;
+    else
+        ready = play_queue_first_is_ready (queue);
+
+    if (!ready && play_queue_get_count_pending (queue)) {
+        play_print_download_progress ();
+        return;
     }
+    waiting = FALSE;
+
     if (!opt_no_controls) {
         // Custom terminal input handler was used during download
         g_signal_handlers_disconnect_by_func (
@@ -654,13 +1282,39 @@ static gboolean play_watch_playlists (void)
     if (play_queue_get_count (queue)) {
         play_start ();
     } else {
-        if (!playlist_error_shown)
+        if (!playlist_error_shown && !opt_quiet)
             g_print ("No playable tracks have been found.\n");
 
-        g_main_loop_quit (loop);
+        play_finish ();
     }
-    // Return FALSE so the function is not executed anymore
-    return FALSE;
+}
+
+// Display the progress of playlist downloads while waiting
+static void play_print_download_progress (void)
+{
+    time_t elapsed;
+    gint   i;
+
+    // Start printing a progress message when the download is taking at
+    // least 1 second and the sizes when it is taking more than that
+    elapsed = time (NULL) - download_start;
+    if (opt_quiet || !elapsed)
+        return;
+
+    putchar ('\r');
+    for (i = 0; i < width; i++)
+        putchar (' ');
+    putchar ('\r');
+    g_print ("Downloading playlists...");
+    if (elapsed > 1) {
+        gchar *current = play_format_size (download_current);
+        gchar *total   = play_format_size (download_total);
+
+        g_print (" %s / %s", current, total);
+        g_free (current);
+        g_free (total);
+    }
+    newline = TRUE;
 }
 
 // Playing of the current stream has finished
@@ -670,7 +1324,7 @@ static void play_gst_end_of_stream (PlayGstreamer *backend)
         PRINT_NEWLINE_IF_NEEDED ();
         play_gstreamer_set_state_playing (backend);
     } else
-        g_main_loop_quit (loop);
+        play_finish ();
 }
 
 // An error while playing the current track has occured
@@ -690,7 +1344,7 @@ static void play_gst_error (PlayGstreamer *gstreamer, GError *error)
     if (play_set_next (FALSE))
         play_gstreamer_set_state_playing (backend);
     else
-        g_main_loop_quit (loop);
+        play_finish ();
 }
 
 // The metadata of the currenly played track has been updated
@@ -703,20 +1357,139 @@ static void play_gst_metadata_updated (PlayGstreamer *backend,
     switch (meta) {
         case PLAY_METADATA_ARTIST:
         case PLAY_METADATA_TITLE:
-            redraw = TRUE;
-            break;  
+            play_schedule_redraw ();
+            break;
         default:
             break;
     }
 }
 
+// The duration of the currently played track has become known
+static void play_gst_duration_updated (PlayGstreamer *backend)
+{
+    PlayQueueItem *item;
+    gint64         duration;
+
+    // Remember the duration to be stored in the library index
+    item = play_gstreamer_get_current (backend);
+    if (item && play_gstreamer_get_duration (backend, &duration))
+        play_queue_item_set_duration (item, duration);
+}
+
+// The duration or metadata of a queue item have been read in advance
+static void play_prefetch_item_updated (PlayPrefetch *prefetch,
+                                        PlayQueueItem *item)
+{
+    // The item might have started playing before it was read
+    if (item == play_gstreamer_get_current (backend))
+        play_schedule_redraw ();
+}
+
 // Handle backend events that may be important for the displayed
 // information
 static void play_gst_redraw_event (PlayGstreamer *backend)
 {
-    // Make sure the information line is redrawn the next time the
-    // display update function is executed
-    redraw = TRUE;
+    // Redraw the information line without waiting for the next second
+    play_schedule_redraw ();
+}
+
+// The backend has continued playing the item set by play_prepare_next ()
+static void play_gst_track_changed (PlayGstreamer *backend,
+                                    PlayQueueItem *item)
+{
+    // Move the queue position to the item that is now being played
+    // and prepare the one to follow
+    // The backend might have been given the item following the current
+    // one before the queue content was replaced, the first item of the
+    // new content then follows that one
+    if (!replaced || item == play_queue_get_first (queue))
+        play_get_next (FALSE);
+
+    play_prepare_next ();
+
+    PRINT_NEWLINE_IF_NEEDED ();
+    play_schedule_redraw ();
+}
+
+// Audio has reached the sink after a measured delay
+static void play_gst_latency (PlayGstreamer *backend,
+                              guint type,
+                              gint64 latency)
+{
+    static const gchar *names[] = {
+        "latency.start_us",
+        "latency.gap_us",
+        "latency.seek_us"
+    };
+
+    if (G_UNLIKELY (type >= G_N_ELEMENTS (latencies)))
+        return;
+    if (latencies[type])
+        g_array_append_val (latencies[type], latency);
+
+    PLAY_STATS_RECORD (names[type], latency / GST_USECOND);
+    if (!audio_started) {
+        PLAY_STATS_SET (
+            "playback.time_to_first_audio_ms",
+            (g_get_monotonic_time () - time_started) / 1000);
+        audio_started = TRUE;
+    }
+}
+
+// Buffer fill of a stream has been changed
+static void play_gst_buffering (PlayGstreamer *backend, guint progress)
+{
+    static guint progress_last = 100;
+
+    PLAY_STATS_COUNT ("buffering.events", 1);
+
+    // The buffer has run empty after the playback had started
+    if (progress < 100 && progress_last == 100 && audio_started)
+        PLAY_STATS_COUNT ("buffering.underruns", 1);
+
+    // The progress is displayed until the buffer is full
+    if (progress != progress_last)
+        play_schedule_redraw ();
+
+    progress_last = progress;
+}
+
+// A stalled stream is going to be reconnected
+static void play_gst_reconnecting (PlayGstreamer *backend,
+                                   guint attempt,
+                                   guint delay)
+{
+    PLAY_STATS_COUNT ("streams.reconnects", 1);
+
+    if (opt_quiet)
+        return;
+
+    PRINT_NEWLINE_IF_NEEDED ();
+    g_print ("%s is not responding, reconnecting in %u s (attempt %u)\n",
+        play_queue_item_get_name (play_gstreamer_get_current (backend)),
+        delay,
+        attempt);
+}
+
+// Write the runtime statistics to the file and descriptor given on
+// the command line
+static void play_write_stats (void)
+{
+    // The standard error output is closed, the errors are ignored and
+    // the next write is tried again
+    if (opt_stats)
+        play_stats_write_file (stats, opt_stats, NULL);
+    if (opt_stats_fd >= 0)
+        play_stats_write_fd (stats, opt_stats_fd, NULL);
+}
+
+// Periodically write the runtime statistics
+static gboolean play_write_stats_timeout (void)
+{
+    play_write_stats ();
+
+    // Return TRUE to keep the function being called
+    return TRUE;
 }
 
 // An error has occured while reading a playlist
@@ -732,6 +1505,268 @@ static void play_queue_playlist_error (PlayQueue *queue,
     g_print ("Error reading %s: %s\n", uri, error);
 
     playlist_error_shown = TRUE;
+
+    // The failed playlist might have been the one holding back the start
+    play_check_queue ();
+}
+
+// Execute a command received through the control socket
+static void play_control_command (PlayControl *control,
+                                  guint client,
+                                  const gchar *command,
+                                  const gchar *argument)
+{
+    const gchar *error = NULL;
+    gchar       *end;
+    gdouble      value = 0;
+
+    // Numeric arguments starting with a sign are relative to the current
+    // value
+    if (argument) {
+        value = g_ascii_strtod (argument, &end);
+        if (end == argument || *end)
+            end = NULL;
+    } else
+        end = NULL;
+
+    if (!strcmp (command, "play")) {
+        if (idle) {
+            if (!play_resume (play_queue_get_current_index (queue)))
+                error = "The queue is empty";
+        } else if (paused)
+            play_set_paused (FALSE);
+    } else if (!strcmp (command, "pause")) {
+        if (!idle && !paused)
+            play_set_paused (TRUE);
+    } else if (!strcmp (command, "toggle")) {
+        if (idle) {
+            if (!play_resume (play_queue_get_current_index (queue)))
+                error = "The queue is empty";
+        } else
+            play_set_paused (!paused);
+    } else if (!strcmp (command, "stop")) {
+        if (!idle) {
+            play_gstreamer_set_state_stopped (backend);
+            idle = TRUE;
+        }
+    } else if (!strcmp (command, "next")) {
+        if (play_seek_next ())
+            idle = paused = FALSE;
+        else
+            error = "There is no next track";
+    } else if (!strcmp (command, "previous")) {
+        if (play_seek_previous ())
+            idle = paused = FALSE;
+        else
+            error = "There is no previous track";
+    } else if (!strcmp (command, "seek")) {
+        gint64 position;
+
+        if (!end)
+            error = "The position must be a number of seconds";
+        else if (idle)
+            error = "Nothing is playing";
+        else if (*argument == '+' || *argument == '-') {
+            if (!play_gstreamer_set_position (backend, value * GST_SECOND))
+                error = "Seeking has failed";
+        } else if (!play_gstreamer_get_position (backend, &position) ||
+                   !play_gstreamer_set_position (
+                       backend,
+                       value * GST_SECOND - position))
+            error = "Seeking has failed";
+    } else if (!strcmp (command, "enqueue")) {
+        // Playing is started by the items-added signal handler when idle
+        if (!argument || !*argument)
+            error = "A file or URI is required";
+        else if (!play_queue_add (queue, argument))
+            error = "The file or URI cannot be played";
+    } else if (!strcmp (command, "replace") ||
+               !strcmp (command, "replace-now")) {
+        // The content is read in the background and swapped in by the
+        // replacement-ready signal handler
+        if (!argument || !*argument)
+            error = "A file or URI is required";
+        else {
+            replace_now = !strcmp (command, "replace-now");
+            if (!play_queue_prepare_replacement (queue, argument))
+                error = "The file or URI cannot be read now";
+        }
+    } else if (!strcmp (command, "volume")) {
+        gdouble volume;
+
+        if (argument) {
+            if (!end)
+                error = "The volume must be a number between 0 and 1";
+            else if (*argument == '+' || *argument == '-')
+                play_gstreamer_set_volume_relative (backend, value);
+            else
+                play_gstreamer_set_volume (backend, CLAMP (value, 0.0, 1.0));
+        }
+        if (!error && play_gstreamer_get_volume (backend, &volume))
+            play_control_reply (control, client, "volume=%.2f", volume);
+    } else if (!strcmp (command, "mute")) {
+        play_gstreamer_toggle_mute (backend);
+    } else if (!strcmp (command, "status")) {
+        play_control_status (client);
+    } else if (!strcmp (command, "quit")) {
+        g_main_loop_quit (loop);
+    } else
+        error = "Unknown command";
+
+    // Every command is finished by a line telling the result
+    if (error)
+        play_control_reply (control, client, "ERR %s", error);
+    else
+        play_control_reply (control, client, "OK");
+}
+
+// Reply to the status command of a control socket client
+static void play_control_status (guint client)
+{
+    PlayQueueItem *item = NULL;
+    const gchar   *state;
+    const gchar   *title;
+    gint64         value;
+    gdouble        volume;
+    gboolean       mute;
+    guint          progress;
+
+    if (idle)
+        state = "stopped";
+    else if (paused)
+        state = "paused";
+    else
+        state = "playing";
+
+    play_control_reply (control, client, "state=%s", state);
+    play_control_reply (
+        control,
+        client,
+        "index=%d",
+        play_queue_get_current_index (queue));
+    play_control_reply (
+        control,
+        client,
+        "count=%u",
+        play_queue_get_count (queue));
+
+    if (play_gstreamer_get_volume (backend, &volume))
+        play_control_reply (control, client, "volume=%.2f", volume);
+    if (play_gstreamer_get_mute (backend, &mute))
+        play_control_reply (control, client, "mute=%d", mute ? 1 : 0);
+
+    if (!idle)
+        item = play_gstreamer_get_current (backend);
+    if (!item)
+        return;
+
+    if (play_gstreamer_get_position (backend, &value))
+        play_control_reply (
+            control,
+            client,
+            "position=%.3f",
+            (gdouble) value / GST_SECOND);
+    if (play_gstreamer_get_buffering (backend, &progress))
+        play_control_reply (control, client, "buffering=%u", progress);
+    if (play_gstreamer_get_duration (backend, &value) ||
+        (value = play_queue_item_get_duration (item)) >= 0)
+        play_control_reply (
+            control,
+            client,
+            "duration=%.3f",
+            (gdouble) value / GST_SECOND);
+
+    play_control_reply (
+        control,
+        client,
+        "uri=%s",
+        play_queue_item_get_uri (item));
+
+    title = play_queue_item_get_metadata (item, PLAY_METADATA_TITLE_FULL);
+    if (title)
+        play_control_reply (control, client, "title=%s", title);
+}
+
+// Items have been added to the queue
+static void play_queue_items_added (PlayQueue *queue,
+                                    guint index,
+                                    guint count)
+{
+    // Reuse the information of the unchanged tracks from the library
+    // index, including the ones read after playing has started
+    if (library_refresh) {
+        GPtrArray *items = g_ptr_array_new_full (count, g_object_unref);
+        guint      i;
+
+        for (i = index; i < index + count; i++)
+            g_ptr_array_add (
+                items,
+                g_object_ref (play_queue_get_nth (queue, i)));
+
+        play_library_refresh (library, items);
+        g_ptr_array_unref (items);
+    }
+    if (waiting) {
+        play_check_queue ();
+        return;
+    }
+    // The daemon waiting for new items plays them right away
+    if (idle) {
+        play_resume (index);
+        return;
+    }
+    if (!started)
+        return;
+
+    // Items read from playlists after playing has started are moved to
+    // their places among the items which have not been played yet, or
+    // scattered among them when shuffling
+    // The item following the playing one keeps its place as it might have
+    // already been handed to the backend, which plays it next regardless
+    // of the queue order
+    if (opt_shuffle)
+        play_queue_randomize_from (
+            queue,
+            (guint) play_queue_get_current_index (queue) + 2,
+            index);
+    else
+        play_queue_merge_by_position (
+            queue,
+            (guint) play_queue_get_current_index (queue) + 2,
+            index);
+
+    play_prepare_next ();
+}
+
+// The content replacing the queue has been read
+static void play_queue_replacement_ready (PlayQueue *queue)
+{
+    if (!play_queue_replace (queue))
+        return;
+
+    // The history refers to the previous content
+    if (history)
+        play_simple_queue_remove_all (history);
+
+    if (idle || replace_now) {
+        // Switch to the first item right away, the pipeline is kept in
+        // the ready state to avoid reopening the audio device
+        replaced = FALSE;
+        PRINT_NEWLINE_IF_NEEDED ();
+        play_gstreamer_set_state_ready (backend);
+        play_resume (0);
+    } else {
+        // Keep playing the current track and let the first item of the
+        // new content follow it without a gap
+        replaced = TRUE;
+        play_prepare_next ();
+    }
+}
+
+// A playlist or directory has been completely read
+static void play_queue_playlist_finished (PlayQueue *queue, const gchar *uri)
+{
+    play_check_queue ();
 }
 
 // Update progress of playlist downloads
@@ -739,6 +1774,9 @@ static void play_queue_playlist_progress (PlayQueue *queue)
 {
     download_current = play_queue_get_download_current (queue);
     download_total   = play_queue_get_download_total (queue);
+
+    if (waiting)
+        play_print_download_progress ();
 }
 
 // Handle a quitting signal
@@ -775,6 +1813,23 @@ static gchar *play_format_size (guint64 size)
         return g_strdup_printf ("%.1f EB", (gdouble)size / (gdouble)PLAY_EB);
 }
 
+// Return an array of the queue items in the order they were added in
+static GPtrArray *play_get_queue_items (void)
+{
+    GPtrArray *items;
+    guint      count;
+    guint      i;
+
+    count = play_queue_get_count (queue);
+    items = g_ptr_array_new_full (count, g_object_unref);
+    for (i = 0; i < count; i++)
+        g_ptr_array_add (
+            items,
+            g_object_ref (play_queue_get_nth (queue, i)));
+
+    return items;
+}
+
 int main(int argc, char *argv[])
 {
     GError          *err = NULL;
@@ -795,6 +1850,54 @@ int main(int argc, char *argv[])
         { "shuffle", 's', 0, G_OPTION_ARG_NONE, &opt_shuffle,
           "Play the tracks in a random order",
           NULL },
+        { "library", 'l', 0, G_OPTION_ARG_NONE, &opt_library,
+          "Play the media library or update it with the given files",
+          NULL },
+        { "audio-sink", 0, 0, G_OPTION_ARG_STRING, &opt_audio_sink,
+          "Use the given GStreamer audio sink, e.g. \"fakesink sync=true\"",
+          "SINK" },
+        { "buffer-size", 0, 0, G_OPTION_ARG_INT, &opt_buffer_size,
+          "Size of the network stream buffer in bytes",
+          "BYTES" },
+        { "buffer-duration", 0, 0, G_OPTION_ARG_DOUBLE, &opt_buffer_duration,
+          "Duration of the network stream buffer in seconds",
+          "SECONDS" },
+        { "download", 0, 0, G_OPTION_ARG_NONE, &opt_download,
+          "Download seekable HTTP files to a temporary file while playing",
+          NULL },
+        { "stall-timeout", 0, 0, G_OPTION_ARG_INT, &opt_stall_timeout,
+          "Reconnect network streams which deliver no data for the given number of seconds, 0 to disable",
+          "SECONDS" },
+        { "latency", 0, 0, G_OPTION_ARG_NONE, &opt_latency,
+          "Print the delays of starting, switching and seeking tracks on exit",
+          NULL },
+        { "stats", 0, 0, G_OPTION_ARG_FILENAME, &opt_stats,
+          "Write runtime statistics as JSON to the given file",
+          "FILE" },
+        { "stats-fd", 0, 0, G_OPTION_ARG_INT, &opt_stats_fd,
+          "Write runtime statistics as JSON lines to the given file descriptor",
+          "FD" },
+        { "stats-interval", 0, 0, G_OPTION_ARG_INT, &opt_stats_interval,
+          "Number of seconds between statistics writes, 0 to only write on exit",
+          "SECONDS" },
+        { "daemon", 'd', 0, G_OPTION_ARG_NONE, &opt_daemon,
+          "Run without a terminal and wait for commands on the control socket",
+          NULL },
+        { "socket", 0, 0, G_OPTION_ARG_FILENAME, &opt_socket,
+          "Accept commands through the given Unix domain socket",
+          "PATH" },
+        { "max-downloads", 0, 0, G_OPTION_ARG_INT, &opt_max_downloads,
+          "Maximum number of playlists downloaded at the same time, 0 for no limit",
+          "N" },
+        { "max-downloads-host", 0, 0, G_OPTION_ARG_INT, &opt_max_downloads_host,
+          "Maximum number of playlists downloaded from a single server, 0 for no limit",
+          "N" },
+        { "connect-timeout", 0, 0, G_OPTION_ARG_INT, &opt_connect_timeout,
+          "Seconds to wait for a connection to a playlist server, 0 to wait indefinitely",
+          "SECONDS" },
+        { "read-timeout", 0, 0, G_OPTION_ARG_INT, &opt_read_timeout,
+          "Seconds to wait for more data of a playlist, 0 to wait indefinitely",
+          "SECONDS" },
         { "version", 'v', 0, G_OPTION_ARG_NONE, &opt_version,
           "Show the program version and quit",
           NULL },
@@ -821,7 +1924,17 @@ int main(int argc, char *argv[])
         g_print ("play version %s\n", VERSION);
         return 0;
     }
-    if (argc < 2) {
+    if (opt_daemon) {
+        // The daemon has no terminal to display to or read from
+        opt_quiet       = TRUE;
+        opt_no_controls = TRUE;
+        if (!opt_socket)
+            opt_socket = g_build_filename (
+                g_get_user_runtime_dir (),
+                PLAY_CONTROL_SOCKET_NAME,
+                NULL);
+    }
+    if (argc < 2 && !opt_library && !opt_daemon) {
         // Nothing given on the command line - print the program usage
         gchar *program = g_path_get_basename (argv[0]);
 
@@ -835,9 +1948,11 @@ int main(int argc, char *argv[])
         return 1;
 
     // If the queue has no playable items an error must have been displayed
-    // as the number of arguments was verified
+    // as the number of arguments was verified, the daemon waits for items
+    // to be added
     if (play_queue_get_count (queue) ||
-        play_queue_get_count_pending (queue)) {
+        play_queue_get_count_pending (queue) ||
+        opt_daemon) {
         if (!opt_quiet) {
             // Read the initial terminal width
             play_terminal_update_width (terminal);
@@ -845,9 +1960,10 @@ int main(int argc, char *argv[])
         }
         if (play_queue_get_count_pending (queue)) {
             play_wait_for_queue ();
-        } else {
+        } else if (play_queue_get_count (queue)) {
             play_start ();
-        }
+        } else
+            idle = TRUE;
         g_main_loop_run (loop);
     }
     play_cleanup ();